@@ -0,0 +1,98 @@
+// esp_console command registry. Lines are split on whitespace only, there
+// is no quoting, which is all the firmware's commands need.
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <esp_console.h>
+
+#define CONSOLE_MAX_COMMANDS 16
+#define CONSOLE_MAX_ARGS 8
+
+struct esp_console_repl_s {
+    int unused;
+};
+
+static pthread_mutex_t console_lock = PTHREAD_MUTEX_INITIALIZER;
+static esp_console_cmd_t console_cmds[CONSOLE_MAX_COMMANDS];
+static int console_count = 0;
+
+esp_err_t esp_console_cmd_register(const esp_console_cmd_t *cmd) {
+    if (cmd == NULL || cmd->command == NULL || cmd->func == NULL || strchr(cmd->command, ' ')) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    esp_err_t ret = ESP_ERR_NO_MEM;
+    pthread_mutex_lock(&console_lock);
+    for (int i = 0; i < console_count; i++) {
+        if (strcmp(console_cmds[i].command, cmd->command) == 0) {
+            console_cmds[i] = *cmd;
+            ret = ESP_OK;
+            break;
+        }
+    }
+    if (ret != ESP_OK && console_count < CONSOLE_MAX_COMMANDS) {
+        console_cmds[console_count++] = *cmd;
+        ret = ESP_OK;
+    }
+    pthread_mutex_unlock(&console_lock);
+    return ret;
+}
+
+static int console_help(int argc, char **argv) {
+    pthread_mutex_lock(&console_lock);
+    for (int i = 0; i < console_count; i++) {
+        printf("%s %s\n  %s\n", console_cmds[i].command, console_cmds[i].hint ? console_cmds[i].hint : "",
+               console_cmds[i].help ? console_cmds[i].help : "");
+    }
+    pthread_mutex_unlock(&console_lock);
+    return 0;
+}
+
+esp_err_t esp_console_register_help_command(void) {
+    const esp_console_cmd_t cmd = {
+        .command = "help",
+        .help = "Print the list of registered commands",
+        .func = &console_help,
+    };
+    return esp_console_cmd_register(&cmd);
+}
+
+esp_err_t esp_console_run(const char *cmdline, int *cmd_ret) {
+    char line[256];
+    char *argv[CONSOLE_MAX_ARGS];
+    int argc = 0;
+
+    strncpy(line, cmdline, sizeof(line) - 1);
+    line[sizeof(line) - 1] = '\0';
+    for (char *tok = strtok(line, " \t\r\n"); tok && argc < CONSOLE_MAX_ARGS; tok = strtok(NULL, " \t\r\n")) {
+        argv[argc++] = tok;
+    }
+    if (argc == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    esp_console_cmd_func_t func = NULL;
+    pthread_mutex_lock(&console_lock);
+    for (int i = 0; i < console_count; i++) {
+        if (strcmp(console_cmds[i].command, argv[0]) == 0) {
+            func = console_cmds[i].func;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&console_lock);
+    if (func == NULL) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    *cmd_ret = func(argc, argv);
+    return ESP_OK;
+}
+
+esp_err_t esp_console_new_repl_uart(const esp_console_dev_uart_config_t *dev_config,
+                                    const esp_console_repl_config_t *repl_config, esp_console_repl_t **ret_repl) {
+    static esp_console_repl_t repl;
+    *ret_repl = &repl;
+    return ESP_OK;
+}
+
+esp_err_t esp_console_start_repl(esp_console_repl_t *repl) {
+    return ESP_OK;
+}
@@ -0,0 +1,193 @@
+// esp_log, esp_timer, esp_err, the ROM helpers and the input side of the GPIO driver
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <esp_err.h>
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <esp_rom_sys.h>
+#include <esp_rom_crc.h>
+#include <driver/gpio.h>
+#include <nvs.h>
+#include "host_sim.h"
+
+static pthread_mutex_t log_lock = PTHREAD_MUTEX_INITIALIZER;
+static esp_log_level_t log_level = ESP_LOG_INFO;
+
+static int64_t monotonic_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static int64_t boot_us = 0;
+
+__attribute__((constructor)) static void esp_shim_boot(void) {
+    boot_us = monotonic_us();
+}
+
+int64_t esp_timer_get_time(void) {
+    return monotonic_us() - boot_us;
+}
+
+// Busy-wait like the ROM routine, sleeping would overshoot short delays
+void esp_rom_delay_us(uint32_t us) {
+    int64_t end_us = esp_timer_get_time() + us;
+    while (esp_timer_get_time() < end_us) {
+    }
+}
+
+uint32_t esp_rom_crc32_le(uint32_t crc, uint8_t const *buf, uint32_t len) {
+    crc = ~crc;
+    while (len--) {
+        crc ^= *buf++;
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ (0xEDB88320u & -(crc & 1u));
+        }
+    }
+    return ~crc;
+}
+
+void esp_log_level_set(const char *tag, esp_log_level_t level) {
+    if (strcmp(tag, "*") == 0) {
+        log_level = level;
+    }
+}
+
+void esp_log_write(esp_log_level_t level, const char *tag, const char *format, ...) {
+    static const char letters[] = "NEWIDV";
+    if (level > log_level) {
+        return;
+    }
+
+    // On stderr, so stdout carries only what the firmware prints itself,
+    // such as the bench table
+    va_list args;
+    va_start(args, format);
+    pthread_mutex_lock(&log_lock);
+    fprintf(stderr, "%c (%lld) %s: ", letters[level], (long long)(esp_timer_get_time() / 1000), tag);
+    vfprintf(stderr, format, args);
+    fputc('\n', stderr);
+    pthread_mutex_unlock(&log_lock);
+    va_end(args);
+}
+
+const char *esp_err_to_name(esp_err_t code) {
+    switch (code) {
+        case ESP_OK: return "ESP_OK";
+        case ESP_FAIL: return "ESP_FAIL";
+        case ESP_ERR_NO_MEM: return "ESP_ERR_NO_MEM";
+        case ESP_ERR_INVALID_ARG: return "ESP_ERR_INVALID_ARG";
+        case ESP_ERR_INVALID_STATE: return "ESP_ERR_INVALID_STATE";
+        case ESP_ERR_INVALID_SIZE: return "ESP_ERR_INVALID_SIZE";
+        case ESP_ERR_NOT_FOUND: return "ESP_ERR_NOT_FOUND";
+        case ESP_ERR_NOT_SUPPORTED: return "ESP_ERR_NOT_SUPPORTED";
+        case ESP_ERR_TIMEOUT: return "ESP_ERR_TIMEOUT";
+        case ESP_ERR_INVALID_RESPONSE: return "ESP_ERR_INVALID_RESPONSE";
+        case ESP_ERR_INVALID_CRC: return "ESP_ERR_INVALID_CRC";
+        case ESP_ERR_INVALID_VERSION: return "ESP_ERR_INVALID_VERSION";
+        case ESP_ERR_NVS_NOT_INITIALIZED: return "ESP_ERR_NVS_NOT_INITIALIZED";
+        case ESP_ERR_NVS_NOT_FOUND: return "ESP_ERR_NVS_NOT_FOUND";
+        case ESP_ERR_NVS_TYPE_MISMATCH: return "ESP_ERR_NVS_TYPE_MISMATCH";
+        case ESP_ERR_NVS_READ_ONLY: return "ESP_ERR_NVS_READ_ONLY";
+        case ESP_ERR_NVS_NOT_ENOUGH_SPACE: return "ESP_ERR_NVS_NOT_ENOUGH_SPACE";
+        case ESP_ERR_NVS_INVALID_NAME: return "ESP_ERR_NVS_INVALID_NAME";
+        case ESP_ERR_NVS_INVALID_HANDLE: return "ESP_ERR_NVS_INVALID_HANDLE";
+        case ESP_ERR_NVS_KEY_TOO_LONG: return "ESP_ERR_NVS_KEY_TOO_LONG";
+        case ESP_ERR_NVS_INVALID_LENGTH: return "ESP_ERR_NVS_INVALID_LENGTH";
+        case ESP_ERR_NVS_NO_FREE_PAGES: return "ESP_ERR_NVS_NO_FREE_PAGES";
+        case ESP_ERR_NVS_NEW_VERSION_FOUND: return "ESP_ERR_NVS_NEW_VERSION_FOUND";
+        default: return "UNKNOWN ERROR";
+    }
+}
+
+// GPIO: inputs idle high (every line in this design has a pull-up) until a
+// simulated device drives them.
+static pthread_mutex_t gpio_lock = PTHREAD_MUTEX_INITIALIZER;
+static int gpio_level[GPIO_NUM_MAX];
+static gpio_int_type_t gpio_intr[GPIO_NUM_MAX];
+static gpio_isr_t gpio_handler[GPIO_NUM_MAX];
+static void *gpio_handler_arg[GPIO_NUM_MAX];
+static bool gpio_isr_service = false;
+
+__attribute__((constructor)) static void esp_shim_gpio_init(void) {
+    for (int i = 0; i < GPIO_NUM_MAX; i++) {
+        gpio_level[i] = 1;
+    }
+}
+
+esp_err_t gpio_config(const gpio_config_t *config) {
+    if (config->pin_bit_mask >> GPIO_NUM_MAX) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    pthread_mutex_lock(&gpio_lock);
+    for (int i = 0; i < GPIO_NUM_MAX; i++) {
+        if (config->pin_bit_mask & (1ULL << i)) {
+            gpio_intr[i] = config->intr_type;
+        }
+    }
+    pthread_mutex_unlock(&gpio_lock);
+    return ESP_OK;
+}
+
+esp_err_t gpio_install_isr_service(int intr_alloc_flags) {
+    (void)intr_alloc_flags;
+    if (gpio_isr_service) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    gpio_isr_service = true;
+    return ESP_OK;
+}
+
+esp_err_t gpio_isr_handler_add(gpio_num_t gpio, gpio_isr_t handler, void *arg) {
+    if (gpio < 0 || gpio >= GPIO_NUM_MAX) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!gpio_isr_service) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    pthread_mutex_lock(&gpio_lock);
+    gpio_handler[gpio] = handler;
+    gpio_handler_arg[gpio] = arg;
+    pthread_mutex_unlock(&gpio_lock);
+    return ESP_OK;
+}
+
+esp_err_t gpio_isr_handler_remove(gpio_num_t gpio) {
+    return gpio_isr_handler_add(gpio, NULL, NULL);
+}
+
+int gpio_get_level(gpio_num_t gpio) {
+    if (gpio < 0 || gpio >= GPIO_NUM_MAX) {
+        return 0;
+    }
+    pthread_mutex_lock(&gpio_lock);
+    int level = gpio_level[gpio];
+    pthread_mutex_unlock(&gpio_lock);
+    return level;
+}
+
+void host_gpio_drive(int gpio, int level) {
+    if (gpio < 0 || gpio >= GPIO_NUM_MAX) {
+        return;
+    }
+    pthread_mutex_lock(&gpio_lock);
+    int old_level = gpio_level[gpio];
+    gpio_level[gpio] = level ? 1 : 0;
+    gpio_isr_t handler = gpio_handler[gpio];
+    void *arg = gpio_handler_arg[gpio];
+    gpio_int_type_t intr = gpio_intr[gpio];
+    pthread_mutex_unlock(&gpio_lock);
+
+    bool fire = false;
+    if (old_level && !level) {
+        fire = (intr == GPIO_INTR_NEGEDGE || intr == GPIO_INTR_ANYEDGE || intr == GPIO_INTR_LOW_LEVEL);
+    } else if (!old_level && level) {
+        fire = (intr == GPIO_INTR_POSEDGE || intr == GPIO_INTR_ANYEDGE || intr == GPIO_INTR_HIGH_LEVEL);
+    }
+    if (fire && handler) {
+        handler(arg);
+    }
+}
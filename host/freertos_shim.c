@@ -0,0 +1,344 @@
+// FreeRTOS on pthreads. Tasks are detached threads, queues and semaphores are
+// ring buffers guarded by a mutex and two condition variables. Timeouts are
+// counted in ticks of portTICK_PERIOD_MS against CLOCK_MONOTONIC, so
+// vTaskDelay() and xTaskGetTickCount() keep the target's granularity.
+#define _GNU_SOURCE
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
+#include <esp_log.h>
+#include <esp_timer.h>
+
+struct host_task {
+    pthread_t thread;
+    char name[16];
+    TaskFunction_t fn;
+    void *arg;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    uint32_t notify[configTASK_NOTIFICATION_ARRAY_ENTRIES];
+};
+
+struct host_queue {
+    pthread_mutex_t lock;
+    pthread_cond_t not_empty;
+    pthread_cond_t not_full;
+    UBaseType_t length;
+    UBaseType_t item_size;
+    UBaseType_t count;
+    UBaseType_t head;
+    uint8_t *storage;  // NULL for semaphores
+};
+
+static __thread struct host_task *current_task = NULL;
+static pthread_mutex_t critical_lock;
+static pthread_once_t critical_once = PTHREAD_ONCE_INIT;
+
+static void critical_lock_init(void) {
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&critical_lock, &attr);
+    pthread_mutexattr_destroy(&attr);
+}
+
+void vPortEnterCritical(portMUX_TYPE *mux) {
+    (void)mux;
+    pthread_once(&critical_once, critical_lock_init);
+    pthread_mutex_lock(&critical_lock);
+}
+
+void vPortExitCritical(portMUX_TYPE *mux) {
+    (void)mux;
+    pthread_mutex_unlock(&critical_lock);
+}
+
+static void cond_init_monotonic(pthread_cond_t *cond) {
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(cond, &attr);
+    pthread_condattr_destroy(&attr);
+}
+
+// Absolute CLOCK_MONOTONIC deadline for a wait of ticks from now
+static struct timespec deadline_after(TickType_t ticks) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    uint64_t ns = (uint64_t)ticks * portTICK_PERIOD_MS * 1000000ULL;
+    ts.tv_sec += ns / 1000000000ULL;
+    ts.tv_nsec += ns % 1000000000ULL;
+    if (ts.tv_nsec >= 1000000000L) {
+        ts.tv_sec++;
+        ts.tv_nsec -= 1000000000L;
+    }
+    return ts;
+}
+
+// Wait on cond until woken or the deadline passes. Returns false on timeout.
+static bool cond_wait_ticks(pthread_cond_t *cond, pthread_mutex_t *lock, TickType_t ticks,
+                            const struct timespec *deadline) {
+    if (ticks == portMAX_DELAY) {
+        pthread_cond_wait(cond, lock);
+        return true;
+    }
+    return pthread_cond_timedwait(cond, lock, deadline) != ETIMEDOUT;
+}
+
+static struct host_task *task_alloc(const char *name) {
+    struct host_task *task = calloc(1, sizeof(*task));
+    if (task == NULL) {
+        return NULL;
+    }
+    strncpy(task->name, name ? name : "", sizeof(task->name) - 1);
+    pthread_mutex_init(&task->lock, NULL);
+    cond_init_monotonic(&task->cond);
+    return task;
+}
+
+static void *task_entry(void *arg) {
+    struct host_task *task = arg;
+    current_task = task;
+    pthread_setname_np(pthread_self(), task->name);
+    task->fn(task->arg);
+    // Returning from a task function is a bug on the target as well
+    ESP_LOGE("FreeRTOS", "Task %s returned without vTaskDelete()", task->name);
+    return NULL;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t fn, const char *name, uint32_t stack_depth, void *arg,
+                       UBaseType_t priority, TaskHandle_t *handle) {
+    (void)stack_depth;
+    (void)priority;
+    struct host_task *task = task_alloc(name);
+    if (task == NULL) {
+        return pdFAIL;
+    }
+    task->fn = fn;
+    task->arg = arg;
+
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    int rc = pthread_create(&task->thread, &attr, task_entry, task);
+    pthread_attr_destroy(&attr);
+    if (rc != 0) {
+        free(task);
+        return pdFAIL;
+    }
+    if (handle) {
+        *handle = task;
+    }
+    return pdPASS;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char *name, uint32_t stack_depth, void *arg,
+                                   UBaseType_t priority, TaskHandle_t *handle, BaseType_t core) {
+    (void)core;
+    return xTaskCreate(fn, name, stack_depth, arg, priority, handle);
+}
+
+void vTaskDelete(TaskHandle_t task) {
+    if (task != NULL && task != current_task) {
+        ESP_LOGE("FreeRTOS", "Deleting another task is not supported on the host");
+        return;
+    }
+    // The handle stays allocated, a late xTaskNotifyGive() must not crash
+    pthread_exit(NULL);
+}
+
+TickType_t xTaskGetTickCount(void) {
+    return (TickType_t)(esp_timer_get_time() / 1000 / portTICK_PERIOD_MS);
+}
+
+// Like the target, the delay ends on a tick boundary, so a delay of n ticks
+// lasts between n - 1 and n tick periods.
+void vTaskDelay(TickType_t ticks) {
+    if (ticks == 0) {
+        sched_yield();
+        return;
+    }
+    int64_t wake_us = ((int64_t)xTaskGetTickCount() + ticks) * portTICK_PERIOD_MS * 1000;
+    int64_t now_us;
+    while ((now_us = esp_timer_get_time()) < wake_us) {
+        int64_t left_us = wake_us - now_us;
+        struct timespec ts = { .tv_sec = left_us / 1000000, .tv_nsec = (left_us % 1000000) * 1000 };
+        nanosleep(&ts, NULL);
+    }
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void) {
+    // Threads not started by xTaskCreate(), such as main(), get a handle on
+    // first use so they can take notifications too.
+    if (current_task == NULL) {
+        current_task = task_alloc("main");
+        if (current_task != NULL) {
+            current_task->thread = pthread_self();
+        }
+    }
+    return current_task;
+}
+
+const char *pcTaskGetName(TaskHandle_t task) {
+    if (task == NULL) {
+        task = xTaskGetCurrentTaskHandle();
+    }
+    return task ? task->name : "";
+}
+
+BaseType_t xTaskNotifyGiveIndexed(TaskHandle_t task, UBaseType_t index) {
+    if (index >= configTASK_NOTIFICATION_ARRAY_ENTRIES) {
+        return pdFAIL;
+    }
+    pthread_mutex_lock(&task->lock);
+    task->notify[index]++;
+    // Only the task itself waits, but it may be waiting on another index
+    pthread_cond_broadcast(&task->cond);
+    pthread_mutex_unlock(&task->lock);
+    return pdPASS;
+}
+
+uint32_t ulTaskNotifyTakeIndexed(UBaseType_t index, BaseType_t clear_on_exit, TickType_t ticks) {
+    if (index >= configTASK_NOTIFICATION_ARRAY_ENTRIES) {
+        return 0;
+    }
+    struct host_task *task = xTaskGetCurrentTaskHandle();
+    struct timespec deadline = deadline_after(ticks);
+
+    pthread_mutex_lock(&task->lock);
+    while (task->notify[index] == 0 && ticks != 0) {
+        if (!cond_wait_ticks(&task->cond, &task->lock, ticks, &deadline)) {
+            break;
+        }
+    }
+    uint32_t value = task->notify[index];
+    if (value != 0) {
+        task->notify[index] = clear_on_exit ? 0 : value - 1;
+    }
+    pthread_mutex_unlock(&task->lock);
+    return value;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task) {
+    return xTaskNotifyGiveIndexed(task, 0);
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t ticks) {
+    return ulTaskNotifyTakeIndexed(0, clear_on_exit, ticks);
+}
+
+static QueueHandle_t queue_alloc(UBaseType_t length, UBaseType_t item_size) {
+    struct host_queue *queue = calloc(1, sizeof(*queue));
+    if (queue == NULL) {
+        return NULL;
+    }
+    if (item_size > 0) {
+        queue->storage = malloc((size_t)length * item_size);
+        if (queue->storage == NULL) {
+            free(queue);
+            return NULL;
+        }
+    }
+    queue->length = length;
+    queue->item_size = item_size;
+    pthread_mutex_init(&queue->lock, NULL);
+    cond_init_monotonic(&queue->not_empty);
+    cond_init_monotonic(&queue->not_full);
+    return queue;
+}
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size) {
+    return length > 0 ? queue_alloc(length, item_size) : NULL;
+}
+
+void vQueueDelete(QueueHandle_t queue) {
+    if (queue == NULL) {
+        return;
+    }
+    pthread_mutex_destroy(&queue->lock);
+    pthread_cond_destroy(&queue->not_empty);
+    pthread_cond_destroy(&queue->not_full);
+    free(queue->storage);
+    free(queue);
+}
+
+BaseType_t xQueueSend(QueueHandle_t queue, const void *item, TickType_t ticks) {
+    struct timespec deadline = deadline_after(ticks);
+
+    pthread_mutex_lock(&queue->lock);
+    while (queue->count == queue->length) {
+        if (ticks == 0 || !cond_wait_ticks(&queue->not_full, &queue->lock, ticks, &deadline)) {
+            pthread_mutex_unlock(&queue->lock);
+            return pdFAIL;
+        }
+    }
+    if (queue->storage) {
+        UBaseType_t tail = (queue->head + queue->count) % queue->length;
+        memcpy(queue->storage + (size_t)tail * queue->item_size, item, queue->item_size);
+    }
+    queue->count++;
+    pthread_cond_signal(&queue->not_empty);
+    pthread_mutex_unlock(&queue->lock);
+    return pdPASS;
+}
+
+BaseType_t xQueueSendToBack(QueueHandle_t queue, const void *item, TickType_t ticks) {
+    return xQueueSend(queue, item, ticks);
+}
+
+BaseType_t xQueueSendFromISR(QueueHandle_t queue, const void *item, BaseType_t *woken) {
+    if (woken) {
+        *woken = pdFALSE;
+    }
+    return xQueueSend(queue, item, 0);
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void *item, TickType_t ticks) {
+    struct timespec deadline = deadline_after(ticks);
+
+    pthread_mutex_lock(&queue->lock);
+    while (queue->count == 0) {
+        if (ticks == 0 || !cond_wait_ticks(&queue->not_empty, &queue->lock, ticks, &deadline)) {
+            pthread_mutex_unlock(&queue->lock);
+            return pdFAIL;
+        }
+    }
+    if (queue->storage) {
+        memcpy(item, queue->storage + (size_t)queue->head * queue->item_size, queue->item_size);
+    }
+    queue->head = (queue->head + 1) % queue->length;
+    queue->count--;
+    pthread_cond_signal(&queue->not_full);
+    pthread_mutex_unlock(&queue->lock);
+    return pdPASS;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue) {
+    pthread_mutex_lock(&queue->lock);
+    UBaseType_t count = queue->count;
+    pthread_mutex_unlock(&queue->lock);
+    return count;
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary(void) {
+    return queue_alloc(1, 0);
+}
+
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t max_count, UBaseType_t initial_count) {
+    SemaphoreHandle_t sem = max_count > 0 ? queue_alloc(max_count, 0) : NULL;
+    if (sem != NULL) {
+        sem->count = initial_count < max_count ? initial_count : max_count;
+    }
+    return sem;
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void) {
+    return xSemaphoreCreateCounting(1, 1);
+}
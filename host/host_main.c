@@ -0,0 +1,163 @@
+// Host entry point. Attaches the simulated devices, runs app_main() in its
+// own task as the IDF startup code does, then plays keypad input read from
+// stdin, one command per line:
+//
+//   123A          tap each key in turn (held 100 ms, 100 ms apart)
+//   hold B C 600  hold the listed keys together for 600 ms
+//   wait 2000     do nothing for 2000 ms
+//   lcd           print the screen
+//   stats         print bus statistics
+//   quit          exit, as does end of input
+//
+// A line starting with a firmware console command (help, trace, ...) runs
+// that command instead.
+//
+// Lines starting with '#' are comments, so scripts can be piped in.
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <esp_log.h>
+#include <esp_console.h>
+#include "i2c_bus.h"
+#include "bench.h"
+#include "host_sim.h"
+
+// Board wiring, matching main.c and keyboard.c
+#define SIM_KEYPAD_ADDR 0x23
+#define SIM_KEYPAD_INT_GPIO 4
+#define SIM_LCD_ADDR 0x27
+#define SIM_RTC_ADDR 0x68
+#define SIM_EEPROM_ADDR 0x50
+
+#define TAP_HOLD_MS 100
+#define TAP_GAP_MS 100
+
+void app_main(void);
+
+static void app_main_task(void *pvParameters) {
+    app_main();
+    vTaskDelete(NULL);
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr,
+            "usage: %s [-t] [-c clk_hz] [-o overhead_us] [-e eeprom.bin] [-q] [-v]\n"
+            "  -t  no bus or device timing, run transfers as fast as possible\n"
+            "  -c  run SCL at clk_hz whatever the firmware asks for\n"
+            "  -o  fixed cost added to every transaction, in us\n"
+            "  -e  keep the 24C32 contents in this file\n"
+            "  -q  do not print the screen on every change\n"
+            "  -v  debug logging\n"
+            "NVS is kept in $HOST_NVS_FILE when it is set.\n",
+            prog);
+}
+
+static void hold_keys(uint16_t keys, int ms) {
+    sim_keypad_set(keys);
+    vTaskDelay(pdMS_TO_TICKS(ms));
+    sim_keypad_set(0);
+}
+
+static void run_command(char *line) {
+    int console_ret;
+    if (esp_console_run(line, &console_ret) == ESP_OK) {
+        return;
+    }
+
+    char *cmd = strtok(line, " \t\r\n");
+    if (cmd == NULL || cmd[0] == '#') {
+        return;
+    }
+
+    if (strcmp(cmd, "quit") == 0) {
+        i2c_bus_log_stats();
+        i2c_sim_log_stats();
+        exit(0);
+    } else if (strcmp(cmd, "wait") == 0) {
+        char *arg = strtok(NULL, " \t\r\n");
+        vTaskDelay(pdMS_TO_TICKS(arg ? atoi(arg) : 1000));
+    } else if (strcmp(cmd, "lcd") == 0) {
+        sim_lcd_print();
+    } else if (strcmp(cmd, "stats") == 0) {
+        i2c_bus_log_stats();
+        i2c_sim_log_stats();
+    } else if (strcmp(cmd, "hold") == 0) {
+        uint16_t keys = 0;
+        int ms = 1000;
+        char *arg;
+        while ((arg = strtok(NULL, " \t\r\n")) != NULL) {
+            if (isdigit((unsigned char)arg[0]) && arg[1] != '\0') {
+                ms = atoi(arg);
+            } else if (arg[1] == '\0' && sim_keypad_bit(arg[0]) >= 0) {
+                keys |= 1u << sim_keypad_bit(arg[0]);
+            } else {
+                ESP_LOGW("Host", "hold: '%s' is not a key or a duration", arg);
+            }
+        }
+        hold_keys(keys, ms);
+    } else {
+        // Anything else is a run of key taps
+        for (char *key = cmd; key; key = strtok(NULL, " \t\r\n")) {
+            for (; *key; key++) {
+                int bit = sim_keypad_bit(*key);
+                if (bit < 0) {
+                    ESP_LOGW("Host", "'%c' is not on the keypad", *key);
+                    continue;
+                }
+                hold_keys(1u << bit, TAP_HOLD_MS);
+                vTaskDelay(pdMS_TO_TICKS(TAP_GAP_MS));
+            }
+        }
+    }
+}
+
+int main(int argc, char **argv) {
+    i2c_sim_config_t bus = { .timing = true };
+    const char *eeprom_file = NULL;
+    bool echo = true;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "tc:o:e:qvh")) != -1) {
+        switch (opt) {
+            case 't': bus.timing = false; break;
+            case 'c': bus.clk_override_hz = strtoul(optarg, NULL, 0); break;
+            case 'o': bus.txn_overhead_us = strtoul(optarg, NULL, 0); break;
+            case 'e': eeprom_file = optarg; break;
+            case 'q': echo = false; break;
+            case 'v': esp_log_level_set("*", ESP_LOG_DEBUG); break;
+            default:
+                usage(argv[0]);
+                return opt == 'h' ? 0 : 2;
+        }
+    }
+
+    i2c_sim_configure(&bus);
+    sim_keypad_attach(SIM_KEYPAD_ADDR, SIM_KEYPAD_INT_GPIO);
+    sim_lcd_attach(SIM_LCD_ADDR);
+    sim_lcd_set_echo(echo);
+    sim_ds1307_attach(SIM_RTC_ADDR);
+    sim_eeprom_attach(SIM_EEPROM_ADDR, eeprom_file);
+
+    xTaskCreate(app_main_task, "main", 3584, NULL, 1, NULL);
+
+#ifdef APP_BENCH
+    // No keypad input, the table is all this build is for. The log is on
+    // stderr, so stdout is the table alone; its lines also start with
+    // "bench," to pick them out of a device's serial log.
+    bench_wait_done(portMAX_DELAY);
+    return 0;
+#endif
+
+    char line[256];
+    while (fgets(line, sizeof(line), stdin) != NULL) {
+        run_command(line);
+    }
+
+    char quit[] = "quit";
+    run_command(quit);
+    return 0;
+}
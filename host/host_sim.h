@@ -0,0 +1,60 @@
+#ifndef HOST_SIM_H
+#define HOST_SIM_H
+
+// Simulated hardware behind the host shims. Nothing here is visible to the
+// firmware, it is driven from host_main.c.
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// One device on the simulated bus. The callbacks run on the thread calling
+// i2c_master_cmd_begin() with the bus lock held.
+typedef struct i2c_sim_device {
+    const char *name;
+    uint8_t addr;
+    uint32_t max_clk_hz;                                     // Fastest SCL the part tolerates
+    bool (*start)(struct i2c_sim_device *dev, bool read);    // Address matched, return ACK
+    bool (*write)(struct i2c_sim_device *dev, uint8_t data); // Return ACK
+    uint8_t (*read)(struct i2c_sim_device *dev);
+    void (*stop)(struct i2c_sim_device *dev);
+    struct i2c_sim_device *next;
+} i2c_sim_device_t;
+
+// Bus timing. Every start, stop and 9-bit byte costs its share of SCL
+// periods plus a fixed per-transaction overhead; i2c_master_cmd_begin()
+// returns only once that much wall time has passed. clk_override_hz replaces
+// the rate the firmware asks for, 0 keeps it.
+typedef struct {
+    bool timing;
+    uint32_t clk_override_hz;
+    uint32_t txn_overhead_us;
+} i2c_sim_config_t;
+
+void i2c_sim_configure(const i2c_sim_config_t *config);
+void i2c_sim_attach(i2c_sim_device_t *dev);
+// Position of SCL in the transaction being executed, in microseconds on
+// the esp_timer_get_time() scale. Devices use it for their internal timing.
+int64_t i2c_sim_now_us(void);
+// False when timing is off; devices then skip their busy periods too, since
+// nothing paces the firmware the way the wire would
+bool i2c_sim_timed(void);
+void i2c_sim_lock(void);
+void i2c_sim_unlock(void);
+void i2c_sim_log_stats(void);
+
+// GPIO lines driven by the simulated devices. A falling edge on a pin with
+// a GPIO_INTR_NEGEDGE handler runs the handler on the caller's thread.
+void host_gpio_drive(int gpio, int level);
+
+// Device models, each attached at its usual address
+void sim_keypad_attach(uint8_t addr, int int_gpio);
+void sim_keypad_set(uint16_t keys);                 // Bit (row * 4 + col) held down
+int sim_keypad_bit(char key);                       // -1 if not on the keypad
+void sim_lcd_attach(uint8_t addr);
+void sim_lcd_print(void);                           // Dump the visible screen
+void sim_lcd_set_echo(bool on);                     // Dump on every change
+void sim_ds1307_attach(uint8_t addr);
+void sim_eeprom_attach(uint8_t addr, const char *backing_file);
+
+#endif // HOST_SIM_H
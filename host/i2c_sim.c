@@ -0,0 +1,346 @@
+// Legacy I2C master driver on top of simulated devices. Commands are queued
+// exactly as the real driver does and replayed against the device models in
+// i2c_master_cmd_begin(), which then waits out the modelled wire time.
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <driver/i2c.h>
+#include <esp_log.h>
+#include <esp_timer.h>
+#include "host_sim.h"
+
+typedef enum {
+    SIM_CMD_START,
+    SIM_CMD_STOP,
+    SIM_CMD_WRITE,
+    SIM_CMD_READ
+} sim_cmd_type_t;
+
+typedef struct {
+    uint8_t type;
+    bool ack_check;
+    uint8_t byte;        // Copy made by i2c_master_write_byte()
+    const uint8_t *tx;
+    uint8_t *rx;
+    size_t len;
+} sim_cmd_t;
+
+_Static_assert(sizeof(sim_cmd_t) <= I2C_INTERNAL_STRUCT_SIZE, "I2C_LINK_RECOMMENDED_SIZE too small");
+
+typedef struct {
+    sim_cmd_t *cmds;
+    size_t count;
+    size_t capacity;
+    bool is_static;
+} sim_link_t;
+
+typedef struct {
+    bool installed;
+    uint32_t clk_hz;
+} sim_port_t;
+
+typedef struct {
+    uint32_t transactions;
+    uint32_t nacks;
+    uint64_t bytes;
+    uint64_t busy_us;
+} sim_stats_t;
+
+static pthread_mutex_t sim_lock = PTHREAD_MUTEX_INITIALIZER;
+static sim_port_t sim_ports[I2C_NUM_MAX];
+static i2c_sim_device_t *sim_devices = NULL;
+static i2c_sim_config_t sim_config = { .timing = true };
+static sim_stats_t sim_stats;
+static uint64_t sim_unclaimed = 0;  // Transactions no device acknowledged
+
+// SCL position within the running transaction, in microseconds
+static double sim_now = 0;
+static bool sim_running = false;
+
+void i2c_sim_configure(const i2c_sim_config_t *config) {
+    pthread_mutex_lock(&sim_lock);
+    sim_config = *config;
+    pthread_mutex_unlock(&sim_lock);
+}
+
+void i2c_sim_attach(i2c_sim_device_t *dev) {
+    pthread_mutex_lock(&sim_lock);
+    dev->next = sim_devices;
+    sim_devices = dev;
+    pthread_mutex_unlock(&sim_lock);
+}
+
+void i2c_sim_lock(void) {
+    pthread_mutex_lock(&sim_lock);
+}
+
+void i2c_sim_unlock(void) {
+    pthread_mutex_unlock(&sim_lock);
+}
+
+int64_t i2c_sim_now_us(void) {
+    return sim_running ? (int64_t)sim_now : esp_timer_get_time();
+}
+
+bool i2c_sim_timed(void) {
+    return sim_config.timing;
+}
+
+void i2c_sim_log_stats(void) {
+    pthread_mutex_lock(&sim_lock);
+    sim_stats_t stats = sim_stats;
+    uint64_t unclaimed = sim_unclaimed;
+    pthread_mutex_unlock(&sim_lock);
+    ESP_LOGI("SimI2C", "%lu transactions, %llu bytes, %lu NACKs (%llu unclaimed), %llu us on the wire",
+             (unsigned long)stats.transactions, (unsigned long long)stats.bytes, (unsigned long)stats.nacks,
+             (unsigned long long)unclaimed, (unsigned long long)stats.busy_us);
+}
+
+esp_err_t i2c_param_config(i2c_port_t port, const i2c_config_t *config) {
+    if (port < 0 || port >= I2C_NUM_MAX || config->mode != I2C_MODE_MASTER || config->master.clk_speed == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    pthread_mutex_lock(&sim_lock);
+    sim_ports[port].clk_hz = config->master.clk_speed;
+    pthread_mutex_unlock(&sim_lock);
+    return ESP_OK;
+}
+
+esp_err_t i2c_driver_install(i2c_port_t port, i2c_mode_t mode, size_t slv_rx_buf_len, size_t slv_tx_buf_len,
+                             int intr_alloc_flags) {
+    (void)slv_rx_buf_len;
+    (void)slv_tx_buf_len;
+    (void)intr_alloc_flags;
+    if (port < 0 || port >= I2C_NUM_MAX || mode != I2C_MODE_MASTER) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (sim_ports[port].installed) {
+        return ESP_FAIL;
+    }
+    sim_ports[port].installed = true;
+    return ESP_OK;
+}
+
+esp_err_t i2c_driver_delete(i2c_port_t port) {
+    if (port < 0 || port >= I2C_NUM_MAX) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    sim_ports[port].installed = false;
+    return ESP_OK;
+}
+
+i2c_cmd_handle_t i2c_cmd_link_create(void) {
+    return calloc(1, sizeof(sim_link_t));
+}
+
+// The link header and its commands live in the caller's buffer, like the
+// real driver. NULL if the buffer cannot even hold the header.
+i2c_cmd_handle_t i2c_cmd_link_create_static(uint8_t *buffer, uint32_t size) {
+    uintptr_t base = ((uintptr_t)buffer + 7) & ~(uintptr_t)7;
+    uintptr_t end = (uintptr_t)buffer + size;
+    if (buffer == NULL || base + sizeof(sim_link_t) > end) {
+        return NULL;
+    }
+    sim_link_t *link = (sim_link_t *)base;
+    link->cmds = (sim_cmd_t *)(base + sizeof(sim_link_t));
+    link->count = 0;
+    link->capacity = (end - (uintptr_t)link->cmds) / sizeof(sim_cmd_t);
+    link->is_static = true;
+    return link;
+}
+
+void i2c_cmd_link_delete(i2c_cmd_handle_t cmd) {
+    sim_link_t *link = cmd;
+    if (link == NULL || link->is_static) {
+        return;
+    }
+    free(link->cmds);
+    free(link);
+}
+
+void i2c_cmd_link_delete_static(i2c_cmd_handle_t cmd) {
+    (void)cmd;
+}
+
+static esp_err_t link_append(i2c_cmd_handle_t cmd, const sim_cmd_t *entry) {
+    sim_link_t *link = cmd;
+    if (link == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (link->count == link->capacity) {
+        if (link->is_static) {
+            return ESP_ERR_NO_MEM;
+        }
+        size_t capacity = link->capacity ? link->capacity * 2 : 8;
+        sim_cmd_t *cmds = realloc(link->cmds, capacity * sizeof(sim_cmd_t));
+        if (cmds == NULL) {
+            return ESP_ERR_NO_MEM;
+        }
+        link->cmds = cmds;
+        link->capacity = capacity;
+    }
+    link->cmds[link->count++] = *entry;
+    return ESP_OK;
+}
+
+esp_err_t i2c_master_start(i2c_cmd_handle_t cmd) {
+    sim_cmd_t entry = { .type = SIM_CMD_START };
+    return link_append(cmd, &entry);
+}
+
+esp_err_t i2c_master_stop(i2c_cmd_handle_t cmd) {
+    sim_cmd_t entry = { .type = SIM_CMD_STOP };
+    return link_append(cmd, &entry);
+}
+
+esp_err_t i2c_master_write_byte(i2c_cmd_handle_t cmd, uint8_t data, bool ack_en) {
+    sim_cmd_t entry = { .type = SIM_CMD_WRITE, .ack_check = ack_en, .byte = data, .len = 1 };
+    return link_append(cmd, &entry);
+}
+
+esp_err_t i2c_master_write(i2c_cmd_handle_t cmd, const uint8_t *data, size_t len, bool ack_en) {
+    if (data == NULL || len == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    sim_cmd_t entry = { .type = SIM_CMD_WRITE, .ack_check = ack_en, .tx = data, .len = len };
+    return link_append(cmd, &entry);
+}
+
+esp_err_t i2c_master_read_byte(i2c_cmd_handle_t cmd, uint8_t *data, i2c_ack_type_t ack) {
+    return i2c_master_read(cmd, data, 1, ack);
+}
+
+esp_err_t i2c_master_read(i2c_cmd_handle_t cmd, uint8_t *data, size_t len, i2c_ack_type_t ack) {
+    if (data == NULL || len == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    sim_cmd_t entry = { .type = SIM_CMD_READ, .rx = data, .len = len };
+    return link_append(cmd, &entry);
+}
+
+static i2c_sim_device_t *find_device(uint8_t addr) {
+    for (i2c_sim_device_t *dev = sim_devices; dev; dev = dev->next) {
+        if (dev->addr == addr) {
+            return dev;
+        }
+    }
+    return NULL;
+}
+
+// An address byte: find the device and let it decide whether to ACK. A part
+// clocked past its rating is treated as absent, the firmware must not rely
+// on it working out of spec.
+static i2c_sim_device_t *address_device(uint8_t data, uint32_t clk_hz) {
+    i2c_sim_device_t *dev = find_device(data >> 1);
+    if (dev == NULL) {
+        sim_unclaimed++;
+        return NULL;
+    }
+    if (dev->max_clk_hz && clk_hz > dev->max_clk_hz) {
+        ESP_LOGW("SimI2C", "%s addressed at %lu Hz, rated for %lu Hz", dev->name, (unsigned long)clk_hz,
+                 (unsigned long)dev->max_clk_hz);
+        return NULL;
+    }
+    return dev->start(dev, data & 1) ? dev : NULL;
+}
+
+static void sleep_until_us(int64_t wake_us) {
+    int64_t now_us;
+    while ((now_us = esp_timer_get_time()) < wake_us) {
+        int64_t left_us = wake_us - now_us;
+        struct timespec ts = { .tv_sec = left_us / 1000000, .tv_nsec = (left_us % 1000000) * 1000 };
+        nanosleep(&ts, NULL);
+    }
+}
+
+esp_err_t i2c_master_cmd_begin(i2c_port_t port, i2c_cmd_handle_t cmd, TickType_t ticks_to_wait) {
+    sim_link_t *link = cmd;
+    if (port < 0 || port >= I2C_NUM_MAX || link == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    pthread_mutex_lock(&sim_lock);
+    if (!sim_ports[port].installed) {
+        pthread_mutex_unlock(&sim_lock);
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    uint32_t clk_hz = sim_config.clk_override_hz ? sim_config.clk_override_hz : sim_ports[port].clk_hz;
+    double bit_us = 1e6 / clk_hz;
+    int64_t start_us = esp_timer_get_time();
+    sim_now = start_us;
+    sim_running = true;
+
+    esp_err_t ret = ESP_OK;
+    i2c_sim_device_t *dev = NULL;
+    bool expect_addr = false;
+    uint64_t bytes = 0;
+
+    for (size_t i = 0; i < link->count && ret == ESP_OK; i++) {
+        const sim_cmd_t *c = &link->cmds[i];
+        switch (c->type) {
+            case SIM_CMD_START:
+                sim_now += bit_us;
+                expect_addr = true;
+                break;
+            case SIM_CMD_STOP:
+                sim_now += bit_us;
+                if (dev) {
+                    dev->stop(dev);
+                    dev = NULL;
+                }
+                break;
+            case SIM_CMD_WRITE:
+                for (size_t n = 0; n < c->len && ret == ESP_OK; n++) {
+                    uint8_t data = c->tx ? c->tx[n] : c->byte;
+                    bool ack;
+                    sim_now += 9 * bit_us;
+                    bytes++;
+                    if (expect_addr) {
+                        expect_addr = false;
+                        dev = address_device(data, clk_hz);
+                        ack = (dev != NULL);
+                    } else {
+                        ack = dev && dev->write(dev, data);
+                    }
+                    if (!ack && c->ack_check) {
+                        ret = ESP_FAIL;
+                    }
+                }
+                break;
+            case SIM_CMD_READ:
+                for (size_t n = 0; n < c->len; n++) {
+                    sim_now += 9 * bit_us;
+                    bytes++;
+                    c->rx[n] = dev ? dev->read(dev) : 0xFF;
+                }
+                break;
+        }
+    }
+
+    // The controller ends a failed transaction with a stop of its own
+    if (ret != ESP_OK) {
+        sim_now += bit_us;
+        if (dev) {
+            dev->stop(dev);
+        }
+        sim_stats.nacks++;
+    }
+    sim_running = false;
+
+    int64_t busy_us = (int64_t)(sim_now - start_us) + sim_config.txn_overhead_us;
+    sim_stats.transactions++;
+    sim_stats.bytes += bytes;
+    sim_stats.busy_us += busy_us;
+    if (ticks_to_wait != portMAX_DELAY && busy_us > (int64_t)ticks_to_wait * portTICK_PERIOD_MS * 1000) {
+        ret = ESP_ERR_TIMEOUT;
+    }
+
+    // Holding the lock keeps the bus busy for everyone else meanwhile
+    if (sim_config.timing) {
+        sleep_until_us(start_us + busy_us);
+    }
+    pthread_mutex_unlock(&sim_lock);
+    return ret;
+}
@@ -0,0 +1,9 @@
+#ifndef HOST_ESP_ROM_CRC_H
+#define HOST_ESP_ROM_CRC_H
+
+#include <stdint.h>
+
+// Reflected CRC-32 (IEEE), crc 0 to start; chains like the ROM routine
+uint32_t esp_rom_crc32_le(uint32_t crc, uint8_t const *buf, uint32_t len);
+
+#endif // HOST_ESP_ROM_CRC_H
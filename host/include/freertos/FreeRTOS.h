@@ -0,0 +1,46 @@
+#ifndef HOST_FREERTOS_H
+#define HOST_FREERTOS_H
+
+// Host shim: the subset of the FreeRTOS API the firmware uses, on pthreads
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <esp_attr.h>
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+
+// Matches CONFIG_FREERTOS_HZ in sdkconfig
+#define configTICK_RATE_HZ 100
+// Matches CONFIG_FREERTOS_TASK_NOTIFICATION_ARRAY_ENTRIES
+#define configTASK_NOTIFICATION_ARRAY_ENTRIES 2
+#define portTICK_PERIOD_MS (1000 / configTICK_RATE_HZ)
+#define portMAX_DELAY ((TickType_t)0xFFFFFFFF)
+#define pdMS_TO_TICKS(ms) ((TickType_t)(((uint64_t)(ms) * configTICK_RATE_HZ) / 1000))
+
+#define pdFALSE 0
+#define pdTRUE 1
+#define pdFAIL 0
+#define pdPASS 1
+
+// Every critical section shares one recursive lock; nothing in the firmware
+// holds one for longer than a few statements.
+typedef struct {
+    int unused;
+} portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED { 0 }
+
+void vPortEnterCritical(portMUX_TYPE *mux);
+void vPortExitCritical(portMUX_TYPE *mux);
+
+#define portENTER_CRITICAL(mux) vPortEnterCritical(mux)
+#define portEXIT_CRITICAL(mux) vPortExitCritical(mux)
+#define portENTER_CRITICAL_ISR(mux) vPortEnterCritical(mux)
+#define portEXIT_CRITICAL_ISR(mux) vPortExitCritical(mux)
+
+// Simulated interrupts run on their own thread, there is nothing to yield
+#define portYIELD_FROM_ISR(...) do { } while (0)
+
+#endif // HOST_FREERTOS_H
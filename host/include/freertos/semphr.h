@@ -0,0 +1,19 @@
+#ifndef HOST_FREERTOS_SEMPHR_H
+#define HOST_FREERTOS_SEMPHR_H
+
+#include "queue.h"
+
+// As in FreeRTOS, a semaphore is a queue of zero-sized items. Mutexes have no
+// priority inheritance and are not recursive.
+typedef QueueHandle_t SemaphoreHandle_t;
+
+SemaphoreHandle_t xSemaphoreCreateBinary(void);
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t max_count, UBaseType_t initial_count);
+SemaphoreHandle_t xSemaphoreCreateMutex(void);
+
+#define vSemaphoreDelete(sem) vQueueDelete(sem)
+#define xSemaphoreTake(sem, ticks) xQueueReceive((sem), NULL, (ticks))
+#define xSemaphoreGive(sem) xQueueSend((sem), NULL, 0)
+#define xSemaphoreGiveFromISR(sem, woken) xQueueSendFromISR((sem), NULL, (woken))
+
+#endif // HOST_FREERTOS_SEMPHR_H
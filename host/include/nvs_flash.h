@@ -0,0 +1,11 @@
+#ifndef HOST_NVS_FLASH_H
+#define HOST_NVS_FLASH_H
+
+#include <esp_err.h>
+#include <nvs.h>
+
+esp_err_t nvs_flash_init(void);
+esp_err_t nvs_flash_erase(void);
+esp_err_t nvs_flash_deinit(void);
+
+#endif // HOST_NVS_FLASH_H
@@ -0,0 +1,333 @@
+// NVS as a typed key/value list in memory. If HOST_NVS_FILE is set the list
+// is loaded by nvs_flash_init() and written back on every nvs_commit(), so
+// settings survive between runs like they do on flash.
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <nvs.h>
+#include <nvs_flash.h>
+#include <esp_log.h>
+
+typedef enum {
+    NVS_TYPE_U8 = 0x01,
+    NVS_TYPE_U32 = 0x04,
+    NVS_TYPE_I32 = 0x14,
+    NVS_TYPE_STR = 0x21,
+    NVS_TYPE_BLOB = 0x42
+} nvs_type_t;
+
+typedef struct {
+    char name_space[NVS_KEY_NAME_MAX_SIZE];
+    char key[NVS_KEY_NAME_MAX_SIZE];
+    uint8_t type;
+    size_t len;
+    uint8_t *data;
+} nvs_entry_t;
+
+#define NVS_MAX_HANDLES 8
+
+typedef struct {
+    bool used;
+    bool writable;
+    char name_space[NVS_KEY_NAME_MAX_SIZE];
+} nvs_open_t;
+
+static pthread_mutex_t nvs_lock = PTHREAD_MUTEX_INITIALIZER;
+static bool nvs_ready = false;
+static nvs_entry_t *nvs_entries = NULL;
+static size_t nvs_count = 0;
+static nvs_open_t nvs_handles[NVS_MAX_HANDLES];
+
+static void nvs_clear(void) {
+    for (size_t i = 0; i < nvs_count; i++) {
+        free(nvs_entries[i].data);
+    }
+    free(nvs_entries);
+    nvs_entries = NULL;
+    nvs_count = 0;
+}
+
+static nvs_entry_t *nvs_find(const char *name_space, const char *key) {
+    for (size_t i = 0; i < nvs_count; i++) {
+        if (strcmp(nvs_entries[i].name_space, name_space) == 0 && strcmp(nvs_entries[i].key, key) == 0) {
+            return &nvs_entries[i];
+        }
+    }
+    return NULL;
+}
+
+static esp_err_t nvs_store(const char *name_space, const char *key, uint8_t type, const void *data, size_t len) {
+    nvs_entry_t *entry = nvs_find(name_space, key);
+    if (entry == NULL) {
+        nvs_entry_t *entries = realloc(nvs_entries, (nvs_count + 1) * sizeof(nvs_entry_t));
+        if (entries == NULL) {
+            return ESP_ERR_NO_MEM;
+        }
+        nvs_entries = entries;
+        entry = &nvs_entries[nvs_count++];
+        memset(entry, 0, sizeof(*entry));
+        strcpy(entry->name_space, name_space);
+        strcpy(entry->key, key);
+    }
+    uint8_t *copy = malloc(len ? len : 1);
+    if (copy == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    memcpy(copy, data, len);
+    free(entry->data);
+    entry->data = copy;
+    entry->len = len;
+    entry->type = type;
+    return ESP_OK;
+}
+
+// File format: per entry namespace and key as 16-byte fields, a type byte,
+// a 32-bit length and the data.
+static void nvs_load_file(const char *path) {
+    FILE *f = fopen(path, "rb");
+    if (f == NULL) {
+        return;
+    }
+    nvs_entry_t entry;
+    uint32_t len;
+    while (fread(entry.name_space, NVS_KEY_NAME_MAX_SIZE, 1, f) == 1 &&
+           fread(entry.key, NVS_KEY_NAME_MAX_SIZE, 1, f) == 1 &&
+           fread(&entry.type, 1, 1, f) == 1 && fread(&len, sizeof(len), 1, f) == 1) {
+        uint8_t *data = malloc(len ? len : 1);
+        if (data == NULL || fread(data, 1, len, f) != len) {
+            free(data);
+            break;
+        }
+        entry.name_space[NVS_KEY_NAME_MAX_SIZE - 1] = '\0';
+        entry.key[NVS_KEY_NAME_MAX_SIZE - 1] = '\0';
+        nvs_store(entry.name_space, entry.key, entry.type, data, len);
+        free(data);
+    }
+    fclose(f);
+    ESP_LOGI("SimNVS", "Loaded %u entries from %s", (unsigned)nvs_count, path);
+}
+
+static void nvs_save_file(const char *path) {
+    FILE *f = fopen(path, "wb");
+    if (f == NULL) {
+        ESP_LOGW("SimNVS", "Could not save %s", path);
+        return;
+    }
+    for (size_t i = 0; i < nvs_count; i++) {
+        uint32_t len = (uint32_t)nvs_entries[i].len;
+        fwrite(nvs_entries[i].name_space, NVS_KEY_NAME_MAX_SIZE, 1, f);
+        fwrite(nvs_entries[i].key, NVS_KEY_NAME_MAX_SIZE, 1, f);
+        fwrite(&nvs_entries[i].type, 1, 1, f);
+        fwrite(&len, sizeof(len), 1, f);
+        fwrite(nvs_entries[i].data, 1, len, f);
+    }
+    fclose(f);
+}
+
+esp_err_t nvs_flash_init(void) {
+    pthread_mutex_lock(&nvs_lock);
+    if (!nvs_ready) {
+        const char *path = getenv("HOST_NVS_FILE");
+        if (path) {
+            nvs_load_file(path);
+        }
+        nvs_ready = true;
+    }
+    pthread_mutex_unlock(&nvs_lock);
+    return ESP_OK;
+}
+
+esp_err_t nvs_flash_erase(void) {
+    pthread_mutex_lock(&nvs_lock);
+    nvs_clear();
+    const char *path = getenv("HOST_NVS_FILE");
+    if (path) {
+        remove(path);
+    }
+    pthread_mutex_unlock(&nvs_lock);
+    return ESP_OK;
+}
+
+esp_err_t nvs_flash_deinit(void) {
+    pthread_mutex_lock(&nvs_lock);
+    nvs_ready = false;
+    pthread_mutex_unlock(&nvs_lock);
+    return ESP_OK;
+}
+
+esp_err_t nvs_open(const char *name_space, nvs_open_mode_t open_mode, nvs_handle_t *out_handle) {
+    if (name_space == NULL || strlen(name_space) >= NVS_KEY_NAME_MAX_SIZE) {
+        return ESP_ERR_NVS_INVALID_NAME;
+    }
+    esp_err_t ret = ESP_ERR_NVS_NOT_ENOUGH_SPACE;
+    pthread_mutex_lock(&nvs_lock);
+    if (!nvs_ready) {
+        ret = ESP_ERR_NVS_NOT_INITIALIZED;
+    } else {
+        for (int i = 0; i < NVS_MAX_HANDLES; i++) {
+            if (!nvs_handles[i].used) {
+                nvs_handles[i].used = true;
+                nvs_handles[i].writable = (open_mode == NVS_READWRITE);
+                strcpy(nvs_handles[i].name_space, name_space);
+                *out_handle = (nvs_handle_t)(i + 1);
+                ret = ESP_OK;
+                break;
+            }
+        }
+    }
+    pthread_mutex_unlock(&nvs_lock);
+    return ret;
+}
+
+static nvs_open_t *nvs_handle_get(nvs_handle_t handle) {
+    if (handle == 0 || handle > NVS_MAX_HANDLES || !nvs_handles[handle - 1].used) {
+        return NULL;
+    }
+    return &nvs_handles[handle - 1];
+}
+
+void nvs_close(nvs_handle_t handle) {
+    pthread_mutex_lock(&nvs_lock);
+    nvs_open_t *open = nvs_handle_get(handle);
+    if (open) {
+        open->used = false;
+    }
+    pthread_mutex_unlock(&nvs_lock);
+}
+
+esp_err_t nvs_commit(nvs_handle_t handle) {
+    esp_err_t ret = ESP_OK;
+    pthread_mutex_lock(&nvs_lock);
+    if (nvs_handle_get(handle) == NULL) {
+        ret = ESP_ERR_NVS_INVALID_HANDLE;
+    } else if (getenv("HOST_NVS_FILE")) {
+        nvs_save_file(getenv("HOST_NVS_FILE"));
+    }
+    pthread_mutex_unlock(&nvs_lock);
+    return ret;
+}
+
+static esp_err_t nvs_set(nvs_handle_t handle, const char *key, uint8_t type, const void *data, size_t len) {
+    if (key == NULL || strlen(key) >= NVS_KEY_NAME_MAX_SIZE) {
+        return ESP_ERR_NVS_KEY_TOO_LONG;
+    }
+    esp_err_t ret;
+    pthread_mutex_lock(&nvs_lock);
+    nvs_open_t *open = nvs_handle_get(handle);
+    if (open == NULL) {
+        ret = ESP_ERR_NVS_INVALID_HANDLE;
+    } else if (!open->writable) {
+        ret = ESP_ERR_NVS_READ_ONLY;
+    } else {
+        ret = nvs_store(open->name_space, key, type, data, len);
+    }
+    pthread_mutex_unlock(&nvs_lock);
+    return ret;
+}
+
+// Copy an entry out. Variable-length types follow the IDF convention:
+// out NULL asks for the length, a short buffer fails with INVALID_LENGTH.
+static esp_err_t nvs_get(nvs_handle_t handle, const char *key, uint8_t type, void *out, size_t *len,
+                         bool variable) {
+    esp_err_t ret = ESP_OK;
+    pthread_mutex_lock(&nvs_lock);
+    nvs_open_t *open = nvs_handle_get(handle);
+    nvs_entry_t *entry = open ? nvs_find(open->name_space, key) : NULL;
+    if (open == NULL) {
+        ret = ESP_ERR_NVS_INVALID_HANDLE;
+    } else if (entry == NULL) {
+        ret = ESP_ERR_NVS_NOT_FOUND;
+    } else if (entry->type != type) {
+        ret = ESP_ERR_NVS_TYPE_MISMATCH;
+    } else if (!variable) {
+        memcpy(out, entry->data, entry->len);
+    } else if (out == NULL) {
+        *len = entry->len;
+    } else if (*len < entry->len) {
+        *len = entry->len;
+        ret = ESP_ERR_NVS_INVALID_LENGTH;
+    } else {
+        memcpy(out, entry->data, entry->len);
+        *len = entry->len;
+    }
+    pthread_mutex_unlock(&nvs_lock);
+    return ret;
+}
+
+esp_err_t nvs_erase_key(nvs_handle_t handle, const char *key) {
+    esp_err_t ret = ESP_ERR_NVS_NOT_FOUND;
+    pthread_mutex_lock(&nvs_lock);
+    nvs_open_t *open = nvs_handle_get(handle);
+    nvs_entry_t *entry = open ? nvs_find(open->name_space, key) : NULL;
+    if (open == NULL) {
+        ret = ESP_ERR_NVS_INVALID_HANDLE;
+    } else if (entry) {
+        free(entry->data);
+        *entry = nvs_entries[--nvs_count];
+        ret = ESP_OK;
+    }
+    pthread_mutex_unlock(&nvs_lock);
+    return ret;
+}
+
+esp_err_t nvs_erase_all(nvs_handle_t handle) {
+    esp_err_t ret = ESP_OK;
+    pthread_mutex_lock(&nvs_lock);
+    nvs_open_t *open = nvs_handle_get(handle);
+    if (open == NULL) {
+        ret = ESP_ERR_NVS_INVALID_HANDLE;
+    } else {
+        for (size_t i = 0; i < nvs_count;) {
+            if (strcmp(nvs_entries[i].name_space, open->name_space) == 0) {
+                free(nvs_entries[i].data);
+                nvs_entries[i] = nvs_entries[--nvs_count];
+            } else {
+                i++;
+            }
+        }
+    }
+    pthread_mutex_unlock(&nvs_lock);
+    return ret;
+}
+
+esp_err_t nvs_set_u8(nvs_handle_t handle, const char *key, uint8_t value) {
+    return nvs_set(handle, key, NVS_TYPE_U8, &value, sizeof(value));
+}
+
+esp_err_t nvs_get_u8(nvs_handle_t handle, const char *key, uint8_t *out_value) {
+    return nvs_get(handle, key, NVS_TYPE_U8, out_value, NULL, false);
+}
+
+esp_err_t nvs_set_u32(nvs_handle_t handle, const char *key, uint32_t value) {
+    return nvs_set(handle, key, NVS_TYPE_U32, &value, sizeof(value));
+}
+
+esp_err_t nvs_get_u32(nvs_handle_t handle, const char *key, uint32_t *out_value) {
+    return nvs_get(handle, key, NVS_TYPE_U32, out_value, NULL, false);
+}
+
+esp_err_t nvs_set_i32(nvs_handle_t handle, const char *key, int32_t value) {
+    return nvs_set(handle, key, NVS_TYPE_I32, &value, sizeof(value));
+}
+
+esp_err_t nvs_get_i32(nvs_handle_t handle, const char *key, int32_t *out_value) {
+    return nvs_get(handle, key, NVS_TYPE_I32, out_value, NULL, false);
+}
+
+esp_err_t nvs_set_str(nvs_handle_t handle, const char *key, const char *value) {
+    return nvs_set(handle, key, NVS_TYPE_STR, value, strlen(value) + 1);
+}
+
+esp_err_t nvs_get_str(nvs_handle_t handle, const char *key, char *out_value, size_t *length) {
+    return nvs_get(handle, key, NVS_TYPE_STR, out_value, length, true);
+}
+
+esp_err_t nvs_set_blob(nvs_handle_t handle, const char *key, const void *value, size_t length) {
+    return nvs_set(handle, key, NVS_TYPE_BLOB, value, length);
+}
+
+esp_err_t nvs_get_blob(nvs_handle_t handle, const char *key, void *out_value, size_t *length) {
+    return nvs_get(handle, key, NVS_TYPE_BLOB, out_value, length, true);
+}
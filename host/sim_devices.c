@@ -0,0 +1,541 @@
+// Models of the parts on the board's I2C bus: the PCF8574 keypad expander,
+// the PCF8574 HD44780 backpack, the DS1307 RTC and the 24C32 EEPROM. Each
+// one follows its datasheet closely enough that timing and protocol
+// mistakes in the firmware show up here rather than on the bench.
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <esp_log.h>
+#include "host_sim.h"
+
+// PCF8574 keypad. Rows on P0-P3, columns on P4-P7 as in keyboard.c; a held
+// key connects its column to its row, so a row driven low pulls the column
+// low. /INT follows the datasheet: it goes low when the pins differ from
+// what the last read or write saw and is released by the next access.
+static const char sim_keypad_layout[16] = {
+    '1', '2', '3', 'A',
+    '4', '5', '6', 'B',
+    '7', '8', '9', 'C',
+    '*', '0', '#', 'D'
+};
+
+static struct {
+    i2c_sim_device_t dev;
+    int int_gpio;
+    uint8_t latch;
+    uint16_t keys;
+    uint8_t int_snapshot;
+    bool int_active;
+} keypad;
+
+static uint8_t keypad_pins(void) {
+    uint8_t pins = keypad.latch;
+    for (int bit = 0; bit < 16; bit++) {
+        if ((keypad.keys & (1u << bit)) && !(keypad.latch & (1u << (bit / 4)))) {
+            pins &= ~(1u << (4 + bit % 4));
+        }
+    }
+    return pins;
+}
+
+static void keypad_update_int(void) {
+    bool active = keypad_pins() != keypad.int_snapshot;
+    if (active != keypad.int_active) {
+        keypad.int_active = active;
+        host_gpio_drive(keypad.int_gpio, active ? 0 : 1);
+    }
+}
+
+static bool keypad_start(i2c_sim_device_t *dev, bool read) {
+    return true;
+}
+
+static bool keypad_write(i2c_sim_device_t *dev, uint8_t data) {
+    keypad.latch = data;
+    keypad.int_snapshot = keypad_pins();
+    keypad_update_int();
+    return true;
+}
+
+static uint8_t keypad_read(i2c_sim_device_t *dev) {
+    uint8_t pins = keypad_pins();
+    keypad.int_snapshot = pins;
+    keypad_update_int();
+    return pins;
+}
+
+static void keypad_stop(i2c_sim_device_t *dev) {
+}
+
+void sim_keypad_attach(uint8_t addr, int int_gpio) {
+    keypad.dev = (i2c_sim_device_t){
+        .name = "PCF8574 keypad",
+        .addr = addr,
+        .max_clk_hz = 400000,
+        .start = keypad_start,
+        .write = keypad_write,
+        .read = keypad_read,
+        .stop = keypad_stop,
+    };
+    keypad.int_gpio = int_gpio;
+    keypad.latch = 0xFF;  // Power-on state, every pin weakly high
+    keypad.int_snapshot = 0xFF;
+    i2c_sim_attach(&keypad.dev);
+}
+
+void sim_keypad_set(uint16_t keys) {
+    i2c_sim_lock();
+    keypad.keys = keys;
+    keypad_update_int();
+    i2c_sim_unlock();
+}
+
+int sim_keypad_bit(char key) {
+    for (int bit = 0; bit < 16; bit++) {
+        if (sim_keypad_layout[bit] == key) {
+            return bit;
+        }
+    }
+    return -1;
+}
+
+// HD44780 behind a PCF8574 backpack: P0 RS, P1 RW, P2 E, P3 backlight,
+// P4-P7 D4-D7. The controller latches on the falling edge of E. Instructions
+// that arrive while it is still busy are dropped and counted, exactly the
+// failure a missing delay causes on real glass.
+#define HD44780_RS 0x01
+#define HD44780_RW 0x02
+#define HD44780_E  0x04
+#define HD44780_BL 0x08
+#define HD44780_EXEC_US 37
+#define HD44780_DATA_US 41
+#define HD44780_HOME_US 1520
+#define SIM_LCD_ROWS 2
+#define SIM_LCD_COLS 16
+
+static struct {
+    i2c_sim_device_t dev;
+    uint8_t latch;
+    bool four_bit;
+    bool have_high;
+    uint8_t high;
+    uint8_t ddram[0x80];
+    uint8_t cgram[64];
+    uint8_t ac;
+    bool cgram_mode;
+    bool increment;
+    uint8_t display;        // D, C, B bits of display control
+    int64_t busy_until_us;
+    uint32_t dropped;
+    bool dirty;
+    bool echo;
+    char shown[SIM_LCD_ROWS][SIM_LCD_COLS + 1];
+    bool shown_backlight;
+} lcd;
+
+static void lcd_advance(void) {
+    if (lcd.cgram_mode) {
+        lcd.ac = (lcd.ac + (lcd.increment ? 1 : -1)) & 0x3F;
+        return;
+    }
+    // Two-line mode: line 1 is 0x00-0x27, line 2 is 0x40-0x67
+    if (lcd.increment) {
+        lcd.ac = (lcd.ac == 0x27) ? 0x40 : (lcd.ac == 0x67) ? 0x00 : lcd.ac + 1;
+    } else {
+        lcd.ac = (lcd.ac == 0x00) ? 0x67 : (lcd.ac == 0x40) ? 0x27 : lcd.ac - 1;
+    }
+}
+
+static void lcd_exec(uint8_t value, bool rs) {
+    int64_t now_us = i2c_sim_now_us();
+    if (i2c_sim_timed() && now_us < lcd.busy_until_us) {
+        if (lcd.dropped++ < 8) {
+            ESP_LOGW("SimLCD", "%s 0x%02X dropped, controller busy for another %lld us", rs ? "Data" : "Instruction",
+                     value, (long long)(lcd.busy_until_us - now_us));
+        }
+        return;
+    }
+
+    int64_t exec_us = HD44780_EXEC_US;
+    if (rs) {
+        if (lcd.cgram_mode) {
+            lcd.cgram[lcd.ac & 0x3F] = value;
+        } else {
+            lcd.ddram[lcd.ac & 0x7F] = value;
+        }
+        lcd_advance();
+        exec_us = HD44780_DATA_US;
+    } else if (value & 0x80) {
+        lcd.ac = value & 0x7F;
+        lcd.cgram_mode = false;
+    } else if (value & 0x40) {
+        lcd.ac = value & 0x3F;
+        lcd.cgram_mode = true;
+    } else if (value & 0x20) {
+        lcd.four_bit = !(value & 0x10);
+        lcd.have_high = false;
+    } else if (value & 0x10) {
+        // Cursor or display shift; only cursor moves are modelled
+        if (!(value & 0x08)) {
+            bool increment = lcd.increment;
+            lcd.increment = (value & 0x04) != 0;
+            lcd_advance();
+            lcd.increment = increment;
+        }
+    } else if (value & 0x08) {
+        lcd.display = value & 0x07;
+    } else if (value & 0x04) {
+        lcd.increment = (value & 0x02) != 0;
+    } else if (value & 0x02) {
+        lcd.ac = 0;
+        lcd.cgram_mode = false;
+        exec_us = HD44780_HOME_US;
+    } else if (value & 0x01) {
+        memset(lcd.ddram, ' ', sizeof(lcd.ddram));
+        lcd.ac = 0;
+        lcd.cgram_mode = false;
+        lcd.increment = true;
+        exec_us = HD44780_HOME_US;
+    }
+    lcd.busy_until_us = now_us + exec_us;
+    lcd.dirty = true;
+}
+
+static bool lcd_start(i2c_sim_device_t *dev, bool read) {
+    return true;
+}
+
+static bool lcd_write(i2c_sim_device_t *dev, uint8_t data) {
+    uint8_t prev = lcd.latch;
+    lcd.latch = data;
+    if ((prev & HD44780_BL) != (data & HD44780_BL)) {
+        lcd.dirty = true;
+    }
+    if (!(prev & HD44780_E) || (data & HD44780_E) || (prev & HD44780_RW)) {
+        return true;
+    }
+
+    uint8_t nibble = prev >> 4;
+    bool rs = (prev & HD44780_RS) != 0;
+    if (!lcd.four_bit) {
+        lcd_exec(nibble << 4, rs);  // D0-D3 are not wired, they read as 0
+    } else if (!lcd.have_high) {
+        lcd.high = nibble;
+        lcd.have_high = true;
+    } else {
+        lcd.have_high = false;
+        lcd_exec((lcd.high << 4) | nibble, rs);
+    }
+    return true;
+}
+
+static uint8_t lcd_read(i2c_sim_device_t *dev) {
+    return lcd.latch;
+}
+
+static void lcd_render(char rows[SIM_LCD_ROWS][SIM_LCD_COLS + 1]) {
+    for (int row = 0; row < SIM_LCD_ROWS; row++) {
+        for (int col = 0; col < SIM_LCD_COLS; col++) {
+            uint8_t c = lcd.ddram[row * 0x40 + col];
+            if (!(lcd.display & 0x04)) {
+                c = ' ';
+            } else if (c < 0x08) {
+                c = '#';  // CGRAM glyph
+            } else if (c < 0x20 || c > 0x7E) {
+                c = '?';
+            }
+            rows[row][col] = (char)c;
+        }
+        rows[row][SIM_LCD_COLS] = '\0';
+    }
+}
+
+static void lcd_print_locked(void) {
+    char rows[SIM_LCD_ROWS][SIM_LCD_COLS + 1];
+    lcd_render(rows);
+    ESP_LOGI("SimLCD", "|%s| |%s|%s", rows[0], rows[1], (lcd.latch & HD44780_BL) ? "" : " (backlight off)");
+}
+
+static void lcd_stop(i2c_sim_device_t *dev) {
+    if (!lcd.dirty) {
+        return;
+    }
+    lcd.dirty = false;
+
+    char rows[SIM_LCD_ROWS][SIM_LCD_COLS + 1];
+    lcd_render(rows);
+    bool backlight = (lcd.latch & HD44780_BL) != 0;
+    if (memcmp(rows, lcd.shown, sizeof(rows)) == 0 && backlight == lcd.shown_backlight) {
+        return;
+    }
+    memcpy(lcd.shown, rows, sizeof(rows));
+    lcd.shown_backlight = backlight;
+    if (lcd.echo) {
+        lcd_print_locked();
+    }
+}
+
+void sim_lcd_attach(uint8_t addr) {
+    lcd.dev = (i2c_sim_device_t){
+        .name = "HD44780 backpack",
+        .addr = addr,
+        .max_clk_hz = 400000,
+        .start = lcd_start,
+        .write = lcd_write,
+        .read = lcd_read,
+        .stop = lcd_stop,
+    };
+    // Power-on reset: 8-bit interface, display off, DDRAM holding spaces
+    lcd.latch = 0xFF;
+    lcd.increment = true;
+    memset(lcd.ddram, ' ', sizeof(lcd.ddram));
+    i2c_sim_attach(&lcd.dev);
+}
+
+void sim_lcd_print(void) {
+    i2c_sim_lock();
+    lcd_print_locked();
+    if (lcd.dropped) {
+        ESP_LOGW("SimLCD", "%lu writes dropped while busy", (unsigned long)lcd.dropped);
+    }
+    i2c_sim_unlock();
+}
+
+void sim_lcd_set_echo(bool on) {
+    lcd.echo = on;
+}
+
+// DS1307. Registers 0x00-0x06 hold BCD time, 0x07 is control and
+// 0x08-0x3F are battery-backed RAM; the register pointer wraps at 0x3F.
+// Time is latched into the registers at every START, as the chip copies
+// its counters into a user buffer then, and a write to any time register
+// restarts the count from the written value.
+#define DS1307_REGS 64
+
+static struct {
+    i2c_sim_device_t dev;
+    uint8_t regs[DS1307_REGS];
+    uint8_t ptr;
+    bool have_ptr;
+    bool time_written;
+    time_t base;          // Calendar time at base_us
+    int64_t base_us;
+} rtc;
+
+static uint8_t to_bcd(int value) {
+    return (uint8_t)(((value / 10) << 4) | (value % 10));
+}
+
+static int from_bcd(uint8_t value) {
+    return (value >> 4) * 10 + (value & 0x0F);
+}
+
+static bool rtc_halted(void) {
+    return (rtc.regs[0] & 0x80) != 0;
+}
+
+static void rtc_latch(void) {
+    if (rtc_halted()) {
+        return;
+    }
+    time_t now = rtc.base + (time_t)((i2c_sim_now_us() - rtc.base_us) / 1000000);
+    struct tm tm;
+    gmtime_r(&now, &tm);
+    rtc.regs[0] = to_bcd(tm.tm_sec);
+    rtc.regs[1] = to_bcd(tm.tm_min);
+    rtc.regs[2] = to_bcd(tm.tm_hour);  // 24 hour mode
+    rtc.regs[3] = (uint8_t)(tm.tm_wday + 1);
+    rtc.regs[4] = to_bcd(tm.tm_mday);
+    rtc.regs[5] = to_bcd(tm.tm_mon + 1);
+    rtc.regs[6] = to_bcd(tm.tm_year % 100);
+}
+
+// Restart the count from whatever is in the time registers
+static void rtc_reload(void) {
+    if (rtc.regs[2] & 0x40) {
+        ESP_LOGW("SimRTC", "12 hour mode is not modelled, hours taken as 24 hour");
+    }
+    struct tm tm = {
+        .tm_sec = from_bcd(rtc.regs[0] & 0x7F),
+        .tm_min = from_bcd(rtc.regs[1] & 0x7F),
+        .tm_hour = from_bcd(rtc.regs[2] & 0x3F),
+        .tm_mday = from_bcd(rtc.regs[4] & 0x3F),
+        .tm_mon = from_bcd(rtc.regs[5] & 0x1F) - 1,
+        .tm_year = from_bcd(rtc.regs[6]) + 100,
+    };
+    rtc.base = timegm(&tm);
+    rtc.base_us = i2c_sim_now_us();
+}
+
+static bool rtc_start(i2c_sim_device_t *dev, bool read) {
+    rtc_latch();
+    rtc.have_ptr = read;
+    return true;
+}
+
+static bool rtc_write(i2c_sim_device_t *dev, uint8_t data) {
+    if (!rtc.have_ptr) {
+        rtc.ptr = data & (DS1307_REGS - 1);
+        rtc.have_ptr = true;
+        return true;
+    }
+    if (rtc.ptr < 7) {
+        rtc.time_written = true;
+    }
+    rtc.regs[rtc.ptr] = data;
+    rtc.ptr = (rtc.ptr + 1) & (DS1307_REGS - 1);
+    return true;
+}
+
+static uint8_t rtc_read(i2c_sim_device_t *dev) {
+    uint8_t data = rtc.regs[rtc.ptr];
+    rtc.ptr = (rtc.ptr + 1) & (DS1307_REGS - 1);
+    return data;
+}
+
+static void rtc_stop(i2c_sim_device_t *dev) {
+    if (rtc.time_written) {
+        rtc.time_written = false;
+        rtc_reload();
+    }
+}
+
+void sim_ds1307_attach(uint8_t addr) {
+    rtc.dev = (i2c_sim_device_t){
+        .name = "DS1307",
+        .addr = addr,
+        .max_clk_hz = 100000,
+        .start = rtc_start,
+        .write = rtc_write,
+        .read = rtc_read,
+        .stop = rtc_stop,
+    };
+    // Running and set to the host's local time, as if set earlier
+    time_t now = time(NULL);
+    struct tm tm;
+    localtime_r(&now, &tm);
+    rtc.base = timegm(&tm);
+    rtc.base_us = i2c_sim_now_us();
+    rtc.regs[7] = 0x03;  // SQWE off, RS1/RS0 as shipped
+    i2c_sim_attach(&rtc.dev);
+}
+
+// 24C32: 4 KiB in 32-byte pages. A write latches a 12-bit address and then
+// fills the page buffer, wrapping inside the page; STOP starts a 5 ms write
+// cycle during which the part does not ACK its address. Reads continue
+// from the address counter and roll over at the end of memory.
+#define EEPROM_SIZE 4096
+#define EEPROM_PAGE 32
+#define EEPROM_WRITE_CYCLE_US 5000
+
+static struct {
+    i2c_sim_device_t dev;
+    uint8_t mem[EEPROM_SIZE];
+    uint8_t page[EEPROM_PAGE];
+    uint16_t page_base;    // Page the current write lands in
+    uint32_t page_mask;    // Bytes of page[] written in this transaction
+    uint16_t addr;
+    int addr_bytes;        // Address bytes still expected after a write START
+    bool writing;
+    size_t data_bytes;
+    int64_t busy_until_us;
+    uint32_t pages_written;
+    uint32_t page_wraps;
+    const char *backing_file;
+} eeprom;
+
+static void eeprom_save(void) {
+    if (eeprom.backing_file == NULL) {
+        return;
+    }
+    FILE *f = fopen(eeprom.backing_file, "wb");
+    if (f == NULL || fwrite(eeprom.mem, 1, EEPROM_SIZE, f) != EEPROM_SIZE) {
+        ESP_LOGW("SimEEPROM", "Could not save %s", eeprom.backing_file);
+    }
+    if (f) {
+        fclose(f);
+    }
+}
+
+static bool eeprom_start(i2c_sim_device_t *dev, bool read) {
+    if (i2c_sim_timed() && i2c_sim_now_us() < eeprom.busy_until_us) {
+        return false;  // Write cycle in progress
+    }
+    eeprom.writing = !read;
+    eeprom.addr_bytes = read ? 0 : 2;
+    eeprom.page_mask = 0;
+    eeprom.data_bytes = 0;
+    return true;
+}
+
+static bool eeprom_write(i2c_sim_device_t *dev, uint8_t data) {
+    if (eeprom.addr_bytes == 2) {
+        eeprom.addr = (uint16_t)((data & 0x0F) << 8);
+        eeprom.addr_bytes--;
+        return true;
+    }
+    if (eeprom.addr_bytes == 1) {
+        eeprom.addr |= data;
+        eeprom.addr_bytes--;
+        return true;
+    }
+
+    uint16_t offset = eeprom.addr & (EEPROM_PAGE - 1);
+    if (eeprom.data_bytes == 0) {
+        eeprom.page_base = eeprom.addr & ~(EEPROM_PAGE - 1);
+        memcpy(eeprom.page, &eeprom.mem[eeprom.page_base], EEPROM_PAGE);
+    }
+    if (eeprom.page_mask & (1u << offset)) {
+        if (eeprom.page_wraps++ < 8) {
+            ESP_LOGW("SimEEPROM", "Write wrapped inside page 0x%03X, byte %u overwritten", eeprom.page_base,
+                     (unsigned)offset);
+        }
+        eeprom.page_mask = 0;  // Report each lap once
+    }
+    eeprom.page[offset] = data;
+    eeprom.page_mask |= 1u << offset;
+    eeprom.data_bytes++;
+    eeprom.addr = eeprom.page_base | ((offset + 1) & (EEPROM_PAGE - 1));
+    return true;
+}
+
+static uint8_t eeprom_read(i2c_sim_device_t *dev) {
+    uint8_t data = eeprom.mem[eeprom.addr];
+    eeprom.addr = (eeprom.addr + 1) & (EEPROM_SIZE - 1);
+    return data;
+}
+
+static void eeprom_stop(i2c_sim_device_t *dev) {
+    if (!eeprom.writing || eeprom.data_bytes == 0) {
+        eeprom.writing = false;
+        return;
+    }
+    memcpy(&eeprom.mem[eeprom.page_base], eeprom.page, EEPROM_PAGE);
+    eeprom.writing = false;
+    eeprom.pages_written++;
+    eeprom.busy_until_us = i2c_sim_now_us() + EEPROM_WRITE_CYCLE_US;
+    eeprom_save();
+}
+
+void sim_eeprom_attach(uint8_t addr, const char *backing_file) {
+    eeprom.dev = (i2c_sim_device_t){
+        .name = "24C32",
+        .addr = addr,
+        .max_clk_hz = 400000,
+        .start = eeprom_start,
+        .write = eeprom_write,
+        .read = eeprom_read,
+        .stop = eeprom_stop,
+    };
+    memset(eeprom.mem, 0xFF, sizeof(eeprom.mem));  // Erased state
+    eeprom.backing_file = backing_file;
+    if (backing_file) {
+        FILE *f = fopen(backing_file, "rb");
+        if (f) {
+            size_t n = fread(eeprom.mem, 1, EEPROM_SIZE, f);
+            fclose(f);
+            ESP_LOGI("SimEEPROM", "Loaded %u bytes from %s", (unsigned)n, backing_file);
+        }
+    }
+    i2c_sim_attach(&eeprom.dev);
+}
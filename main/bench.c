@@ -0,0 +1,218 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include "bench.h"
+#include "decimal.h"
+#include "i2c_bus.h"
+#include "keyboard.h"
+#include "lcd.h"
+
+#define BENCH_ITERATIONS 20
+// Every store rewrites the RTC and an EEPROM page, keep the wear down
+#define BENCH_STORAGE_ITERATIONS 5
+#define BENCH_LCD_TIMEOUT_MS 1000
+#define BENCH_DECIMAL_ROUNDS 100
+
+// Two lines that differ in every cell, so each redraw sends a whole row
+static const char *bench_text[2] = { "0123456789ABCDEF", "FEDCBA9876543210" };
+
+// Entries for a one-place decimal limited to 0.0-999.9, as typed on the keypad
+static const char *const bench_decimal_text[] = { "280.0", "180.5", "9.9", "1.05", "999.9", "1234.5", "0", "12.25" };
+#define BENCH_DECIMAL_SAMPLES (sizeof(bench_decimal_text) / sizeof(bench_decimal_text[0]))
+
+static volatile bool bench_finished = false;
+
+typedef struct {
+    int64_t wall_us;
+    uint64_t bytes;
+    uint32_t transactions;
+    uint64_t busy_us;
+    uint64_t wait_us;
+} bench_totals_t;
+
+typedef void (*bench_op_t)(int iteration);
+
+static void bench_snapshot(bench_totals_t *totals) {
+    *totals = (bench_totals_t){ 0 };
+    for (int dev = 0; dev < I2C_BUS_DEV_COUNT; dev++) {
+        i2c_bus_stats_t stats;
+        i2c_bus_get_stats(dev, &stats);
+        totals->bytes += stats.bytes;
+        totals->transactions += stats.transactions;
+        totals->busy_us += stats.total_busy_us;
+        totals->wait_us += stats.total_wait_us;
+    }
+    totals->wall_us = esp_timer_get_time();
+}
+
+// Run op iterations times. setup runs before each iteration and is not
+// counted, it puts the device into the state op expects.
+static void bench_measure(const char *name, bench_op_t setup, bench_op_t op, int iterations) {
+    bench_totals_t sum = { 0 };
+    int64_t wall_min_us = INT64_MAX;
+    int64_t wall_max_us = 0;
+
+    for (int i = 0; i < iterations; i++) {
+        if (setup) {
+            setup(i);
+        }
+        bench_totals_t before, after;
+        bench_snapshot(&before);
+        op(i);
+        bench_snapshot(&after);
+
+        int64_t wall_us = after.wall_us - before.wall_us;
+        sum.wall_us += wall_us;
+        sum.bytes += after.bytes - before.bytes;
+        sum.transactions += after.transactions - before.transactions;
+        sum.busy_us += after.busy_us - before.busy_us;
+        sum.wait_us += after.wait_us - before.wait_us;
+        if (wall_us < wall_min_us) {
+            wall_min_us = wall_us;
+        }
+        if (wall_us > wall_max_us) {
+            wall_max_us = wall_us;
+        }
+    }
+
+    printf("bench,%s,%d,%lld,%lld,%lld,%llu,%lu,%llu,%llu\n", name, iterations,
+           (long long)(sum.wall_us / iterations), (long long)wall_min_us, (long long)wall_max_us,
+           (unsigned long long)(sum.bytes / iterations), (unsigned long)(sum.transactions / iterations),
+           (unsigned long long)(sum.busy_us / iterations), (unsigned long long)(sum.wait_us / iterations));
+}
+
+static void bench_lcd_wait(void) {
+    if (!lcd_sync(BENCH_LCD_TIMEOUT_MS / portTICK_PERIOD_MS)) {
+        ESP_LOGW("Bench", "LCD did not settle");
+    }
+}
+
+static void bench_fill_screen(int iteration) {
+    lcd_set_line(0, "%s", bench_text[0]);
+    lcd_set_line(1, "%s", bench_text[1]);
+    bench_lcd_wait();
+}
+
+static void bench_lcd_clear(int iteration) {
+    lcd_clear();
+    bench_lcd_wait();
+}
+
+static void bench_lcd_line(int iteration) {
+    lcd_set_line(0, "%s", bench_text[iteration % 2]);
+    bench_lcd_wait();
+}
+
+static void bench_lcd_screen(int iteration) {
+    lcd_set_line(0, "%s", bench_text[iteration % 2]);
+    lcd_set_line(1, "%s", bench_text[(iteration + 1) % 2]);
+    bench_lcd_wait();
+}
+
+static void bench_keypad_scan(int iteration) {
+    uint8_t raw[5];
+    keypad_scan_raw(raw);
+}
+
+static void bench_load_all(int iteration) {
+    load_all_parameters();
+}
+
+static void bench_store_all(int iteration) {
+    store_all_parameters();
+}
+
+static volatile int bench_sink;
+
+// Next and previous from every parameter in the table
+static void bench_param_navigate(int iteration) {
+    int sum = 0;
+    for (int i = 0; i < NUM_PARAMETERS; i++) {
+        sum += find_next_param_in_category(i) + find_prev_param_in_category(i);
+    }
+    bench_sink = sum;
+}
+
+// Search for every number that can be typed
+static void bench_param_jump(int iteration) {
+    int sum = 0;
+    for (int number = 1; number <= PARAM_ADDRESS_MAX; number++) {
+        sum += find_param_by_number(number);
+    }
+    bench_sink = sum;
+}
+
+// Parse, range check and format every sample with the fixed-point routines
+static void bench_decimal_fixed(int iteration) {
+    char out[16];
+    int in_range = 0;
+    for (int round = 0; round < BENCH_DECIMAL_ROUNDS; round++) {
+        for (size_t i = 0; i < BENCH_DECIMAL_SAMPLES; i++) {
+            decimal_t value = 0;
+            if (decimal_parse(bench_decimal_text[i], 1, &value) && value >= 0 && value <= 9999) {
+                in_range++;
+            }
+            decimal_format(value, 1, out, sizeof(out));
+        }
+    }
+    bench_sink = in_range + out[0];
+}
+
+// The same through atof(), double limits and a "%.*f" format built at run
+// time, the way decimals were validated before
+static void bench_decimal_double(int iteration) {
+    char format[8];
+    char out[16];
+    int in_range = 0;
+    for (int round = 0; round < BENCH_DECIMAL_ROUNDS; round++) {
+        for (size_t i = 0; i < BENCH_DECIMAL_SAMPLES; i++) {
+            double value = atof(bench_decimal_text[i]);
+            if (value >= 0.0 - 0.05 && value <= 999.9 + 0.05) {
+                in_range++;
+            }
+            snprintf(format, sizeof(format), "%%.%df", 1);
+            snprintf(out, sizeof(out), format, value);
+        }
+    }
+    bench_sink = in_range + out[0];
+}
+
+void bench_run(void) {
+    ESP_LOGI("Bench", "Running benchmarks, %d parameters", NUM_PARAMETERS);
+    bench_lcd_wait();
+    // Full-screen redraw at 100 kHz vs 400 kHz, to the log
+    lcd_measure_refresh();
+    bench_lcd_wait();
+
+    printf("bench,op,iterations,wall_avg_us,wall_min_us,wall_max_us,bytes,transactions,bus_busy_us,bus_wait_us\n");
+    bench_measure("lcd_clear", bench_fill_screen, bench_lcd_clear, BENCH_ITERATIONS);
+    bench_measure("lcd_line", NULL, bench_lcd_line, BENCH_ITERATIONS);
+    bench_measure("lcd_screen", NULL, bench_lcd_screen, BENCH_ITERATIONS);
+    bench_measure("keypad_scan", NULL, bench_keypad_scan, BENCH_ITERATIONS);
+    // Load first, store needs every value in place
+    bench_measure("load_all_parameters", NULL, bench_load_all, BENCH_STORAGE_ITERATIONS);
+    bench_measure("store_all_parameters", NULL, bench_store_all, BENCH_STORAGE_ITERATIONS);
+    bench_measure("param_navigate", NULL, bench_param_navigate, BENCH_ITERATIONS);
+    bench_measure("param_jump", NULL, bench_param_jump, BENCH_ITERATIONS);
+    bench_measure("decimal_fixed", NULL, bench_decimal_fixed, BENCH_ITERATIONS);
+    bench_measure("decimal_double", NULL, bench_decimal_double, BENCH_ITERATIONS);
+    fflush(stdout);
+
+    lcd_clear();
+    ESP_LOGI("Bench", "Benchmarks done");
+    bench_finished = true;
+}
+
+bool bench_wait_done(TickType_t timeout_ticks) {
+    TickType_t start = xTaskGetTickCount();
+    while (!bench_finished) {
+        if (timeout_ticks != portMAX_DELAY && xTaskGetTickCount() - start >= timeout_ticks) {
+            return false;
+        }
+        vTaskDelay(1);
+    }
+    return true;
+}
@@ -0,0 +1,30 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stdbool.h>
+#include <freertos/FreeRTOS.h>
+
+// Bus-time benchmarks for the LCD, keypad and parameter storage paths.
+// bench_run() needs the bus, LCD and keypad initialised and should run
+// before the UI tasks start, so nothing else competes for the bus. It
+// prints one CSV line per operation, all starting with "bench,":
+//
+//   bench,op,iterations,wall_avg_us,wall_min_us,wall_max_us,bytes,transactions,bus_busy_us,bus_wait_us
+//
+// The last four columns are per iteration. bus_busy_us is the time the bus
+// manager held the port for the operation, bus_wait_us the time its
+// transactions sat in the queue. main.c calls it when built with APP_BENCH.
+//
+// param_navigate is one next and one previous step from every parameter,
+// param_jump a search for every number up to PARAM_ADDRESS_MAX. Neither
+// touches the bus; with load_all_parameters they show how the parameter
+// engine scales when built with PARAM_BENCH_HUNDREDS. decimal_fixed and
+// decimal_double parse, range check and format the same 800 decimal entries
+// with decimal.h and with atof()/double/printf("%f") respectively.
+void bench_run(void);
+
+// For harnesses that start the firmware: true once bench_run() has printed
+// its table
+bool bench_wait_done(TickType_t timeout_ticks);
+
+#endif // BENCH_H
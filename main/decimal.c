@@ -0,0 +1,77 @@
+#include <ctype.h>
+#include <stdio.h>
+#include "decimal.h"
+
+static uint32_t decimal_scale(int places) {
+    uint32_t scale = 1;
+    for (int i = 0; i < places; i++) {
+        scale *= 10;
+    }
+    return scale;
+}
+
+bool decimal_parse(const char *text, int places, decimal_t *out) {
+    if (places < 0 || places > DECIMAL_MAX_PLACES) {
+        return false;
+    }
+
+    bool negative = (*text == '-');
+    if (negative) {
+        text++;
+    }
+
+    int64_t acc = 0;
+    int frac_digits = 0;
+    bool point = false;
+    bool any_digit = false;
+    bool round_up = false;
+    bool rounded = false;
+    for (; *text != '\0'; text++) {
+        if (*text == '.' && !point) {
+            point = true;
+        } else if (isdigit((unsigned char)*text)) {
+            int digit = *text - '0';
+            any_digit = true;
+            if (!point || frac_digits < places) {
+                acc = acc * 10 + digit;
+                frac_digits += point ? 1 : 0;
+                if (acc > INT32_MAX) {
+                    return false;
+                }
+            } else if (!rounded) {
+                round_up = digit >= 5;
+                rounded = true;
+            }
+        } else {
+            return false;
+        }
+    }
+    if (!any_digit) {
+        return false;
+    }
+
+    acc *= decimal_scale(places - frac_digits);
+    if (round_up) {
+        acc++;
+    }
+    if (acc > INT32_MAX) {
+        return false;
+    }
+    *out = negative ? -(decimal_t)acc : (decimal_t)acc;
+    return true;
+}
+
+void decimal_format(decimal_t value, int places, char *out, size_t out_size) {
+    uint32_t magnitude = value < 0 ? -(uint32_t)value : (uint32_t)value;
+    const char *sign = value < 0 ? "-" : "";
+    if (places <= 0) {
+        snprintf(out, out_size, "%s%lu", sign, (unsigned long)magnitude);
+        return;
+    }
+    if (places > DECIMAL_MAX_PLACES) {
+        places = DECIMAL_MAX_PLACES;
+    }
+    uint32_t scale = decimal_scale(places);
+    snprintf(out, out_size, "%s%lu.%0*lu", sign, (unsigned long)(magnitude / scale), places,
+             (unsigned long)(magnitude % scale));
+}
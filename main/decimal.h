@@ -0,0 +1,26 @@
+#ifndef DECIMAL_H
+#define DECIMAL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Fixed-point decimals. A value with places digits after the point is held
+// as an integer scaled by 10^places, so 280.0 with one place is 2800, and
+// ranges are checked on the scaled integers directly. Nothing here uses
+// floating point: the ESP32 FPU is single precision only and double is
+// emulated in software.
+typedef int32_t decimal_t;
+
+// Most digits after the point; 10^places still fits in 32 bits
+#define DECIMAL_MAX_PLACES 9
+
+// "[-]digits[.digits]" to a decimal with places digits after the point.
+// Digits past places round half away from zero, as printf("%.*f") did.
+// False if text is not such a number or the result does not fit.
+bool decimal_parse(const char *text, int places, decimal_t *out);
+
+// Display form with exactly places digits after the point: "-12.5", "280.0"
+void decimal_format(decimal_t value, int places, char *out, size_t out_size);
+
+#endif // DECIMAL_H
@@ -0,0 +1,319 @@
+#include <string.h>
+#include <driver/i2c.h>
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
+#include "i2c_bus.h"
+
+#define I2C_BUS_DEFAULT_TIMEOUT_MS 1000
+#define I2C_BUS_QUEUE_LEN 8
+#define I2C_BUS_TASK_STACK 3072
+// Above every device user, so a queued transaction starts as soon as the
+// previous one leaves the wire
+#define I2C_BUS_TASK_PRIORITY 10
+
+// Completion is signalled on its own notification index. Index 0 belongs to
+// the callers, param_flush_task for one wakes on it, and a notification
+// there must neither end a transfer early nor be swallowed by one.
+#define I2C_BUS_NOTIFY_INDEX 1
+#if configTASK_NOTIFICATION_ARRAY_ENTRIES <= I2C_BUS_NOTIFY_INDEX
+#error "i2c_bus needs CONFIG_FREERTOS_TASK_NOTIFICATION_ARRAY_ENTRIES of at least 2"
+#endif
+
+// Lives on the caller's stack; the caller stays blocked until the bus task
+// has filled in result and notified it.
+typedef struct {
+    const i2c_bus_transaction_t *txn;
+    TaskHandle_t caller;
+    int64_t queued_us;
+    esp_err_t result;
+} i2c_bus_request_t;
+
+static i2c_port_t bus_port;
+static i2c_config_t bus_conf;
+static uint32_t bus_default_hz;
+static uint32_t bus_current_hz;
+static uint32_t bus_device_hz[I2C_BUS_DEV_COUNT];  // 0 means bus_default_hz
+static uint32_t bus_clock_switches = 0;
+static QueueHandle_t bus_queue[2] = {NULL, NULL}; // Indexed by i2c_bus_priority_t
+static SemaphoreHandle_t bus_work = NULL;         // One count per queued request
+
+static i2c_bus_stats_t bus_stats[I2C_BUS_DEV_COUNT];
+static portMUX_TYPE bus_stats_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static const char *bus_device_names[I2C_BUS_DEV_COUNT] = {
+    "keypad",
+    "lcd",
+    "rtc",
+    "eeprom",
+};
+
+// Reprogram SCL for the device about to use the bus. Slow devices such as the
+// DS1307 get their own rate without holding everyone else back to it.
+static esp_err_t i2c_bus_select_clock(i2c_bus_device_t device) {
+    uint32_t clk_hz = (device < I2C_BUS_DEV_COUNT && bus_device_hz[device]) ? bus_device_hz[device] : bus_default_hz;
+    if (clk_hz == bus_current_hz) {
+        return ESP_OK;
+    }
+
+    bus_conf.master.clk_speed = clk_hz;
+    esp_err_t ret = i2c_param_config(bus_port, &bus_conf);
+    if (ret != ESP_OK) {
+        ESP_LOGE("I2C", "Failed to switch SCL to %lu Hz: %s", (unsigned long)clk_hz, esp_err_to_name(ret));
+        bus_current_hz = 0; // Unknown, force a reprogram next time
+        return ret;
+    }
+    bus_current_hz = clk_hz;
+    bus_clock_switches++;
+    return ESP_OK;
+}
+
+static esp_err_t i2c_bus_execute(const i2c_bus_transaction_t *txn) {
+    esp_err_t ret = i2c_bus_select_clock(txn->device);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    i2c_cmd_handle_t cmd = i2c_cmd_link_create();
+    if (cmd == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    for (size_t i = 0; i < txn->segment_count; i++) {
+        const i2c_bus_segment_t *seg = &txn->segments[i];
+        bool new_phase = (i == 0) || (txn->segments[i - 1].op != seg->op);
+        bool last_in_phase = (i + 1 == txn->segment_count) || (txn->segments[i + 1].op != seg->op);
+
+        if (new_phase) {
+            i2c_master_start(cmd);
+            i2c_master_write_byte(cmd, (txn->addr << 1) | (seg->op == I2C_BUS_READ ? I2C_MASTER_READ : I2C_MASTER_WRITE), true);
+        }
+        if (seg->len == 0) {
+            continue;
+        }
+        if (seg->op == I2C_BUS_WRITE) {
+            i2c_master_write(cmd, seg->tx, seg->len, true);
+        } else {
+            // NACK the final byte of a read phase so the slave lets go of SDA
+            i2c_master_read(cmd, seg->rx, seg->len, last_in_phase ? I2C_MASTER_LAST_NACK : I2C_MASTER_ACK);
+        }
+    }
+    i2c_master_stop(cmd);
+
+    uint32_t timeout_ms = txn->timeout_ms ? txn->timeout_ms : I2C_BUS_DEFAULT_TIMEOUT_MS;
+    ret = i2c_master_cmd_begin(bus_port, cmd, timeout_ms / portTICK_PERIOD_MS);
+    i2c_cmd_link_delete(cmd);
+    return ret;
+}
+
+// Bytes a transaction puts on the wire: one address byte per phase plus data
+static size_t i2c_bus_wire_bytes(const i2c_bus_transaction_t *txn) {
+    size_t bytes = 0;
+    for (size_t i = 0; i < txn->segment_count; i++) {
+        if (i == 0 || txn->segments[i - 1].op != txn->segments[i].op) {
+            bytes++;
+        }
+        bytes += txn->segments[i].len;
+    }
+    return bytes;
+}
+
+static void i2c_bus_record(const i2c_bus_transaction_t *txn, esp_err_t ret, int64_t wait_us, int64_t busy_us) {
+    i2c_bus_device_t device = txn->device;
+    if (device >= I2C_BUS_DEV_COUNT) {
+        return;
+    }
+
+    portENTER_CRITICAL(&bus_stats_lock);
+    i2c_bus_stats_t *stats = &bus_stats[device];
+    stats->transactions++;
+    stats->bytes += i2c_bus_wire_bytes(txn);
+    if (ret != ESP_OK) {
+        stats->errors++;
+    }
+    stats->total_wait_us += wait_us;
+    stats->total_busy_us += busy_us;
+    if (wait_us > stats->max_wait_us) {
+        stats->max_wait_us = wait_us;
+    }
+    if (busy_us > stats->max_busy_us) {
+        stats->max_busy_us = busy_us;
+    }
+    portEXIT_CRITICAL(&bus_stats_lock);
+}
+
+// Sole owner of the port. Always drains the high priority queue first, so a
+// keypad scan waits for at most the one transaction already on the wire.
+static void i2c_bus_task(void *pvParameters) {
+    i2c_bus_request_t *req;
+    while (1) {
+        xSemaphoreTake(bus_work, portMAX_DELAY);
+        if (xQueueReceive(bus_queue[I2C_BUS_PRIO_HIGH], &req, 0) != pdTRUE &&
+            xQueueReceive(bus_queue[I2C_BUS_PRIO_NORMAL], &req, 0) != pdTRUE) {
+            continue;
+        }
+
+        int64_t start_us = esp_timer_get_time();
+        req->result = i2c_bus_execute(req->txn);
+        int64_t end_us = esp_timer_get_time();
+
+        i2c_bus_record(req->txn, req->result, start_us - req->queued_us, end_us - start_us);
+        xTaskNotifyGiveIndexed(req->caller, I2C_BUS_NOTIFY_INDEX);
+    }
+}
+
+esp_err_t i2c_bus_init(i2c_port_t port, int sda_io, int scl_io, uint32_t clk_hz) {
+    i2c_config_t conf = {
+        .mode = I2C_MODE_MASTER,
+        .sda_io_num = sda_io,
+        .scl_io_num = scl_io,
+        .sda_pullup_en = GPIO_PULLUP_ENABLE,
+        .scl_pullup_en = GPIO_PULLUP_ENABLE,
+        .master.clk_speed = clk_hz
+    };
+    esp_err_t ret = i2c_param_config(port, &conf);
+    if (ret == ESP_OK) {
+        ret = i2c_driver_install(port, conf.mode, 0, 0, 0);
+    }
+    if (ret != ESP_OK) {
+        ESP_LOGE("I2C", "Failed to configure port %d: %s", port, esp_err_to_name(ret));
+        return ret;
+    }
+    bus_port = port;
+    bus_conf = conf;
+    bus_default_hz = clk_hz;
+    bus_current_hz = clk_hz;
+
+    bus_queue[I2C_BUS_PRIO_HIGH] = xQueueCreate(I2C_BUS_QUEUE_LEN, sizeof(i2c_bus_request_t *));
+    bus_queue[I2C_BUS_PRIO_NORMAL] = xQueueCreate(I2C_BUS_QUEUE_LEN, sizeof(i2c_bus_request_t *));
+    bus_work = xSemaphoreCreateCounting(2 * I2C_BUS_QUEUE_LEN, 0);
+    if (bus_queue[I2C_BUS_PRIO_HIGH] == NULL || bus_queue[I2C_BUS_PRIO_NORMAL] == NULL || bus_work == NULL) {
+        ESP_LOGE("I2C", "Failed to create bus queues");
+        return ESP_ERR_NO_MEM;
+    }
+    if (xTaskCreate(i2c_bus_task, "i2c_bus", I2C_BUS_TASK_STACK, NULL, I2C_BUS_TASK_PRIORITY, NULL) != pdPASS) {
+        ESP_LOGE("I2C", "Failed to create bus task");
+        return ESP_ERR_NO_MEM;
+    }
+
+    ESP_LOGI("I2C", "Initialized I2C on port %d, SDA: %d, SCL: %d, %lu Hz", port, sda_io, scl_io, (unsigned long)clk_hz);
+    return ESP_OK;
+}
+
+esp_err_t i2c_bus_transfer(const i2c_bus_transaction_t *txn) {
+    if (bus_work == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    i2c_bus_request_t req = {
+        .txn = txn,
+        .caller = xTaskGetCurrentTaskHandle(),
+        .queued_us = esp_timer_get_time(),
+        .result = ESP_FAIL,
+    };
+    i2c_bus_request_t *req_ptr = &req;
+    QueueHandle_t queue = bus_queue[txn->priority == I2C_BUS_PRIO_HIGH ? I2C_BUS_PRIO_HIGH : I2C_BUS_PRIO_NORMAL];
+
+    // Only the bus task gives on this index, once per request, so the wait
+    // ends exactly when req is no longer in use
+    xQueueSend(queue, &req_ptr, portMAX_DELAY);
+    xSemaphoreGive(bus_work);
+    ulTaskNotifyTakeIndexed(I2C_BUS_NOTIFY_INDEX, pdTRUE, portMAX_DELAY);
+    return req.result;
+}
+
+esp_err_t i2c_bus_write(i2c_bus_device_t device, uint8_t addr, const uint8_t *data, size_t len, uint32_t timeout_ms) {
+    i2c_bus_segment_t seg = { .op = I2C_BUS_WRITE, .tx = data, .len = len };
+    i2c_bus_transaction_t txn = {
+        .device = device,
+        .addr = addr,
+        .priority = I2C_BUS_PRIO_NORMAL,
+        .segments = &seg,
+        .segment_count = 1,
+        .timeout_ms = timeout_ms,
+    };
+    return i2c_bus_transfer(&txn);
+}
+
+esp_err_t i2c_bus_write_reg(i2c_bus_device_t device, uint8_t addr, const uint8_t *reg, size_t reg_len,
+                            const uint8_t *data, size_t len, uint32_t timeout_ms) {
+    i2c_bus_segment_t segs[2] = {
+        { .op = I2C_BUS_WRITE, .tx = reg, .len = reg_len },
+        { .op = I2C_BUS_WRITE, .tx = data, .len = len },
+    };
+    i2c_bus_transaction_t txn = {
+        .device = device,
+        .addr = addr,
+        .priority = I2C_BUS_PRIO_NORMAL,
+        .segments = segs,
+        .segment_count = 2,
+        .timeout_ms = timeout_ms,
+    };
+    return i2c_bus_transfer(&txn);
+}
+
+esp_err_t i2c_bus_write_read(i2c_bus_device_t device, uint8_t addr, const uint8_t *tx, size_t tx_len,
+                             uint8_t *rx, size_t rx_len, uint32_t timeout_ms) {
+    i2c_bus_segment_t segs[2] = {
+        { .op = I2C_BUS_WRITE, .tx = tx, .len = tx_len },
+        { .op = I2C_BUS_READ, .rx = rx, .len = rx_len },
+    };
+    i2c_bus_transaction_t txn = {
+        .device = device,
+        .addr = addr,
+        .priority = I2C_BUS_PRIO_NORMAL,
+        .segments = segs,
+        .segment_count = 2,
+        .timeout_ms = timeout_ms,
+    };
+    return i2c_bus_transfer(&txn);
+}
+
+// Only read by the bus task between transactions; a change made while a
+// transaction is queued applies from the next one on.
+void i2c_bus_set_device_clock(i2c_bus_device_t device, uint32_t clk_hz) {
+    if (device < I2C_BUS_DEV_COUNT) {
+        bus_device_hz[device] = clk_hz;
+    }
+}
+
+uint32_t i2c_bus_get_device_clock(i2c_bus_device_t device) {
+    if (device >= I2C_BUS_DEV_COUNT || bus_device_hz[device] == 0) {
+        return bus_default_hz;
+    }
+    return bus_device_hz[device];
+}
+
+void i2c_bus_get_stats(i2c_bus_device_t device, i2c_bus_stats_t *stats) {
+    if (device >= I2C_BUS_DEV_COUNT) {
+        memset(stats, 0, sizeof(*stats));
+        return;
+    }
+    portENTER_CRITICAL(&bus_stats_lock);
+    *stats = bus_stats[device];
+    portEXIT_CRITICAL(&bus_stats_lock);
+}
+
+void i2c_bus_log_stats(void) {
+    ESP_LOGI("I2C", "SCL now %lu Hz, %lu clock switches", (unsigned long)bus_current_hz, (unsigned long)bus_clock_switches);
+    for (int dev = 0; dev < I2C_BUS_DEV_COUNT; dev++) {
+        i2c_bus_stats_t stats;
+        i2c_bus_get_stats(dev, &stats);
+        if (stats.transactions == 0) {
+            continue;
+        }
+        ESP_LOGI("I2C", "%-6s @ %3lu kHz: %lu txns, %llu bytes, %lu errors, wait avg %lu us max %lu us, busy avg %lu us max %lu us",
+                 bus_device_names[dev],
+                 (unsigned long)(i2c_bus_get_device_clock(dev) / 1000),
+                 (unsigned long)stats.transactions,
+                 (unsigned long long)stats.bytes,
+                 (unsigned long)stats.errors,
+                 (unsigned long)(stats.total_wait_us / stats.transactions),
+                 (unsigned long)stats.max_wait_us,
+                 (unsigned long)(stats.total_busy_us / stats.transactions),
+                 (unsigned long)stats.max_busy_us);
+    }
+}
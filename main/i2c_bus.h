@@ -0,0 +1,84 @@
+#ifndef I2C_BUS_H
+#define I2C_BUS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <driver/i2c.h>
+#include <esp_err.h>
+
+// Devices sharing the bus, used for latency statistics
+typedef enum {
+    I2C_BUS_DEV_KEYPAD,
+    I2C_BUS_DEV_LCD,
+    I2C_BUS_DEV_RTC,
+    I2C_BUS_DEV_EEPROM,
+    I2C_BUS_DEV_COUNT
+} i2c_bus_device_t;
+
+// High priority transactions are always started before any queued normal
+// ones. A transaction that is already on the wire is never interrupted.
+typedef enum {
+    I2C_BUS_PRIO_HIGH,
+    I2C_BUS_PRIO_NORMAL
+} i2c_bus_priority_t;
+
+typedef enum {
+    I2C_BUS_WRITE,
+    I2C_BUS_READ
+} i2c_bus_op_t;
+
+// One piece of a transaction. Consecutive segments in the same direction
+// share a phase on the wire; a change of direction inserts a repeated start
+// and the address byte again.
+typedef struct {
+    i2c_bus_op_t op;
+    const uint8_t *tx;  // Data to send, I2C_BUS_WRITE
+    uint8_t *rx;        // Destination, I2C_BUS_READ
+    size_t len;
+} i2c_bus_segment_t;
+
+typedef struct {
+    i2c_bus_device_t device;
+    uint8_t addr;
+    i2c_bus_priority_t priority;
+    const i2c_bus_segment_t *segments;
+    size_t segment_count;
+    uint32_t timeout_ms;  // Time allowed on the wire, 0 for the default
+} i2c_bus_transaction_t;
+
+typedef struct {
+    uint32_t transactions;
+    uint32_t errors;
+    uint64_t bytes;         // Address and data bytes clocked, including failed attempts
+    uint32_t max_wait_us;   // Queued until started
+    uint32_t max_busy_us;   // On the wire
+    uint64_t total_wait_us;
+    uint64_t total_busy_us;
+} i2c_bus_stats_t;
+
+// Installs the I2C driver on port and starts the bus task that owns it.
+// clk_hz is the SCL rate for every device without its own setting.
+esp_err_t i2c_bus_init(i2c_port_t port, int sda_io, int scl_io, uint32_t clk_hz);
+
+// Per-device SCL rate, 0 restores the bus default. The bus task reprograms
+// the port only when the next transaction is for a device at another rate.
+void i2c_bus_set_device_clock(i2c_bus_device_t device, uint32_t clk_hz);
+uint32_t i2c_bus_get_device_clock(i2c_bus_device_t device);
+
+// Queue a transaction and block until the bus task has run it
+esp_err_t i2c_bus_transfer(const i2c_bus_transaction_t *txn);
+
+// Shorthands for the common single write and register-read shapes.
+// i2c_bus_write_reg() sends reg (a register or memory address) followed by
+// data in the same write phase.
+esp_err_t i2c_bus_write(i2c_bus_device_t device, uint8_t addr, const uint8_t *data, size_t len, uint32_t timeout_ms);
+esp_err_t i2c_bus_write_reg(i2c_bus_device_t device, uint8_t addr, const uint8_t *reg, size_t reg_len,
+                            const uint8_t *data, size_t len, uint32_t timeout_ms);
+esp_err_t i2c_bus_write_read(i2c_bus_device_t device, uint8_t addr, const uint8_t *tx, size_t tx_len,
+                             uint8_t *rx, size_t rx_len, uint32_t timeout_ms);
+
+void i2c_bus_get_stats(i2c_bus_device_t device, i2c_bus_stats_t *stats);
+void i2c_bus_log_stats(void);
+
+#endif // I2C_BUS_H
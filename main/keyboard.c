@@ -1,22 +1,31 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <stdarg.h>
 #include <stdbool.h>
+#include <stddef.h>
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
 #include <freertos/semphr.h>
+#include <freertos/queue.h>
 #include <driver/i2c.h>
 #include <driver/gpio.h>
 #include <esp_err.h>
 #include <nvs_flash.h>
 #include <nvs.h>
 #include <esp_log.h>
+#include <esp_timer.h>
+#include <esp_rom_crc.h>
+#include <esp_rom_sys.h>
 #include <ctype.h>
 #include <time.h>
 #include <math.h>
 
 #include "keyboard.h"
 #include "lcd.h"
+#include "i2c_bus.h"
+#include "trace.h"
+#include "decimal.h"
 
 #define FORMAT_NONE 0
 #define FORMAT_DECIMAL 1
@@ -35,28 +44,47 @@ static esp_err_t ds1307_write(uint8_t reg_addr, uint8_t *data, size_t data_len);
 static esp_err_t ds1307_read(uint8_t reg_addr, uint8_t *data, size_t data_len);
 static esp_err_t eeprom_write(uint16_t addr, uint8_t *data, size_t data_len);
 static esp_err_t eeprom_read(uint16_t addr, uint8_t *data, size_t data_len);
-static esp_err_t write_pcf8574(uint8_t row_mask);
-static uint8_t read_pcf8574(uint8_t row_mask);
+static esp_err_t read_pcf8574_matrix(uint8_t *raw);
 static void format_input_according_to_rules(const char *input, char *output, const param_validation_t *rules);
 static bool check_password(const char *entered_password);
-static bool is_valid_date(const char *date_str);
 
-// Define keypad layout
+// Keypad layout. Bit (row * 4 + col) of a pressed-key bitmap is keys[row][col].
 static const char keys[4][4] = {
-    {'1', '2', '3', 'A'}, // Row 1
-    {'4', '5', '6', 'B'}, // Row 2
-    {'7', '8', '9', 'C'}, // Row 3
-    {'*', '0', '#', 'D'}  // Row 4
+    {'1', '2', '3', 'A'}, // Row 1 (P0)
+    {'4', '5', '6', 'B'}, // Row 2 (P1)
+    {'7', '8', '9', 'C'}, // Row 3 (P2)
+    {'*', '0', '#', 'D'}  // Row 4 (P3)
 };
 
 // Define global variables for I2C
 i2c_port_t keypad_i2c_port;
-SemaphoreHandle_t i2c_semaphore;
-// Add extern declaration for lcd_semaphore
-extern SemaphoreHandle_t lcd_semaphore;
-bool button_pressed = false;
-TickType_t button_timer = 0;
-char pressed_character[2] = {0};
+
+// Per-key debounce. Each scan sample moves a key's integrator one step
+// towards down or up; the debounced state only flips when the integrator
+// reaches the end of its range, so contact bounce never produces an event.
+static uint8_t key_integrator[16];
+static uint16_t keypad_down = 0;          // Debounced pressed-key bitmap
+static TickType_t key_down_since[16];     // When each key went down
+static int64_t key_edge_us[16];           // First sample that moved each integrator off its resting end
+static int keypad_last_key = -1;          // Most recent press, the only key that repeats
+static TickType_t keypad_next_repeat = 0;
+static uint16_t keypad_long_sent = 0;     // Keys that already fired KEY_EVENT_LONG_PRESS
+
+// The scanner task runs on its own and queues events for keyboard_task, so
+// keys pressed while the UI is busy (delays, saves, slow screens) are kept
+// and processed in order afterwards.
+#define KEYPAD_EVENT_QUEUE_LEN 32
+#define KEYPAD_TASK_STACK 2560
+#define KEYPAD_TASK_PRIORITY 8 // Above every UI task so sampling stays on schedule
+static QueueHandle_t keypad_event_queue = NULL;
+
+// PCF8574 /INT handling. While armed, every row is driven low, so any key
+// press pulls a column low and the expander asserts /INT. Until that happens
+// the scanner task does no bus traffic at all.
+static SemaphoreHandle_t keypad_int_semaphore = NULL;
+static bool keypad_int_enabled = false; // /INT pin configured, otherwise fall back to polling
+static bool keypad_armed = false;       // Rows low, /INT cleared, no key down
+static bool keypad_int_pending = false; // Edge already consumed by keypad_wait_for_activity()
 
 // Add variables for inactivity timeout
 static TickType_t last_activity_time = 0;
@@ -67,85 +95,123 @@ static bool is_locked_out = false;
 // Add this with the other global constants
 // static const int MAX_PASSWORD_RETRIES = 3;
 
-// Parameters array - must be defined before functions that use it
-static parameter_t parameters[] = {
-    // Time parameters
-    {
-        .name = "01.Time:",
-        .type = PARAM_TYPE_TIME,
-        .group = GROUP_DATE_TIME,
-        .storage = STORAGE_RTC,
-        .address = PARAM_ADDRESS_TIME,
-        .value = NULL,
-        .default_value = "0000",
-        .validate = validate_time,
-        .validation = {
-            .min_length = 4,
-            .max_length = 4,
-            .format = FORMAT_TIME,
-            .min_value = 0,
-            .max_value = 2359,
-            .decimal_places = 0,
-            .allow_negative = false}},
-    // Date parameters
-    {.name = "02.Date:", .type = PARAM_TYPE_DATE, .group = GROUP_DATE_TIME, .storage = STORAGE_RTC, .address = PARAM_ADDRESS_DATE, .value = NULL, .default_value = "010123", .validate = validate_date, .validation = {.min_length = 6, .max_length = 6, .format = FORMAT_DATE, .min_value = 0, .max_value = 311299, .decimal_places = 0, .allow_negative = false}},
-    // High Voltage parameter
-    {.name = "03.Hi Volt:", .type = PARAM_TYPE_DECIMAL, .group = GROUP_PROTECTION, .storage = STORAGE_EEPROM, .address = PARAM_ADDRESS_3, .value = NULL, .default_value = "280.0", .validate = validate_decimal, .validation = {.min_length = 3, .max_length = 5, .format = FORMAT_DECIMAL, .min_value = 0.0, .max_value = 999.9, .decimal_places = 1, .allow_negative = false}},
-    // Low Voltage parameter
-    {.name = "04.Lo Volt:", .type = PARAM_TYPE_DECIMAL, .group = GROUP_PROTECTION, .storage = STORAGE_NVS, .address = PARAM_ADDRESS_4, .value = NULL, .default_value = "180.0", .validate = validate_decimal, .validation = {.min_length = 3, .max_length = 5, .format = FORMAT_DECIMAL, .min_value = 0.0, .max_value = 999.9, .decimal_places = 1, .allow_negative = false}},
-    // R-Low A parameter
-    {.name = "05.R-Low A:", .type = PARAM_TYPE_DECIMAL, .group = GROUP_PROTECTION, .storage = STORAGE_NVS, .address = PARAM_ADDRESS_5, .value = NULL, .default_value = "1.0", .validate = validate_decimal, .validation = {.min_length = 1, .max_length = 3, .format = FORMAT_DECIMAL, .min_value = 0.0, .max_value = 9.9, .decimal_places = 1, .allow_negative = false}},
-    // Y-Low A parameter
-    {.name = "06.Y-Low A:", .type = PARAM_TYPE_DECIMAL, .group = GROUP_PROTECTION, .storage = STORAGE_NVS, .address = PARAM_ADDRESS_6, .value = NULL, .default_value = "1.0", .validate = validate_decimal, .validation = {.min_length = 1, .max_length = 3, .format = FORMAT_DECIMAL, .min_value = 0.0, .max_value = 9.9, .decimal_places = 1, .allow_negative = false}},
-    // B-Low A parameter
-    {.name = "07.B-Low A:", .type = PARAM_TYPE_DECIMAL, .group = GROUP_PROTECTION, .storage = STORAGE_NVS, .address = PARAM_ADDRESS_7, .value = NULL, .default_value = "1.0", .validate = validate_decimal, .validation = {.min_length = 1, .max_length = 3, .format = FORMAT_DECIMAL, .min_value = 0.0, .max_value = 9.9, .decimal_places = 1, .allow_negative = false}},
-    // OC % parameter
-    {.name = "08.OC %:", .type = PARAM_TYPE_NUMBER, .group = GROUP_PROTECTION, .storage = STORAGE_NVS, .address = PARAM_ADDRESS_8, .value = NULL, .default_value = "25", .validate = validate_number, .validation = {.min_length = 1, .max_length = 3, .format = FORMAT_NONE, .min_value = 0, .max_value = 999, .decimal_places = 0, .allow_negative = false}},
-    // Alarm parameter
-    {.name = "09.Alarm:", .type = PARAM_TYPE_ENABLE_DISABLE, .group = GROUP_PROTECTION, .storage = STORAGE_NVS, .address = PARAM_ADDRESS_9, .value = NULL, .default_value = "0", .validate = validate_enable_disable, .validation = {.min_length = 1, .max_length = 1, .format = FORMAT_ENABLE_DISABLE, .min_value = 0, .max_value = 1, .decimal_places = 0, .allow_negative = false}},
-    // Protection parameter
-    {.name = "10.Protect:", .type = PARAM_TYPE_MULTIPLE, .group = GROUP_PROTECTION, .storage = STORAGE_NVS, .address = PARAM_ADDRESS_10, .value = NULL, .default_value = "0", .validate = validate_multiple, .validation = {.min_length = 1, .max_length = 1, .format = FORMAT_MULTIPLE, .min_value = 0, .max_value = 3, .decimal_places = 0, .allow_negative = false}},
-    // Rotate parameter
-    {.name = "11.Rotate:", .type = PARAM_TYPE_ENABLE_DISABLE, .group = GROUP_STAGGERING, .storage = STORAGE_NVS, .address = PARAM_ADDRESS_11, .value = NULL, .default_value = "0", .validate = validate_enable_disable, .validation = {.min_length = 1, .max_length = 1, .format = FORMAT_ENABLE_DISABLE, .min_value = 0, .max_value = 1, .decimal_places = 0, .allow_negative = false}},
-    // R On Time parameter
-    {.name = "12.R On Tm:", .type = PARAM_TYPE_TIME, .group = GROUP_STAGGERING, .storage = STORAGE_NVS, .address = PARAM_ADDRESS_12, .value = NULL, .default_value = "0000", .validate = validate_time, .validation = {.min_length = 4, .max_length = 4, .format = FORMAT_TIME, .min_value = 0, .max_value = 2359, .decimal_places = 0, .allow_negative = false}},
-    // Y On Time parameter
-    {.name = "13.Y On Tm:", .type = PARAM_TYPE_TIME, .group = GROUP_STAGGERING, .storage = STORAGE_NVS, .address = PARAM_ADDRESS_13, .value = NULL, .default_value = "0000", .validate = validate_time, .validation = {.min_length = 4, .max_length = 4, .format = FORMAT_TIME, .min_value = 0, .max_value = 2359, .decimal_places = 0, .allow_negative = false}},
-    // B On Time parameter
-    {.name = "14.B On Tm:", .type = PARAM_TYPE_TIME, .group = GROUP_STAGGERING, .storage = STORAGE_NVS, .address = PARAM_ADDRESS_14, .value = NULL, .default_value = "0000", .validate = validate_time, .validation = {.min_length = 4, .max_length = 4, .format = FORMAT_TIME, .min_value = 0, .max_value = 2359, .decimal_places = 0, .allow_negative = false}},
-    // R Off Time parameter
-    {.name = "15.R OffTm:", .type = PARAM_TYPE_TIME, .group = GROUP_STAGGERING, .storage = STORAGE_NVS, .address = PARAM_ADDRESS_15, .value = NULL, .default_value = "0000", .validate = validate_time, .validation = {.min_length = 4, .max_length = 4, .format = FORMAT_TIME, .min_value = 0, .max_value = 2359, .decimal_places = 0, .allow_negative = false}},
-    // Y Off Time parameter
-    {.name = "16.Y OffTm:", .type = PARAM_TYPE_TIME, .group = GROUP_STAGGERING, .storage = STORAGE_NVS, .address = PARAM_ADDRESS_16, .value = NULL, .default_value = "0000", .validate = validate_time, .validation = {.min_length = 4, .max_length = 4, .format = FORMAT_TIME, .min_value = 0, .max_value = 2359, .decimal_places = 0, .allow_negative = false}},
-    // B Off Time parameter
-    {.name = "17.B OffTm:", .type = PARAM_TYPE_TIME, .group = GROUP_STAGGERING, .storage = STORAGE_NVS, .address = PARAM_ADDRESS_17, .value = NULL, .default_value = "0000", .validate = validate_time, .validation = {.min_length = 4, .max_length = 4, .format = FORMAT_TIME, .min_value = 0, .max_value = 2359, .decimal_places = 0, .allow_negative = false}},
-    // Back Set parameter
-    {.name = "18.BackSet:", .type = PARAM_TYPE_NUMBER, .group = GROUP_CIVIL_TWILIGHT, .storage = STORAGE_NVS, .address = PARAM_ADDRESS_18, .value = NULL, .default_value = "0", .validate = validate_number, .validation = {.min_length = 1, .max_length = 3, .format = FORMAT_NONE, .min_value = -99, .max_value = 99, .decimal_places = 0, .allow_negative = true}},
-    // Back Rise parameter
-    {.name = "19.BackRise:", .type = PARAM_TYPE_NUMBER, .group = GROUP_CIVIL_TWILIGHT, .storage = STORAGE_NVS, .address = PARAM_ADDRESS_19, .value = NULL, .default_value = "0", .validate = validate_number, .validation = {.min_length = 1, .max_length = 3, .format = FORMAT_NONE, .min_value = -99, .max_value = 99, .decimal_places = 0, .allow_negative = true}},
-    // January Dusk parameter
-    {.name = "20.JanDusk:", .type = PARAM_TYPE_TIME, .group = GROUP_CIVIL_TWILIGHT, .storage = STORAGE_NVS, .address = PARAM_ADDRESS_20, .value = NULL, .default_value = "0000", .validate = validate_time, .validation = {.min_length = 4, .max_length = 4, .format = FORMAT_TIME, .min_value = 0, .max_value = 99, .decimal_places = 0, .allow_negative = false}},
-    // January Dawn parameter
-    {.name = "21.JanDawn:", .type = PARAM_TYPE_TIME, .group = GROUP_CIVIL_TWILIGHT, .storage = STORAGE_NVS, .address = PARAM_ADDRESS_21, .value = NULL, .default_value = "0000", .validate = validate_time, .validation = {.min_length = 4, .max_length = 4, .format = FORMAT_TIME, .min_value = 0, .max_value = 99, .decimal_places = 0, .allow_negative = false}},
-    // December Dusk parameter
-    {.name = "22.DecDusk:", .type = PARAM_TYPE_TIME, .group = GROUP_CIVIL_TWILIGHT, .storage = STORAGE_NVS, .address = PARAM_ADDRESS_22, .value = NULL, .default_value = "0000", .validate = validate_time, .validation = {.min_length = 4, .max_length = 4, .format = FORMAT_TIME, .min_value = 0, .max_value = 99, .decimal_places = 0, .allow_negative = false}},
-    // December Dawn parameter
-    {.name = "23.DecDawn:", .type = PARAM_TYPE_TIME, .group = GROUP_CIVIL_TWILIGHT, .storage = STORAGE_NVS, .address = PARAM_ADDRESS_23, .value = NULL, .default_value = "0000", .validate = validate_time, .validation = {.min_length = 4, .max_length = 4, .format = FORMAT_TIME, .min_value = 0, .max_value = 99, .decimal_places = 0, .allow_negative = false}},
-    // Password parameter
-    {.name = "24.Password:", .type = PARAM_TYPE_PASSWORD, .group = GROUP_SYSTEM, .storage = STORAGE_NVS, .address = PARAM_ADDRESS_24, .value = NULL, .default_value = "00000000", .validate = validate_password, .validation = {.min_length = 8, .max_length = 8, .format = FORMAT_NONE, .min_value = 0, .max_value = 0, .decimal_places = 0, .allow_negative = false, .max_retries = 3, .lockout_time = 15}},
-    // Password Enable/Disable parameter
-    {.name = "25.PassED:", .type = PARAM_TYPE_ENABLE_DISABLE, .group = GROUP_SYSTEM, .storage = STORAGE_NVS, .address = PARAM_ADDRESS_25, .value = NULL, .default_value = "0", .validate = validate_enable_disable, .validation = {.min_length = 1, .max_length = 1, .format = FORMAT_ENABLE_DISABLE, .min_value = 0, .max_value = 1, .decimal_places = 0, .allow_negative = false}}};
+// Parameters array - must be defined before functions that use it. Every
+// entry comes from PARAM_LIST in param_table.h.
+#define PARAM_ENTRY(arg, id, num, label, type_, group_, storage_, default_, unit_, validate_, ...) \
+    [PARAM_ID_##id] = {                                                                         \
+        .name = PARAM_NAME(num, label),                                                         \
+        .type = type_,                                                                          \
+        .group = group_,                                                                        \
+        .storage = storage_,                                                                    \
+        .address = PARAM_ADDRESS_##id,                                                          \
+        .unit = unit_,                                                                          \
+        .default_value = default_,                                                              \
+        .validate = validate_,                                                                  \
+        .validation = {__VA_ARGS__}},
+
+// The table never changes, so it stays in flash. Only param_values, indexed
+// the same way, is RAM, and nothing is allocated for values after boot.
+static const parameter_t parameters[NUM_PARAMETERS] = {
+    PARAM_LIST(PARAM_ENTRY, _)
+};
+
+static param_value_t param_values[NUM_PARAMETERS];
+
+// The value of a table entry
+static param_value_t *param_value_of(const parameter_t *param)
+{
+    return &param_values[param - parameters];
+}
+
+// Table range of each group: the parameters listed before it and in it
+#define PARAM_IN_GROUP_BEFORE(group, id, num, label, type_, group_, ...) + (group_ < group)
+#define PARAM_IN_GROUP(group, id, num, label, type_, group_, ...) + (group_ == group)
+#define PARAM_GROUP_RANGE(arg, group, title)                      \
+    group##_FIRST = 0 PARAM_LIST(PARAM_IN_GROUP_BEFORE, group),  \
+    group##_COUNT = 0 PARAM_LIST(PARAM_IN_GROUP, group),
+enum {
+    PARAM_GROUP_LIST(PARAM_GROUP_RANGE, _)
+};
+
+typedef struct {
+    const char *title;  // Menu category header
+    uint16_t first;     // Index of the group's first parameter
+    uint16_t count;
+} param_group_info_t;
+
+#define PARAM_GROUP_INFO(arg, group, title_) \
+    [group] = {.title = title_, .first = group##_FIRST, .count = group##_COUNT},
+static const param_group_info_t param_groups[NUM_GROUPS] = {
+    PARAM_GROUP_LIST(PARAM_GROUP_INFO, _)
+};
+
+// Table index + 1 for each address, 0 where no parameter has it
+#define PARAM_ADDRESS_INDEX(arg, id, ...) [PARAM_ADDRESS_##id] = PARAM_ID_##id + 1,
+static const uint16_t param_index_by_address[PARAM_ADDRESS_MAX + 1] = {
+    PARAM_LIST(PARAM_ADDRESS_INDEX, _)
+};
+
+// Compile-time proof that the generated tables agree: each parameter sits
+// inside its group's range (so groups are contiguous and in order), each
+// address is in range, and no two parameters share an address, which would
+// be a duplicate case label below.
+#define PARAM_CHECK(arg, id, num, label, type_, group_, ...)                          \
+    _Static_assert((int)PARAM_ID_##id >= group_##_FIRST &&                              \
+                   (int)PARAM_ID_##id < group_##_FIRST + group_##_COUNT,                \
+                   #id " is not listed together with the rest of " #group_);           \
+    _Static_assert(PARAM_ADDRESS_##id >= 1 && PARAM_ADDRESS_##id <= PARAM_ADDRESS_MAX,  \
+                   #id " has an address outside 1..PARAM_ADDRESS_MAX");
+PARAM_LIST(PARAM_CHECK, _)
+_Static_assert(NUM_PARAMETERS < UINT16_MAX, "param_index_by_address and param_groups hold uint16_t indices");
+
+#define PARAM_ADDRESS_CASE(arg, id, ...) case PARAM_ADDRESS_##id:
+static inline void param_address_unique(int address)
+{
+    switch (address)
+    {
+        PARAM_LIST(PARAM_ADDRESS_CASE, _)
+        break;
+    }
+}
+
+// Table index of the parameter stored under address, -1 for none
+static int param_index_from_address(int address)
+{
+    if (address < 1 || address > PARAM_ADDRESS_MAX)
+    {
+        return -1;
+    }
+    return param_index_by_address[address] - 1;
+}
 
 #define NVS_NAMESPACE "params"
 
 // I2C defines and flags
 #define I2C_PORT I2C_NUM_0
 #define PCF8574_ADDR 0x23 // Updated to match your test program
+#define KEYPAD_INT_GPIO 4 // PCF8574 /INT, open drain, active low
+#define KEYPAD_IDLE_MASK 0xF0 // All rows (P0-P3) low, columns (P4-P7) as inputs
+#define KEYPAD_POLL_MS 10 // Scan interval while a key is down or /INT is unavailable
+#define KEYPAD_DEBOUNCE_SAMPLES 2 // Consecutive agreeing samples before a key changes state
+#define KEYPAD_REPEAT_DELAY_MS 500 // Hold time before a key starts repeating
+#define KEYPAD_REPEAT_RATE_MS 150 // Interval between repeats
+#define KEYPAD_LONG_PRESS_MS 1500 // Hold time for KEY_EVENT_LONG_PRESS
+#define KEYPAD_ROWS 4
+#define KEYPAD_SCAN_STEPS (KEYPAD_ROWS + 1) // Four rows, then back to idle
+
+// Row select mask for each scan step. The last step drives every row low
+// again, which leaves the expander ready to raise /INT on the next press.
+static const uint8_t keypad_scan_masks[KEYPAD_SCAN_STEPS] = {
+    0b11111110, // Row 1 (P0 low)
+    0b11111101, // Row 2 (P1 low)
+    0b11111011, // Row 3 (P2 low)
+    0b11110111, // Row 4 (P3 low)
+    KEYPAD_IDLE_MASK,
+};
 #define LCD_ADDR 0x27     // Matches your test program
 #define LCD_ROWS 2
 #define LCD_COLS 16
 
-extern SemaphoreHandle_t lcd_semaphore;
 extern bool in_keypad_mode;
 extern bool in_keyboard_mode;
 
@@ -159,6 +225,9 @@ extern bool in_keyboard_mode;
 
 // static my_nvs_handle_t my_nvs_handle;
 static nvs_handle_t my_nvs_handle;
+// Held while EEPROM or NVS parameters are written: the journal head and the
+// blob buffer are shared by every writer
+static SemaphoreHandle_t param_store_lock = NULL;
 
 // Add this global variable to indicate if the RTC is actually present
 static bool rtc_present = false;
@@ -173,41 +242,9 @@ static bool is_authenticated = false;
 // static bool cursor_visible = true;
 // static const TickType_t CURSOR_BLINK_INTERVAL_MS = 500; // Blink every 500ms
 
-// Add a global flag to track validation status
-static bool validation_failed = false;
-static char validation_error_message[64] = {0};
-
 // Add global shared buffer for temporary string operations
 static char shared_buffer[128];
 
-// Add unit labels for parameters
-typedef struct {
-    const char* name;
-    const char* unit;
-} param_unit_t;
-
-// Define units for relevant parameters
-const param_unit_t param_units[] = {
-    {"03.HiVolt:", "V"},
-    {"04.LoVolt:", "V"},
-    {"05.HiAmps:", "A"},
-    {"06.MinAmps:", "A"},
-    {"07.MaxAmps:", "A"},
-    {"08.MinDC:", "%"},
-    {"23.LockTm:", "s"},
-    {NULL, NULL}  // Terminator
-};
-
-// Function to get unit for a parameter
-static const char* get_param_unit(const char* param_name) {
-    for (int i = 0; param_units[i].name != NULL; i++) {
-        if (strcmp(param_units[i].name, param_name) == 0) {
-            return param_units[i].unit;
-        }
-    }
-    return "";
-}
-
 // Function to show saving animation
 static void show_saving_animation(void) {
     static const char* frames[] = {
@@ -218,11 +255,7 @@ static void show_saving_animation(void) {
     };
     
     for (int i = 0; i < 4; i++) {
-        if (xSemaphoreTake(lcd_semaphore, portMAX_DELAY) == pdTRUE) {
-            lcd_set_cursor(0, 0);
-            lcd_print("%-16s", frames[i]);  // Pad with spaces to clear line
-            xSemaphoreGive(lcd_semaphore);
-        }
+        lcd_set_line(0, "%-16s", frames[i]);  // Pad with spaces to clear line
         vTaskDelay(150 / portTICK_PERIOD_MS);
     }
 }
@@ -232,151 +265,260 @@ static void show_parameter_range(const parameter_t* param) {
     if (param->validation.format == FORMAT_DECIMAL || 
         param->type == PARAM_TYPE_NUMBER) {
         
-        sprintf(shared_buffer, "Range: %.1f to %.1f", 
-                param->validation.min_value, 
-                param->validation.max_value);
+        char min_text[16], max_text[16];
+        decimal_format(param->validation.min_value, param->validation.decimal_places, min_text, sizeof(min_text));
+        decimal_format(param->validation.max_value, param->validation.decimal_places, max_text, sizeof(max_text));
+        sprintf(shared_buffer, "Range: %s to %s", min_text, max_text);
                 
-        if (xSemaphoreTake(lcd_semaphore, portMAX_DELAY) == pdTRUE) {
-            lcd_set_cursor(1, 0);
-            lcd_print("%-16s", shared_buffer);  // Pad with spaces to clear line
-            xSemaphoreGive(lcd_semaphore);
-        }
+        lcd_set_line(1, "%-16s", shared_buffer);  // Pad with spaces to clear line
         vTaskDelay(1500 / portTICK_PERIOD_MS);
     }
 }
 
-// This new function will handle the validation logic
-static bool is_valid_date(const char *date_str)
+// Days in month for a date in 20yy, leap years by the simple rule
+static int days_in_month(int month, int year)
 {
-    if (strlen(date_str) != 6)
+    if (month == 4 || month == 6 || month == 9 || month == 11)
     {
-        ESP_LOGE("Validation", "Invalid date length: %s", date_str);
-        return false;
+        return 30;
     }
-
-    char day_str[3] = {date_str[0], date_str[1], '\0'};
-    char month_str[3] = {date_str[2], date_str[3], '\0'};
-    char year_str[3] = {date_str[4], date_str[5], '\0'};
-
-    int day = atoi(day_str);
-    int month = atoi(month_str);
-    int year = atoi(year_str);
-
-    // Basic range checks
-    if (month < 1 || month > 12)
+    if (month == 2)
     {
-        ESP_LOGE("Validation", "Invalid month: %d", month);
-        return false;
+        return (year % 4 == 0) ? 29 : 28;
     }
-    if (day < 1)
+    return 31;
+}
+
+// Display names for PARAM_TYPE_MULTIPLE, indexed by choice
+static const char *const multiple_choice_names[] = {"ALL", "Volt", "Curr", "None"};
+#define MULTIPLE_CHOICE_COUNT (sizeof(multiple_choice_names) / sizeof(multiple_choice_names[0]))
+
+// Exactly count decimal digits at text
+static bool parse_digits(const char *text, int count, int *out)
+{
+    int value = 0;
+    for (int i = 0; i < count; i++)
     {
-        ESP_LOGE("Validation", "Invalid day: %d", day);
-        return false;
+        if (!isdigit((unsigned char)text[i]))
+        {
+            return false;
+        }
+        value = value * 10 + (text[i] - '0');
     }
+    *out = value;
+    return true;
+}
 
-    // Check days in month
-    int max_days = 31;
-    if (month == 4 || month == 6 || month == 9 || month == 11)
+// Text to a typed value. Accepts what the keypad produces (HHMM, DDMMYY,
+// 0/1, a digit for a choice) as well as the display form. Only the shape
+// is checked here, ranges are up to the validator.
+static bool param_value_parse(const parameter_t *param, const char *text, param_value_t *value)
+{
+    size_t len = strlen(text);
+    param_value_t parsed;
+    memset(&parsed, 0, sizeof(parsed));
+
+    switch (param->type)
+    {
+    case PARAM_TYPE_NUMBER:
+        if (!decimal_parse(text, 0, &parsed.number) || strchr(text, '.') != NULL)
+        {
+            return false;
+        }
+        break;
+    case PARAM_TYPE_DECIMAL:
+        if (!decimal_parse(text, param->validation.decimal_places, &parsed.decimal))
+        {
+            return false;
+        }
+        break;
+    case PARAM_TYPE_TIME:
     {
-        max_days = 30;
+        int hour, minute;
+        if (len == 5 && text[2] == ':')
+        {
+            if (!parse_digits(text, 2, &hour) || !parse_digits(text + 3, 2, &minute))
+            {
+                return false;
+            }
+        }
+        else if (len != 4 || !parse_digits(text, 2, &hour) || !parse_digits(text + 2, 2, &minute))
+        {
+            return false;
+        }
+        parsed.time.hour = hour;
+        parsed.time.minute = minute;
+        break;
     }
-    else if (month == 2)
+    case PARAM_TYPE_DATE:
     {
-        // Simple leap year check for 20xx
-        max_days = (year % 4 == 0) ? 29 : 28;
+        int day, month, year;
+        if (len == 8 && text[2] == '/' && text[5] == '/')
+        {
+            if (!parse_digits(text, 2, &day) || !parse_digits(text + 3, 2, &month) ||
+                !parse_digits(text + 6, 2, &year))
+            {
+                return false;
+            }
+        }
+        else if (len != 6 || !parse_digits(text, 2, &day) || !parse_digits(text + 2, 2, &month) ||
+                 !parse_digits(text + 4, 2, &year))
+        {
+            return false;
+        }
+        parsed.date.day = day;
+        parsed.date.month = month;
+        parsed.date.year = year;
+        break;
     }
-
-    if (day > max_days)
+    case PARAM_TYPE_ENABLE_DISABLE:
+        if (strcmp(text, "1") == 0 || strcmp(text, "Enable") == 0)
+        {
+            parsed.choice = 1;
+        }
+        else if (strcmp(text, "0") != 0 && strcmp(text, "Disable") != 0)
+        {
+            return false;
+        }
+        break;
+    case PARAM_TYPE_MULTIPLE:
     {
-        ESP_LOGE("Validation", "Invalid day %d for month %d", day, month);
-        return false;
+        int choice;
+        if (len == 1 && parse_digits(text, 1, &choice))
+        {
+            parsed.choice = choice;
+            break;
+        }
+        // Names, case and trailing blanks ignored ("ALL ", "VOLT")
+        size_t name_len = len;
+        while (name_len > 0 && text[name_len - 1] == ' ')
+        {
+            name_len--;
+        }
+        for (choice = 0; choice < (int)MULTIPLE_CHOICE_COUNT; choice++)
+        {
+            if (strlen(multiple_choice_names[choice]) == name_len &&
+                strncasecmp(text, multiple_choice_names[choice], name_len) == 0)
+            {
+                break;
+            }
+        }
+        if (choice == (int)MULTIPLE_CHOICE_COUNT)
+        {
+            return false;
+        }
+        parsed.choice = choice;
+        break;
+    }
+    case PARAM_TYPE_PASSWORD:
+        if (len >= sizeof(parsed.password))
+        {
+            return false;
+        }
+        memcpy(parsed.password, text, len + 1);
+        break;
     }
 
+    *value = parsed;
     return true;
 }
 
-// This matches the declaration in keyboard.h
-void validate_date(void *value)
+// Display form of a typed value: 12:30, 16/10/26, 280.0, Enable, ALL
+static void param_value_format(const parameter_t *param, const param_value_t *value, char *out, size_t out_size)
 {
-    char *date_str = (char *)value;
-    if (!date_str)
-        return;
-
-    // Reset validation status
-    validation_failed = false;
-    validation_error_message[0] = '\0';
-
-    // Special case for empty value
-    if (strlen(date_str) == 0)
+    switch (param->type)
     {
-        strcpy(date_str, "010123"); // Default to 01/01/23
-        validation_failed = true;
-        snprintf(validation_error_message, sizeof(validation_error_message), 
-                "Empty date - using default");
-        return;
+    case PARAM_TYPE_NUMBER:
+        snprintf(out, out_size, "%ld", (long)value->number);
+        break;
+    case PARAM_TYPE_DECIMAL:
+        decimal_format(value->decimal, param->validation.decimal_places, out, out_size);
+        break;
+    case PARAM_TYPE_TIME:
+        snprintf(out, out_size, "%02u:%02u", value->time.hour, value->time.minute);
+        break;
+    case PARAM_TYPE_DATE:
+        snprintf(out, out_size, "%02u/%02u/%02u", value->date.day, value->date.month, value->date.year);
+        break;
+    case PARAM_TYPE_ENABLE_DISABLE:
+        snprintf(out, out_size, "%s", value->choice ? "Enable" : "Disable");
+        break;
+    case PARAM_TYPE_MULTIPLE:
+        snprintf(out, out_size, "%s",
+                 value->choice < MULTIPLE_CHOICE_COUNT ? multiple_choice_names[value->choice] : "?");
+        break;
+    case PARAM_TYPE_PASSWORD:
+        snprintf(out, out_size, "%s", value->password);
+        break;
     }
+}
 
-    // If not in DDMMYY format, assume raw input and try to parse it
-    if (!is_valid_date(date_str))
+// Reset a parameter to its default_value. The defaults are all well formed,
+// this only fails if the table itself is wrong.
+static void param_value_set_default(const parameter_t *param)
+{
+    param_value_t *value = param_value_of(param);
+    if (!param_value_parse(param, param->default_value, value))
     {
-        validation_failed = true;
-        snprintf(validation_error_message, sizeof(validation_error_message), 
-                "Invalid date format");
-                
-        // Reset to default (01/01/23)
-        strcpy(date_str, "010123");
-        return;
+        ESP_LOGE("Validation", "Bad default '%s' for %s", param->default_value, param->name);
+        memset(value, 0, sizeof(*value));
     }
+}
 
-    // The date is valid, extract and check parts
-    char day_str[3] = {date_str[0], date_str[1], '\0'};
-    char month_str[3] = {date_str[2], date_str[3], '\0'};
-    char year_str[3] = {date_str[4], date_str[5], '\0'};
+// Fill in result, when the caller asked for one, and hand status back
+static param_status_t param_result(param_result_t *result, param_status_t status, const char *format, ...)
+{
+    if (result != NULL)
+    {
+        result->status = status;
+        va_list args;
+        va_start(args, format);
+        vsnprintf(result->message, sizeof(result->message), format, args);
+        va_end(args);
+    }
+    return status;
+}
 
-    int day = atoi(day_str);
-    int month = atoi(month_str);
-    int year = atoi(year_str);
+param_status_t param_validate(param_id_t id, const param_value_t *candidate, param_result_t *result)
+{
+    if ((int)id < 0 || id >= NUM_PARAMETERS || candidate == NULL)
+    {
+        return param_result(result, PARAM_ERR_UNKNOWN, "No such parameter");
+    }
+    return parameters[id].validate(&parameters[id].validation, candidate, result);
+}
 
-    // Additional validation for day/month ranges
-    if (month < 1 || month > 12 || day < 1 || day > 31)
+// Keep a value read back from storage only if its validator accepts it,
+// otherwise fall back to the default
+static void param_value_check(int param_idx)
+{
+    param_result_t result;
+    if (param_validate(param_idx, &param_values[param_idx], &result) != PARAM_VALID)
     {
-        validation_failed = true;
-        snprintf(validation_error_message, sizeof(validation_error_message), 
-                "Day/month out of range");
-                
-        // Reset to default (01/01/23)
-        strcpy(date_str, "010123");
-        return;
+        ESP_LOGW("Validation", "Stored %s rejected (%s), using default", parameters[param_idx].name, result.message);
+        param_value_set_default(&parameters[param_idx]);
     }
+}
+
+param_status_t validate_date(const param_validation_t *rules, const param_value_t *value, param_result_t *result)
+{
+    int day = value->date.day;
+    int month = value->date.month;
+    int year = value->date.year;
 
-    // Specific month validation
-    if ((month == 4 || month == 6 || month == 9 || month == 11) && day > 30)
+    if (month < 1 || month > 12 || day < 1 || day > 31)
     {
-        validation_failed = true;
-        snprintf(validation_error_message, sizeof(validation_error_message), 
-                "Month %d has 30 days max", month);
-                
-        // Reset to default (01/01/23)
-        strcpy(date_str, "010123");
-        return;
+        return param_result(result, PARAM_ERR_DATE, "Day/month out of range");
     }
-    else if (month == 2)
+    if (day > days_in_month(month, year))
     {
-        // February validation with leap year check
-        bool leap_year = (year % 4 == 0); // Simplified leap year check
-        if ((leap_year && day > 29) || (!leap_year && day > 28))
+        if (month == 2)
         {
-            validation_failed = true;
-            snprintf(validation_error_message, sizeof(validation_error_message), 
-                    "Feb has %d days in 20%02d", leap_year ? 29 : 28, year);
-                    
-            // Reset to default (01/01/23)
-            strcpy(date_str, "010123");
-            return;
+            return param_result(result, PARAM_ERR_DATE, "Feb has %d days in 20%02d", days_in_month(month, year), year);
         }
+        return param_result(result, PARAM_ERR_DATE, "Month %d has 30 days max", month);
     }
-
-    // Date is valid, keep the original format
+    return param_result(result, PARAM_VALID, "");
 }
 
 void format_date(const char *input, char *output, size_t output_size)
@@ -490,131 +632,41 @@ void format_time(char *input, char *output)
     }
 }
 
-void validate_time(void *value)
+param_status_t validate_time(const param_validation_t *rules, const param_value_t *value, param_result_t *result)
 {
-    char *time_str = (char *)value;
-    if (!time_str)
-        return;
-
-    // Reset validation status
-    validation_failed = false;
-    validation_error_message[0] = '\0';
-
-    int hour = 0, minute = 0;
-    bool valid_format = false;
-
-    // Check for HH:MM format
-    if (strlen(time_str) == 5 && time_str[2] == ':')
-    {
-        if (sscanf(time_str, "%d:%d", &hour, &minute) == 2)
-        {
-            valid_format = true;
-        }
-    }
-    // Check for HHMM format
-    else if (strlen(time_str) == 4)
-    {
-        char hours[3] = {time_str[0], time_str[1], '\0'};
-        char mins[3] = {time_str[2], time_str[3], '\0'};
-
-        hour = atoi(hours);
-        minute = atoi(mins);
-        valid_format = true;
-    }
-
-    if (!valid_format || hour < 0 || hour > 23 || minute < 0 || minute > 59)
+    if (value->time.hour > 23 || value->time.minute > 59)
     {
-        // Set validation error flag and message
-        validation_failed = true;
-        snprintf(validation_error_message, sizeof(validation_error_message), 
-                "Invalid time format");
-        
-        // Reset to default
-        strcpy(time_str, "00:00");
+        return param_result(result, PARAM_ERR_TIME, "Invalid time format");
     }
+    return param_result(result, PARAM_VALID, "");
 }
 
-void validate_number(void *value)
+param_status_t validate_number(const param_validation_t *rules, const param_value_t *value, param_result_t *result)
 {
-    char *num_str = (char *)value;
-    if (!num_str)
-        return;
-
-    // Reset validation status
-    validation_failed = false;
-    validation_error_message[0] = '\0';
-
-    // Find the parameter this value belongs to
-    parameter_t *param = NULL;
-    for (int i = 0; i < NUM_PARAMETERS; i++)
-    {
-        if (parameters[i].value == value)
-        {
-            param = &parameters[i];
-            break;
-        }
-    }
-    
-    if (!param)
-        return;
-
-    int val = atoi(num_str);
-    
-    // Check range based on parameter validation rules
-    if (val < param->validation.min_value || val > param->validation.max_value)
+    if (value->number < rules->min_value || value->number > rules->max_value)
     {
-        // Set validation error
-        validation_failed = true;
-        snprintf(validation_error_message, sizeof(validation_error_message), 
-                "Range %d to %d", (int)param->validation.min_value, (int)param->validation.max_value);
-                
-        // Reset to default value
-        strcpy(num_str, param->default_value);
+        return param_result(result, PARAM_ERR_RANGE, "Range %ld to %ld", (long)rules->min_value, (long)rules->max_value);
     }
+    return param_result(result, PARAM_VALID, "");
 }
 
-// Modified validate_enable_disable to show "Enable"/"Disable" instead of 0/1
-void validate_enable_disable(void *value)
+param_status_t validate_enable_disable(const param_validation_t *rules, const param_value_t *value,
+                                       param_result_t *result)
 {
-    char *val = (char *)value;
-    if (!val)
-        return;
-
-    // If we're in edit mode and the value is a single digit
-    if (strlen(val) == 1 && (val[0] == '0' || val[0] == '1'))
+    if (value->choice > 1)
     {
-        // Convert to text format
-        strcpy(val, val[0] == '1' ? "Enable" : "Disable");
-    }
-    else if (strcmp(val, "Enable") != 0 && strcmp(val, "Disable") != 0)
-    {
-        // Invalid value, set to default
-        strcpy(val, "Disable");
+        return param_result(result, PARAM_ERR_FORMAT, "Enable or Disable");
     }
+    return param_result(result, PARAM_VALID, "");
 }
 
-void validate_multiple(void *value)
+param_status_t validate_multiple(const param_validation_t *rules, const param_value_t *value, param_result_t *result)
 {
-    char *val = (char *)value;
-    int selection = atoi(val);
-    switch (selection)
+    if (value->choice >= MULTIPLE_CHOICE_COUNT)
     {
-    case 0:
-        strcpy(val, "ALL ");
-        break;
-    case 1:
-        strcpy(val, "VOLT");
-        break;
-    case 2:
-        strcpy(val, "CURR");
-        break;
-    case 3:
-        strcpy(val, "None");
-        break;
-    default:
-        strcpy(val, "ALL ");
-        break;
+        return param_result(result, PARAM_ERR_FORMAT, "Choice 0 to %d", MULTIPLE_CHOICE_COUNT - 1);
     }
+    return param_result(result, PARAM_VALID, "");
 }
 
 // Initialize DS1307 RTC and set up simulated mode if needed
@@ -639,32 +691,12 @@ static esp_err_t ds1307_init(void)
     simulated_rtc_registers[5] = binary_to_bcd(1);  // month
     simulated_rtc_registers[6] = binary_to_bcd(23); // year (2023)
 
-    // Try to take I2C semaphore with extended timeout
-    if (xSemaphoreTake(i2c_semaphore, 200 / portTICK_PERIOD_MS) != pdTRUE)
-    {
-        ESP_LOGE("RTC", "Failed to take I2C semaphore during initialization (timeout)");
-        goto use_simulated;
-    }
-
     do
     {
-        // First check if we can communicate with the RTC at all
-        i2c_cmd_handle_t cmd = i2c_cmd_link_create();
-        if (cmd == NULL)
-        {
-            ESP_LOGE("RTC", "Failed to create I2C command");
-            ret = ESP_FAIL;
-            break;
-        }
-
-        // Try to read the control register at address 0x07
-        i2c_master_start(cmd);
-        i2c_master_write_byte(cmd, (DS1307_ADDR << 1) | I2C_MASTER_WRITE, true);
-        i2c_master_write_byte(cmd, 0x07, true); // Control register address
-        i2c_master_stop(cmd);
-
-        ret = i2c_master_cmd_begin(keypad_i2c_port, cmd, RTC_TIMEOUT_MS / portTICK_PERIOD_MS);
-        i2c_cmd_link_delete(cmd);
+        // First check if we can communicate with the RTC at all by reading
+        // the control register at address 0x07
+        uint8_t control_addr = 0x07;
+        ret = i2c_bus_write_read(I2C_BUS_DEV_RTC, DS1307_ADDR, &control_addr, 1, &control_reg, 1, RTC_TIMEOUT_MS);
 
         if (ret != ESP_OK)
         {
@@ -672,32 +704,6 @@ static esp_err_t ds1307_init(void)
             break;
         }
 
-        // Add a small delay to give the RTC time to process
-        vTaskDelay(10 / portTICK_PERIOD_MS);
-
-        // Now read the control register
-        cmd = i2c_cmd_link_create();
-        if (cmd == NULL)
-        {
-            ESP_LOGE("RTC", "Failed to create I2C read command");
-            ret = ESP_FAIL;
-            break;
-        }
-
-        i2c_master_start(cmd);
-        i2c_master_write_byte(cmd, (DS1307_ADDR << 1) | I2C_MASTER_READ, true);
-        i2c_master_read_byte(cmd, &control_reg, I2C_MASTER_NACK);
-        i2c_master_stop(cmd);
-
-        ret = i2c_master_cmd_begin(keypad_i2c_port, cmd, RTC_TIMEOUT_MS / portTICK_PERIOD_MS);
-        i2c_cmd_link_delete(cmd);
-
-        if (ret != ESP_OK)
-        {
-            ESP_LOGW("RTC", "Failed to read DS1307 control register: %s", esp_err_to_name(ret));
-            break;
-        }
-
         ESP_LOGI("RTC", "DS1307 detected on I2C bus, control register: 0x%02x", control_reg);
 
         // Now check if the clock is running by reading register 0 (seconds)
@@ -760,10 +766,6 @@ static esp_err_t ds1307_init(void)
 
     } while (0);
 
-    // Release the I2C semaphore
-    xSemaphoreGive(i2c_semaphore);
-
-use_simulated:
     // If RTC not present or any operation failed, use simulated mode
     if (!rtc_present)
     {
@@ -800,30 +802,7 @@ static esp_err_t ds1307_write(uint8_t reg_addr, uint8_t *data, size_t data_len)
 
     ESP_LOGD("RTC", "Writing to DS1307 reg 0x%02x, length %d", reg_addr, data_len);
 
-    if (xSemaphoreTake(i2c_semaphore, 200 / portTICK_PERIOD_MS) != pdTRUE)
-    {
-        ESP_LOGE("RTC", "Failed to take I2C semaphore (timeout)");
-        return ESP_ERR_TIMEOUT;
-    }
-
-    i2c_cmd_handle_t cmd = i2c_cmd_link_create();
-    if (cmd == NULL)
-    {
-        ESP_LOGE("RTC", "Failed to create I2C command");
-        xSemaphoreGive(i2c_semaphore);
-        return ESP_FAIL;
-    }
-
-    i2c_master_start(cmd);
-    i2c_master_write_byte(cmd, (DS1307_ADDR << 1) | I2C_MASTER_WRITE, true);
-    i2c_master_write_byte(cmd, reg_addr, true);
-    i2c_master_write(cmd, data, data_len, true);
-    i2c_master_stop(cmd);
-
-    esp_err_t ret = i2c_master_cmd_begin(keypad_i2c_port, cmd, RTC_READ_TIMEOUT_MS / portTICK_PERIOD_MS);
-    i2c_cmd_link_delete(cmd);
-
-    xSemaphoreGive(i2c_semaphore);
+    esp_err_t ret = i2c_bus_write_reg(I2C_BUS_DEV_RTC, DS1307_ADDR, &reg_addr, 1, data, data_len, RTC_READ_TIMEOUT_MS);
 
     if (ret != ESP_OK)
     {
@@ -892,78 +871,21 @@ static esp_err_t ds1307_read(uint8_t reg_addr, uint8_t *data, size_t data_len)
 
     ESP_LOGD("RTC", "Reading from DS1307 reg 0x%02x, length %d", reg_addr, data_len);
 
-    if (xSemaphoreTake(i2c_semaphore, 200 / portTICK_PERIOD_MS) != pdTRUE)
-    {
-        ESP_LOGE("RTC", "Failed to take I2C semaphore (timeout)");
-        return ESP_ERR_TIMEOUT;
-    }
+    // Set the register address, then read back from it after a repeated start
+    esp_err_t ret = i2c_bus_write_read(I2C_BUS_DEV_RTC, DS1307_ADDR, &reg_addr, 1, data, data_len, RTC_READ_TIMEOUT_MS);
 
-    // First set the register address
-    i2c_cmd_handle_t cmd = i2c_cmd_link_create();
-    if (cmd == NULL)
+    if (ret != ESP_OK)
     {
-        ESP_LOGE("RTC", "Failed to create I2C command");
-        xSemaphoreGive(i2c_semaphore);
-        return ESP_FAIL;
+        ESP_LOGE("RTC", "Failed to read from DS1307 (reg 0x%02x): %s", reg_addr, esp_err_to_name(ret));
     }
-
-    esp_err_t ret = ESP_FAIL;
-
-    do
+    else
     {
-        i2c_master_start(cmd);
-        i2c_master_write_byte(cmd, (DS1307_ADDR << 1) | I2C_MASTER_WRITE, true);
-        i2c_master_write_byte(cmd, reg_addr, true);
-        i2c_master_stop(cmd);
-        ret = i2c_master_cmd_begin(keypad_i2c_port, cmd, RTC_READ_TIMEOUT_MS / portTICK_PERIOD_MS);
-        i2c_cmd_link_delete(cmd);
-
-        if (ret != ESP_OK)
-        {
-            ESP_LOGE("RTC", "Failed to set register address 0x%02x: %s", reg_addr, esp_err_to_name(ret));
-            break;
-        }
-
-        // Add a small delay before reading
-        vTaskDelay(10 / portTICK_PERIOD_MS);
-
-        // Then read the data
-        cmd = i2c_cmd_link_create();
-        if (cmd == NULL)
-        {
-            ESP_LOGE("RTC", "Failed to create I2C read command");
-            ret = ESP_FAIL;
-            break;
-        }
-
-        i2c_master_start(cmd);
-        i2c_master_write_byte(cmd, (DS1307_ADDR << 1) | I2C_MASTER_READ, true);
-
-        if (data_len > 1)
-        {
-            i2c_master_read(cmd, data, data_len - 1, I2C_MASTER_ACK);
-        }
-        i2c_master_read_byte(cmd, data + data_len - 1, I2C_MASTER_NACK);
-
-        i2c_master_stop(cmd);
-        ret = i2c_master_cmd_begin(keypad_i2c_port, cmd, RTC_READ_TIMEOUT_MS / portTICK_PERIOD_MS);
-        i2c_cmd_link_delete(cmd);
-
-        if (ret != ESP_OK)
-        {
-            ESP_LOGE("RTC", "Failed to read from DS1307 (reg 0x%02x): %s", reg_addr, esp_err_to_name(ret));
-        }
-        else
+        ESP_LOGD("RTC", "Successfully read from DS1307 reg 0x%02x", reg_addr);
+        if (data_len == 1)
         {
-            ESP_LOGD("RTC", "Successfully read from DS1307 reg 0x%02x", reg_addr);
-            if (data_len == 1)
-            {
-                ESP_LOGD("RTC", "Data: 0x%02x", data[0]);
-            }
+            ESP_LOGD("RTC", "Data: 0x%02x", data[0]);
         }
-    } while (0);
-
-    xSemaphoreGive(i2c_semaphore);
+    }
 
     // If we get a timeout or other error, assume RTC is not working properly
     // and switch to simulated mode for future operations
@@ -1005,7 +927,7 @@ static esp_err_t ds1307_read(uint8_t reg_addr, uint8_t *data, size_t data_len)
 // Store a parameter to RTC (DS1307)
 esp_err_t store_parameter_to_rtc(int param_idx)
 {
-    if (param_idx < 0 || param_idx >= NUM_PARAMETERS || parameters[param_idx].value == NULL)
+    if (param_idx < 0 || param_idx >= NUM_PARAMETERS)
     {
         return ESP_ERR_INVALID_ARG;
     }
@@ -1013,33 +935,26 @@ esp_err_t store_parameter_to_rtc(int param_idx)
     ESP_LOGI("Storage", "Storing parameter %s to %s RTC", parameters[param_idx].name, rtc_present ? "hardware" : "simulated");
 
     // if (strcmp(parameters[param_idx].name, "Date:") == 0)
-    if (parameters[param_idx].address == PARAM_ADDRESS_DATE)
+    if (param_idx == PARAM_ID_DATE)
     {
-        const char *date_str = (const char *)parameters[param_idx].value;
+        const param_value_t *date = &param_values[param_idx];
 
-        // Validate date format first
-        if (!is_valid_date(date_str))
+        // Validate date first
+        if (param_validate(PARAM_ID_DATE, date, NULL) != PARAM_VALID)
         {
-            ESP_LOGE("Storage", "Invalid date format: %s", date_str);
+            ESP_LOGE("Storage", "Invalid date: %02u/%02u/%02u", date->date.day, date->date.month, date->date.year);
             return ESP_ERR_INVALID_ARG;
         }
 
-        // Extract day, month, year from DDMMYY format
-        char day_str[3] = {date_str[0], date_str[1], '\0'};
-        char month_str[3] = {date_str[2], date_str[3], '\0'};
-        char year_str[3] = {date_str[4], date_str[5], '\0'};
-
-        uint8_t day = binary_to_bcd(atoi(day_str));
-        uint8_t month = binary_to_bcd(atoi(month_str));
-        uint8_t year = binary_to_bcd(atoi(year_str));
+        // Day, month and year registers in one burst
+        uint8_t date_data[3] = {binary_to_bcd(date->date.day), binary_to_bcd(date->date.month),
+                                binary_to_bcd(date->date.year)};
 
         // Store in RTC registers
         if (rtc_present)
         {
-            esp_err_t ret;
-            if ((ret = ds1307_write(4, &day, 1)) != ESP_OK ||
-                (ret = ds1307_write(5, &month, 1)) != ESP_OK ||
-                (ret = ds1307_write(6, &year, 1)) != ESP_OK)
+            esp_err_t ret = ds1307_write(4, date_data, sizeof(date_data));
+            if (ret != ESP_OK)
             {
                 ESP_LOGE("Storage", "Failed to write date to RTC: %d", ret);
                 return ret;
@@ -1047,42 +962,19 @@ esp_err_t store_parameter_to_rtc(int param_idx)
         }
         else
         {
-            simulated_rtc_registers[4] = day;
-            simulated_rtc_registers[5] = month;
-            simulated_rtc_registers[6] = year;
+            memcpy(&simulated_rtc_registers[4], date_data, sizeof(date_data));
         }
 
-        ESP_LOGI("Storage", "Stored date: %02d/%02d/%02d", atoi(day_str), atoi(month_str), atoi(year_str));
+        ESP_LOGI("Storage", "Stored date: %02u/%02u/%02u", date->date.day, date->date.month, date->date.year);
         return ESP_OK;
     }
     // else if (strcmp(parameters[param_idx].name, "Time:") == 0)
-    else if (parameters[param_idx].address == PARAM_ADDRESS_TIME)
+    else if (param_idx == PARAM_ID_TIME)
     {
-        // Parse time string (could be either HH:MM or HHMM format)
-        char *time_str = parameters[param_idx].value;
-        int hour = 0, minute = 0;
-        bool valid_format = false;
-
-        // Try HH:MM format first
-        if (strlen(time_str) == 5 && time_str[2] == ':')
-        {
-            if (sscanf(time_str, "%d:%d", &hour, &minute) == 2)
-            {
-                valid_format = true;
-            }
-        }
-        // Try HHMM format (without colon)
-        else if (strlen(time_str) == 4)
-        {
-            char hours[3] = {time_str[0], time_str[1], '\0'};
-            char mins[3] = {time_str[2], time_str[3], '\0'};
+        int hour = param_values[param_idx].time.hour;
+        int minute = param_values[param_idx].time.minute;
 
-            hour = atoi(hours);
-            minute = atoi(mins);
-            valid_format = true;
-        }
-
-        if (valid_format && hour >= 0 && hour <= 23 && minute >= 0 && minute <= 59)
+        if (hour <= 23 && minute <= 59)
         {
             // Update the time registers
             uint8_t time_data[2] = {binary_to_bcd(minute), binary_to_bcd(hour)};
@@ -1102,18 +994,12 @@ esp_err_t store_parameter_to_rtc(int param_idx)
                 simulated_rtc_registers[2] = time_data[1]; // hours
             }
 
-            // Ensure time is stored in standard HH:MM format
-            if (strlen(time_str) != 5 || time_str[2] != ':')
-            {
-                sprintf(time_str, "%02d:%02d", hour, minute);
-            }
-
             ESP_LOGI("RTC", "Updated time to %02d:%02d", hour, minute);
             return ESP_OK;
         }
         else
         {
-            ESP_LOGE("RTC", "Invalid time format: %s", time_str);
+            ESP_LOGE("RTC", "Invalid time: %02d:%02d", hour, minute);
             return ESP_ERR_INVALID_ARG;
         }
     }
@@ -1171,14 +1057,10 @@ esp_err_t load_parameter_from_rtc(int param_idx)
         }
     }
 
-    // Free the old parameter value if it exists
-    if (parameters[param_idx].value != NULL)
-    {
-        free(parameters[param_idx].value);
-        parameters[param_idx].value = NULL;
-    }
+    param_value_t *value = &param_values[param_idx];
+
     // Load date from RTC
-    if (parameters[param_idx].address == PARAM_ADDRESS_DATE)
+    if (param_idx == PARAM_ID_DATE)
     {
         // if (strcmp(parameters[param_idx].name, "2.Date:") == 0) {
         uint8_t day = bcd_to_binary(rtc_registers[4]);
@@ -1189,31 +1071,15 @@ esp_err_t load_parameter_from_rtc(int param_idx)
         if (month < 1 || month > 12 || day < 1 || day > 31)
         {
             ESP_LOGW("RTC", "Invalid date values read from RTC: %02d/%02d/%02d", day, month, year);
-            if (parameters[param_idx].value != NULL)
-            {
-                free(parameters[param_idx].value);
-            }
-            parameters[param_idx].value = strdup("010123");
+            value->date.day = 1;
+            value->date.month = 1;
+            value->date.year = 23;
         }
         else
         {
-            // Allocate 8 bytes: 6 for DDMMYY format + 1 for null terminator + 1 extra for safety
-            char *date_str = malloc(8);
-            if (date_str == NULL)
-            {
-                ESP_LOGE("RTC", "Failed to allocate memory for date string");
-                return ESP_ERR_NO_MEM;
-            }
-
-            // Store in DDMMYY format - ensure we have enough space for the format string
-            snprintf(date_str, 8, "%02d%02d%02d", day, month, year);
-
-            // Free old value if it exists
-            if (parameters[param_idx].value != NULL)
-            {
-                free(parameters[param_idx].value);
-            }
-            parameters[param_idx].value = date_str;
+            value->date.day = day;
+            value->date.month = month;
+            value->date.year = year;
 
             // Log in DD/MM/YY format for debugging
             ESP_LOGI("RTC", "Loaded date: %02d/%02d/%02d", day, month, year);
@@ -1221,7 +1087,7 @@ esp_err_t load_parameter_from_rtc(int param_idx)
     }
     // else if (strcmp(parameters[param_idx].name, "1.Time:") == 0)
     // Load time from RTC
-    else if (parameters[param_idx].address == PARAM_ADDRESS_TIME)
+    else if (param_idx == PARAM_ID_TIME)
     {
         // Get time from RTC: HH:MM format
         uint8_t hour = bcd_to_binary(rtc_registers[2]);
@@ -1231,15 +1097,15 @@ esp_err_t load_parameter_from_rtc(int param_idx)
         if (hour > 23 || minute > 59)
         {
             ESP_LOGW("RTC", "Invalid time values read from RTC: %02d:%02d", hour, minute);
-            parameters[param_idx].value = strdup("00:00"); // Default time
+            hour = 0; // Default time
+            minute = 0;
         }
         else
         {
-            char time_str[16];
-            snprintf(time_str, sizeof(time_str), "%02d:%02d", hour, minute);
-            parameters[param_idx].value = strdup(time_str);
-            ESP_LOGI("RTC", "Loaded time: %s", time_str);
+            ESP_LOGI("RTC", "Loaded time: %02d:%02d", hour, minute);
         }
+        value->time.hour = hour;
+        value->time.minute = minute;
     }
     else
     {
@@ -1250,27 +1116,237 @@ esp_err_t load_parameter_from_rtc(int param_idx)
     return ESP_OK;
 }
 
-// Define EEPROM addresses for different parameters
-#define EEPROM_HI_VOLT_ADDR 0
+// EEPROM parameters live in a journal spread over the whole 24C32. Every
+// store appends a one-page record after the newest one, and boot replays
+// the journal, keeping the newest valid record of each parameter. Records
+// are never rewritten in place: a write cut short by a power loss fails its
+// CRC and the previous record stays in effect. The newest record of every
+// parameter is live, and an append steps over live slots when the journal
+// wraps round to them.
+#define EEPROM_JOURNAL_RECORD_LEN EEPROM_24C32_PAGE_SIZE
+#define EEPROM_JOURNAL_SLOTS (EEPROM_24C32_SIZE / EEPROM_JOURNAL_RECORD_LEN)
+#define EEPROM_JOURNAL_READ_LEN 256 // Replay reads the journal in pieces of this size
+
+typedef struct __attribute__((packed))
+{
+    uint32_t seq;           // One more than the record written before it
+    uint16_t address;       // Parameter address
+    uint8_t type;           // Parameter type, a record of another type is ignored
+    param_value_t value;
+    uint8_t reserved[9];    // 0xFF
+    uint32_t crc;           // esp_rom_crc32_le() of the bytes before it
+} eeprom_journal_record_t;
+
+_Static_assert(sizeof(eeprom_journal_record_t) == EEPROM_JOURNAL_RECORD_LEN,
+               "An EEPROM journal record is one 24C32 page");
+
+static int16_t eeprom_live_slot[NUM_PARAMETERS]; // Newest record of each parameter, -1 for none
+static uint32_t eeprom_slot_live[EEPROM_JOURNAL_SLOTS / 32]; // The same, one bit per slot
+static uint32_t eeprom_journal_seq = 0;          // Sequence number of the next record
+static int eeprom_journal_head = 0;              // Slot the next record is written to
+static bool eeprom_journal_ready = false;
+
+// Every EEPROM parameter pins the slot of its live record and appends
+// rotate through the rest. Keep those the large majority, or wear piles up
+// on the few free slots and an append eventually finds none.
+#define PARAM_IN_EEPROM(arg, id, num, label, type_, group_, storage_, ...) + ((storage_) == STORAGE_EEPROM)
+#define EEPROM_PARAM_COUNT (0 PARAM_LIST(PARAM_IN_EEPROM, _))
+_Static_assert(EEPROM_PARAM_COUNT * 4 <= EEPROM_JOURNAL_SLOTS,
+               "Too many EEPROM parameters for the journal to wear-level");
+
+// Firmware before the journal wrote the value's text, NUL terminated, at
+// the parameter address
+#define EEPROM_LEGACY_TEXT_LEN 32
+
+static bool eeprom_journal_valid(const eeprom_journal_record_t *record)
+{
+    return record->crc == esp_rom_crc32_le(0, (const uint8_t *)record, offsetof(eeprom_journal_record_t, crc));
+}
+
+static bool eeprom_slot_is_live(int slot)
+{
+    return (eeprom_slot_live[slot / 32] >> (slot % 32)) & 1;
+}
+
+// Make slot the live record of a parameter, -1 for none
+static void eeprom_set_live_slot(int param_idx, int slot)
+{
+    int old = eeprom_live_slot[param_idx];
+    if (old >= 0)
+    {
+        eeprom_slot_live[old / 32] &= ~(1u << (old % 32));
+    }
+    eeprom_live_slot[param_idx] = slot;
+    if (slot >= 0)
+    {
+        eeprom_slot_live[slot / 32] |= 1u << (slot % 32);
+    }
+}
+
+// Append value as the newest record of an EEPROM parameter
+static esp_err_t eeprom_journal_append(int param_idx, const param_value_t *value)
+{
+    ESP_LOGI("Storage", "Storing parameter %s to EEPROM", parameters[param_idx].name);
+
+    // Its own live record is stepped over as well, it is the fallback
+    // should this write not complete
+    int slot = eeprom_journal_head;
+    for (int tries = 0; eeprom_slot_is_live(slot); tries++)
+    {
+        if (tries == EEPROM_JOURNAL_SLOTS)
+        {
+            ESP_LOGE("Storage", "EEPROM journal has no free slot");
+            return ESP_ERR_NO_MEM;
+        }
+        slot = (slot + 1) % EEPROM_JOURNAL_SLOTS;
+    }
+
+    eeprom_journal_record_t record;
+    memset(&record, 0xFF, sizeof(record));
+    record.seq = eeprom_journal_seq++;
+    record.address = parameters[param_idx].address;
+    record.type = parameters[param_idx].type;
+    record.value = *value;
+    record.crc = esp_rom_crc32_le(0, (const uint8_t *)&record, offsetof(eeprom_journal_record_t, crc));
 
-// Store a parameter to EEPROM (24C32)
+    // A failed write may have left part of a record, the slot is not reused
+    // until the journal comes round again
+    eeprom_journal_head = (slot + 1) % EEPROM_JOURNAL_SLOTS;
+    esp_err_t ret = eeprom_write(slot * EEPROM_JOURNAL_RECORD_LEN, (uint8_t *)&record, sizeof(record));
+    if (ret == ESP_OK)
+    {
+        eeprom_set_live_slot(param_idx, slot);
+    }
+    return ret;
+}
+
+// Store a parameter to EEPROM (24C32) by appending it to the journal
 esp_err_t store_parameter_to_eeprom(int param_idx)
 {
-    if (param_idx < 0 || param_idx >= NUM_PARAMETERS || parameters[param_idx].value == NULL)
+    if (param_idx < 0 || param_idx >= NUM_PARAMETERS)
     {
         return ESP_ERR_INVALID_ARG;
     }
+    xSemaphoreTake(param_store_lock, portMAX_DELAY);
+    esp_err_t ret = eeprom_journal_append(param_idx, &param_values[param_idx]);
+    xSemaphoreGive(param_store_lock);
+    return ret;
+}
 
-    ESP_LOGI("Storage", "Storing parameter %s to EEPROM", parameters[param_idx].name);
+// Value of a parameter saved by firmware before the journal, false if none
+static bool eeprom_legacy_load(const parameter_t *param)
+{
+    char text[EEPROM_LEGACY_TEXT_LEN + 1];
+    if (param->address + EEPROM_LEGACY_TEXT_LEN > EEPROM_24C32_SIZE ||
+        eeprom_read(param->address, (uint8_t *)text, EEPROM_LEGACY_TEXT_LEN) != ESP_OK)
+    {
+        return false;
+    }
+    text[EEPROM_LEGACY_TEXT_LEN] = '\0';
+    return param_value_parse(param, text, param_value_of(param));
+}
+
+// Replay the journal into every EEPROM parameter. A part without a single
+// valid record is taken to hold the older layout; whatever is found there
+// is loaded and written to a new journal.
+static void eeprom_journal_replay(void)
+{
+    static uint8_t image[EEPROM_JOURNAL_READ_LEN];
+    static uint32_t live_seq[NUM_PARAMETERS];
+    int records = 0;
+    int newest_slot = -1;
+    uint32_t newest_seq = 0;
+    esp_err_t ret = ESP_OK;
 
-    int address = parameters[param_idx].address;
-    const char *value = (const char *)parameters[param_idx].value;
-    int value_len = strlen(value) + 1; // Include null terminator
+    for (int i = 0; i < NUM_PARAMETERS; i++)
+    {
+        eeprom_live_slot[i] = -1;
+    }
+    memset(eeprom_slot_live, 0, sizeof(eeprom_slot_live));
 
-    return eeprom_write(address, (uint8_t *)value, value_len);
+    for (int base = 0; base < EEPROM_24C32_SIZE && ret == ESP_OK; base += sizeof(image))
+    {
+        ret = eeprom_read(base, image, sizeof(image));
+        for (size_t offset = 0; ret == ESP_OK && offset < sizeof(image); offset += EEPROM_JOURNAL_RECORD_LEN)
+        {
+            eeprom_journal_record_t record;
+            memcpy(&record, &image[offset], sizeof(record));
+            if (!eeprom_journal_valid(&record))
+            {
+                continue;
+            }
+
+            int slot = (base + offset) / EEPROM_JOURNAL_RECORD_LEN;
+            records++;
+            if (newest_slot < 0 || (int32_t)(record.seq - newest_seq) > 0)
+            {
+                newest_slot = slot;
+                newest_seq = record.seq;
+            }
+
+            // Records of parameters that moved storage or changed type are dead
+            int i = param_index_from_address(record.address);
+            if (i >= 0 && parameters[i].storage == STORAGE_EEPROM && parameters[i].type == record.type &&
+                (eeprom_live_slot[i] < 0 || (int32_t)(record.seq - live_seq[i]) > 0))
+            {
+                eeprom_set_live_slot(i, slot);
+                live_seq[i] = record.seq;
+                param_values[i] = record.value;
+            }
+        }
+    }
+
+    if (ret != ESP_OK)
+    {
+        ESP_LOGE("Storage", "EEPROM journal unreadable, using defaults");
+        for (int i = 0; i < NUM_PARAMETERS; i++)
+        {
+            eeprom_live_slot[i] = -1;
+        }
+        memset(eeprom_slot_live, 0, sizeof(eeprom_slot_live));
+    }
+    else if (records > 0)
+    {
+        eeprom_journal_head = (newest_slot + 1) % EEPROM_JOURNAL_SLOTS;
+        eeprom_journal_seq = newest_seq + 1;
+        ESP_LOGI("Storage", "EEPROM journal: %d valid records, next slot %d, sequence %lu", records,
+                 eeprom_journal_head, (unsigned long)eeprom_journal_seq);
+    }
+    eeprom_journal_ready = true;
+
+    bool migrate = (ret == ESP_OK && records == 0);
+    for (int i = 0; i < NUM_PARAMETERS; i++)
+    {
+        const parameter_t *param = &parameters[i];
+        if (param->storage != STORAGE_EEPROM || eeprom_live_slot[i] >= 0)
+        {
+            continue;
+        }
+        if (migrate && eeprom_legacy_load(param))
+        {
+            ESP_LOGI("Storage", "Moving %s to the EEPROM journal", param->name);
+            param_value_check(i);
+            store_parameter_to_eeprom(i);
+        }
+        else
+        {
+            param_value_set_default(param);
+            ESP_LOGW("Storage", "Using default value for parameter %s", param->name);
+        }
+    }
+
+    // Validate the parameter values
+    for (int i = 0; i < NUM_PARAMETERS; i++)
+    {
+        if (parameters[i].storage == STORAGE_EEPROM)
+        {
+            param_value_check(i);
+        }
+    }
 }
 
-// Load a parameter from EEPROM (24C32)
+// Load a parameter from EEPROM (24C32): its newest journal record, or the
+// whole journal when it has not been replayed yet
 esp_err_t load_parameter_from_eeprom(int param_idx)
 {
     if (param_idx < 0 || param_idx >= NUM_PARAMETERS)
@@ -1280,53 +1356,384 @@ esp_err_t load_parameter_from_eeprom(int param_idx)
 
     ESP_LOGI("Storage", "Loading parameter %s from EEPROM", parameters[param_idx].name);
 
-    int address = parameters[param_idx].address;
+    if (!eeprom_journal_ready)
+    {
+        eeprom_journal_replay();
+        return ESP_OK;
+    }
 
-    // Allocate memory for parameter value if not already allocated
-    if (parameters[param_idx].value == NULL)
+    const parameter_t *param = &parameters[param_idx];
+    eeprom_journal_record_t record;
+    if (eeprom_live_slot[param_idx] >= 0 &&
+        eeprom_read(eeprom_live_slot[param_idx] * EEPROM_JOURNAL_RECORD_LEN, (uint8_t *)&record, sizeof(record)) == ESP_OK &&
+        eeprom_journal_valid(&record))
+    {
+        param_values[param_idx] = record.value;
+    }
+    else
     {
-        parameters[param_idx].value = malloc(32);
-        if (parameters[param_idx].value == NULL)
+        param_value_set_default(param);
+        ESP_LOGW("Storage", "Using default value for parameter %s", param->name);
+    }
+
+    // Validate the parameter value
+    param_value_check(param_idx);
+
+    return ESP_OK;
+}
+
+// NVS parameters are kept as a single blob under PARAM_BLOB_KEY: a header,
+// then one record per parameter keyed by its address. Everything but the
+// password is stored as a 32-bit integer: numbers and choices as they are,
+// decimals in their fixed-point form, times as HHMM and dates as DDMMYY.
+// Text records go through param_value_parse(). Records for unknown
+// addresses are skipped, so parameters can be added or retired without a
+// version bump; the version only changes with the record layout.
+#define PARAM_BLOB_KEY "param_blob"
+#define PARAM_BLOB_MAGIC 0x5042 // "PB"
+#define PARAM_BLOB_VERSION 1
+#define PARAM_TEXT_MAX_LEN 16 // Longest text record, and legacy string value
+
+// Largest record of each NVS parameter: address, tag and a 32-bit value, or
+// for text (the password) address, tag, length byte and the characters
+#define PARAM_BLOB_RECORD_LEN(arg, id, num, label, type_, group_, storage_, ...) \
+    + ((storage_) != STORAGE_NVS ? 0 : (type_) == PARAM_TYPE_PASSWORD ? 3 + PARAM_TEXT_MAX_LEN : 7)
+#define PARAM_BLOB_MAX_LEN (sizeof(param_blob_header_t) + (0 PARAM_LIST(PARAM_BLOB_RECORD_LEN, _)))
+
+typedef struct __attribute__((packed))
+{
+    uint16_t magic;
+    uint8_t version;
+    uint16_t length;        // Record bytes after the header
+    uint32_t crc;           // esp_rom_crc32_le() of those bytes
+} param_blob_header_t;
+
+typedef enum
+{
+    PARAM_BLOB_INT = 1,     // int32_t, little endian
+    PARAM_BLOB_TEXT = 2     // Length byte, then the characters without a terminator
+} param_blob_tag_t;
+
+static uint8_t param_blob[PARAM_BLOB_MAX_LEN];
+
+// Integer form of a value for the blob, false if it is stored as text
+static bool param_blob_to_int(const parameter_t *param, const param_value_t *value, int32_t *out)
+{
+    switch (param->type)
+    {
+    case PARAM_TYPE_NUMBER:
+        *out = value->number;
+        return true;
+    case PARAM_TYPE_DECIMAL:
+        *out = value->decimal;
+        return true;
+    case PARAM_TYPE_TIME:
+        *out = value->time.hour * 100 + value->time.minute;
+        return true;
+    case PARAM_TYPE_DATE:
+        *out = value->date.day * 10000 + value->date.month * 100 + value->date.year;
+        return true;
+    case PARAM_TYPE_ENABLE_DISABLE:
+    case PARAM_TYPE_MULTIPLE:
+        *out = value->choice;
+        return true;
+    default:
+        return false;
+    }
+}
+
+static void param_blob_from_int(const parameter_t *param, int32_t number, param_value_t *value)
+{
+    memset(value, 0, sizeof(*value));
+    switch (param->type)
+    {
+    case PARAM_TYPE_NUMBER:
+        value->number = number;
+        break;
+    case PARAM_TYPE_DECIMAL:
+        value->decimal = number;
+        break;
+    case PARAM_TYPE_TIME:
+        value->time.hour = number / 100;
+        value->time.minute = number % 100;
+        break;
+    case PARAM_TYPE_DATE:
+        value->date.day = number / 10000;
+        value->date.month = (number / 100) % 100;
+        value->date.year = number % 100;
+        break;
+    case PARAM_TYPE_ENABLE_DISABLE:
+    case PARAM_TYPE_MULTIPLE:
+        value->choice = number;
+        break;
+    default:
+        break;
+    }
+}
+
+// Serialise every NVS parameter of values, a table indexed like
+// param_values, into param_blob. Returns the total length.
+static size_t param_blob_encode(const param_value_t *values)
+{
+    size_t pos = sizeof(param_blob_header_t);
+
+    for (int i = 0; i < NUM_PARAMETERS; i++)
+    {
+        const parameter_t *param = &parameters[i];
+        if (param->storage != STORAGE_NVS)
         {
-            ESP_LOGE("Storage", "Failed to allocate memory for parameter value");
-            return ESP_ERR_NO_MEM;
+            continue;
         }
-    }
 
-    // Read value from EEPROM
-    esp_err_t ret = eeprom_read(address, (uint8_t *)parameters[param_idx].value, 32);
+        int32_t number;
+        if (param_blob_to_int(param, &values[i], &number))
+        {
+            param_blob[pos++] = (uint8_t)param->address;
+            param_blob[pos++] = (uint8_t)(param->address >> 8);
+            param_blob[pos++] = PARAM_BLOB_INT;
+            for (int b = 0; b < 4; b++)
+            {
+                param_blob[pos++] = (uint8_t)((uint32_t)number >> (8 * b));
+            }
+        }
+        else
+        {
+            const char *value = values[i].password;
+            size_t len = strnlen(value, PARAM_TEXT_MAX_LEN - 1);
+            param_blob[pos++] = (uint8_t)param->address;
+            param_blob[pos++] = (uint8_t)(param->address >> 8);
+            param_blob[pos++] = PARAM_BLOB_TEXT;
+            param_blob[pos++] = (uint8_t)len;
+            memcpy(&param_blob[pos], value, len);
+            pos += len;
+        }
+    }
+
+    param_blob_header_t header = {
+        .magic = PARAM_BLOB_MAGIC,
+        .version = PARAM_BLOB_VERSION,
+        .length = (uint16_t)(pos - sizeof(header)),
+        .crc = esp_rom_crc32_le(0, &param_blob[sizeof(header)], pos - sizeof(header)),
+    };
+    memcpy(param_blob, &header, sizeof(header));
+    return pos;
+}
 
-    // If read fails, use default value
+// Write the blob of values and commit. NVS leaves flash alone when the
+// stored blob is already identical.
+static esp_err_t param_blob_store(nvs_handle_t handle, const param_value_t *values)
+{
+    size_t len = param_blob_encode(values);
+    esp_err_t ret = nvs_set_blob(handle, PARAM_BLOB_KEY, param_blob, len);
+    if (ret == ESP_OK)
+    {
+        ret = nvs_commit(handle);
+    }
     if (ret != ESP_OK)
     {
-        strcpy((char *)parameters[param_idx].value, parameters[param_idx].default_value);
-        ESP_LOGW("Storage", "Using default value for parameter %s", parameters[param_idx].name);
+        ESP_LOGE("Storage", "Failed to store parameter blob: %s", esp_err_to_name(ret));
     }
+    return ret;
+}
 
-    // Validate the parameter value
-    if (parameters[param_idx].validate != NULL)
+// Decode a blob read into param_blob. Parameters it holds are set in
+// loaded; a damaged blob sets none and returns an error.
+static esp_err_t param_blob_decode(size_t len, bool loaded[NUM_PARAMETERS])
+{
+    param_blob_header_t header;
+    if (len < sizeof(header))
     {
-        parameters[param_idx].validate(parameters[param_idx].value);
+        return ESP_ERR_INVALID_SIZE;
     }
+    memcpy(&header, param_blob, sizeof(header));
+    if (header.magic != PARAM_BLOB_MAGIC || header.version != PARAM_BLOB_VERSION)
+    {
+        return ESP_ERR_INVALID_VERSION;
+    }
+    if (header.length != len - sizeof(header) ||
+        header.crc != esp_rom_crc32_le(0, &param_blob[sizeof(header)], header.length))
+    {
+        return ESP_ERR_INVALID_CRC;
+    }
+
+    const uint8_t *p = &param_blob[sizeof(header)];
+    const uint8_t *end = p + header.length;
+    while (p < end)
+    {
+        if (end - p < 3)
+        {
+            return ESP_ERR_INVALID_SIZE;
+        }
+        int address = p[0] | (p[1] << 8);
+        p += 2;
+        uint8_t tag = *p++;
+
+        size_t len_needed = (tag == PARAM_BLOB_INT) ? 4 : (p < end ? 1u + *p : 1);
+        if ((size_t)(end - p) < len_needed)
+        {
+            return ESP_ERR_INVALID_SIZE;
+        }
+
+        int param_idx = param_index_from_address(address);
+        if (param_idx >= 0 && parameters[param_idx].storage != STORAGE_NVS)
+        {
+            param_idx = -1;
+        }
 
+        param_value_t value;
+        bool parsed = false;
+        if (tag == PARAM_BLOB_INT)
+        {
+            uint32_t number = p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+            if (param_idx >= 0)
+            {
+                param_blob_from_int(&parameters[param_idx], (int32_t)number, &value);
+                parsed = true;
+            }
+        }
+        else if (tag == PARAM_BLOB_TEXT)
+        {
+            char text[PARAM_TEXT_MAX_LEN];
+            size_t text_len = p[0] < sizeof(text) - 1 ? p[0] : sizeof(text) - 1;
+            memcpy(text, p + 1, text_len);
+            text[text_len] = '\0';
+            parsed = param_idx >= 0 && param_value_parse(&parameters[param_idx], text, &value);
+        }
+        else
+        {
+            return ESP_ERR_INVALID_RESPONSE;
+        }
+        p += len_needed;
+
+        // An unparsable text record is left for the defaults pass
+        if (parsed)
+        {
+            param_values[param_idx] = value;
+            param_value_check(param_idx);
+            loaded[param_idx] = true;
+        }
+    }
     return ESP_OK;
 }
 
-// Store a parameter to its designated storage
-void store_parameter(int param_idx)
+// Load every NVS parameter with a single blob read. Anything the blob does
+// not cover gets its default and the blob is written back. Values saved
+// one string per parameter name by older firmware are picked up once,
+// then those keys are erased.
+static void param_blob_load(nvs_handle_t handle)
+{
+    static bool loaded[NUM_PARAMETERS];
+    bool legacy = false;
+    int defaults = 0;
+    int migrated = 0;
+
+    memset(loaded, 0, sizeof(loaded));
+
+    size_t len = sizeof(param_blob);
+    esp_err_t ret = nvs_get_blob(handle, PARAM_BLOB_KEY, param_blob, &len);
+    if (ret == ESP_OK)
+    {
+        ret = param_blob_decode(len, loaded);
+        if (ret == ESP_OK)
+        {
+            ESP_LOGI("Storage", "Loaded NVS parameters from a %u byte blob", (unsigned)len);
+        }
+        else
+        {
+            ESP_LOGE("Storage", "Parameter blob rejected (%s), using defaults", esp_err_to_name(ret));
+        }
+    }
+    else if (ret == ESP_ERR_NVS_NOT_FOUND)
+    {
+        legacy = true;
+    }
+    else
+    {
+        ESP_LOGE("Storage", "Failed to read parameter blob: %s", esp_err_to_name(ret));
+    }
+
+    for (int i = 0; i < NUM_PARAMETERS; i++)
+    {
+        if (parameters[i].storage != STORAGE_NVS || loaded[i])
+        {
+            continue;
+        }
+
+        char value[PARAM_TEXT_MAX_LEN];
+        size_t value_len = sizeof(value);
+        if (legacy && nvs_get_str(handle, parameters[i].name, value, &value_len) == ESP_OK &&
+            param_value_parse(&parameters[i], value, &param_values[i]))
+        {
+            param_value_check(i);
+            nvs_erase_key(handle, parameters[i].name);
+            ESP_LOGD("Storage", "Migrated %s: %s to the parameter blob", parameters[i].name, value);
+            migrated++;
+        }
+        else
+        {
+            param_value_set_default(&parameters[i]);
+            ESP_LOGD("Storage", "No stored value, default %s: %s", parameters[i].name, parameters[i].default_value);
+            defaults++;
+        }
+    }
+
+    // One line however large the table, a log line per parameter would
+    // dominate boot time
+    if (migrated > 0)
+    {
+        ESP_LOGI("Storage", "Migrated %d parameters to the parameter blob", migrated);
+    }
+    if (defaults > 0)
+    {
+        ESP_LOGI("Storage", "%d parameters had no stored value, using defaults", defaults);
+    }
+    if (migrated + defaults > 0)
+    {
+        param_blob_store(handle, param_values);
+    }
+}
+
+// Store a parameter to its designated storage, taking the value from
+// values, a table indexed like param_values. The RTC is always set from
+// param_values itself. EEPROM and NVS writes need param_store_lock held.
+static esp_err_t param_store_value(int param_idx, const param_value_t *values)
 {
+    int64_t start_us = TRACE_NOW();
+    esp_err_t ret = ESP_OK;
     switch (parameters[param_idx].storage)
     {
     case STORAGE_NVS:
-        // In this case, we'll store it later in batch
+        // The whole blob is rewritten, one entry for every NVS parameter
+        ret = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &my_nvs_handle);
+        if (ret == ESP_OK)
+        {
+            ret = param_blob_store(my_nvs_handle, values);
+            nvs_close(my_nvs_handle);
+        }
         break;
     case STORAGE_RTC:
-        store_parameter_to_rtc(param_idx);
+        ret = store_parameter_to_rtc(param_idx);
         break;
     case STORAGE_EEPROM:
-        store_parameter_to_eeprom(param_idx);
+        ret = eeprom_journal_append(param_idx, &values[param_idx]);
         break;
     }
+    TRACE_PARAM_STORED(param_idx, start_us);
+    return ret;
+}
+
+esp_err_t store_parameter(int param_idx)
+{
+    // RTC parameters are stored from param_edited() with param_lock held,
+    // so they must not wait for a flush
+    if (parameters[param_idx].storage == STORAGE_RTC)
+    {
+        return param_store_value(param_idx, param_values);
+    }
+    xSemaphoreTake(param_store_lock, portMAX_DELAY);
+    esp_err_t ret = param_store_value(param_idx, param_values);
+    xSemaphoreGive(param_store_lock);
+    return ret;
 }
 
 // Load a parameter from its designated storage
@@ -1337,15 +1744,14 @@ void load_parameter(int param_idx)
     switch (parameters[param_idx].storage)
     {
     case STORAGE_NVS:
-        // Will be loaded in batch later
+        // Loaded with the rest of the blob by load_all_parameters()
         break;
     case STORAGE_RTC:
         ret = load_parameter_from_rtc(param_idx);
         if (ret != ESP_OK)
         {
             ESP_LOGE("Storage", "Failed to load from RTC, using default");
-            parameters[param_idx].value = strdup((char *)parameters[param_idx].default_value);
-            parameters[param_idx].validate(parameters[param_idx].value);
+            param_value_set_default(&parameters[param_idx]);
         }
         break;
     case STORAGE_EEPROM:
@@ -1353,8 +1759,7 @@ void load_parameter(int param_idx)
         if (ret != ESP_OK)
         {
             ESP_LOGE("Storage", "Failed to load from EEPROM, using default");
-            parameters[param_idx].value = strdup((char *)parameters[param_idx].default_value);
-            parameters[param_idx].validate(parameters[param_idx].value);
+            param_value_set_default(&parameters[param_idx]);
         }
         break;
     }
@@ -1363,225 +1768,583 @@ void load_parameter(int param_idx)
 // Store all parameters to their respective storage
 void store_all_parameters(void)
 {
-    // First, count NVS parameters so we can batch them
-    int nvs_count = 0;
-    for (int i = 0; i < NUM_PARAMETERS; i++)
+    xSemaphoreTake(param_store_lock, portMAX_DELAY);
+
+    // First, count NVS parameters so we can batch them
+    int nvs_count = 0;
+    for (int i = 0; i < NUM_PARAMETERS; i++)
+    {
+        if (parameters[i].storage == STORAGE_NVS)
+        {
+            nvs_count++;
+        }
+        else
+        {
+            // Store non-NVS parameters individually
+            param_store_value(i, param_values);
+        }
+    }
+
+    // All NVS parameters go out together as one blob
+    if (nvs_count > 0 && nvs_open(NVS_NAMESPACE, NVS_READWRITE, &my_nvs_handle) == ESP_OK)
+    {
+        param_blob_store(my_nvs_handle, param_values);
+        nvs_close(my_nvs_handle);
+    }
+
+    xSemaphoreGive(param_store_lock);
+}
+
+// Edited parameters are only marked dirty. The flush task writes them once
+// no further edit has come in for PARAM_FLUSH_DELAY_MS, so a configuration
+// session costs one NVS commit rather than one per keypress, and parameters
+// that were not touched are not rewritten.
+#define PARAM_FLUSH_DELAY_MS 2000
+
+static uint32_t param_dirty[(NUM_PARAMETERS + 31) / 32];
+static SemaphoreHandle_t param_lock = NULL; // Held while values or dirty bits change
+static TaskHandle_t param_flush_handle = NULL;
+
+esp_err_t param_store_init(void)
+{
+    param_lock = xSemaphoreCreateMutex();
+    param_store_lock = xSemaphoreCreateMutex();
+    if (param_lock == NULL || param_store_lock == NULL)
+    {
+        ESP_LOGE("Storage", "Failed to create parameter locks");
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+static void param_lock_take(void)
+{
+    xSemaphoreTake(param_lock, portMAX_DELAY);
+}
+
+static void param_lock_give(void)
+{
+    xSemaphoreGive(param_lock);
+}
+
+static bool param_is_dirty(int param_idx)
+{
+    return (param_dirty[param_idx / 32] >> (param_idx % 32)) & 1;
+}
+
+// Call with param_lock held, after the value has changed
+static void param_set_dirty(int param_idx)
+{
+    param_dirty[param_idx / 32] |= 1u << (param_idx % 32);
+    if (param_flush_handle != NULL)
+    {
+        xTaskNotifyGive(param_flush_handle);
+    }
+}
+
+// Write every dirty parameter: all NVS ones in a single blob commit, RTC
+// and EEPROM ones one record each. A failed write stays dirty and is
+// retried with the next flush.
+//
+// The values are copied under param_lock and written out without it, so
+// keyboard_task can go on editing while EEPROM pages and the NVS commit take
+// their time. A parameter edited again meanwhile stays dirty; its edit has
+// already queued the next flush. The RTC write is short and is done under
+// the lock from the live value, so it cannot overtake one made by an edit.
+void param_flush(void)
+{
+    static param_value_t snapshot[NUM_PARAMETERS];
+    static uint32_t stored[(NUM_PARAMETERS + 31) / 32];
+    static uint32_t pending[(NUM_PARAMETERS + 31) / 32];
+
+    // One flush at a time, and no other EEPROM or NVS writer meanwhile
+    xSemaphoreTake(param_store_lock, portMAX_DELAY);
+    param_lock_take();
+    memcpy(pending, param_dirty, sizeof(pending));
+    memcpy(snapshot, param_values, sizeof(snapshot));
+    param_lock_give();
+    memset(stored, 0, sizeof(stored));
+
+    int nvs_first = -1;
+    int written = 0;
+    for (int i = 0; i < NUM_PARAMETERS; i++)
+    {
+        if (!((pending[i / 32] >> (i % 32)) & 1))
+        {
+            continue;
+        }
+        switch (parameters[i].storage)
+        {
+        case STORAGE_NVS:
+            if (nvs_first < 0)
+            {
+                nvs_first = i;
+            }
+            break;
+        case STORAGE_RTC:
+            param_lock_take();
+            if (param_is_dirty(i) && param_store_value(i, param_values) == ESP_OK)
+            {
+                param_dirty[i / 32] &= ~(1u << (i % 32));
+                written++;
+            }
+            param_lock_give();
+            break;
+        case STORAGE_EEPROM:
+            if (param_store_value(i, snapshot) == ESP_OK)
+            {
+                stored[i / 32] |= 1u << (i % 32);
+            }
+            break;
+        }
+    }
+
+    // Storing any NVS parameter commits the whole blob
+    if (nvs_first >= 0 && param_store_value(nvs_first, snapshot) == ESP_OK)
+    {
+        for (int i = nvs_first; i < NUM_PARAMETERS; i++)
+        {
+            if (parameters[i].storage == STORAGE_NVS)
+            {
+                stored[i / 32] |= pending[i / 32] & (1u << (i % 32));
+            }
+        }
+    }
+
+    // Only what is still the value written is clean now
+    param_lock_take();
+    for (int i = 0; i < NUM_PARAMETERS; i++)
+    {
+        if (((stored[i / 32] >> (i % 32)) & 1) && memcmp(&snapshot[i], &param_values[i], sizeof(snapshot[i])) == 0)
+        {
+            param_dirty[i / 32] &= ~(1u << (i % 32));
+            written++;
+        }
+    }
+    param_lock_give();
+    xSemaphoreGive(param_store_lock);
+
+    if (written > 0)
+    {
+        ESP_LOGI("Storage", "Flushed %d edited parameter%s", written, written == 1 ? "" : "s");
+    }
+}
+
+// Record an edit made with param_lock held. before is the value prior to
+// the edit; nothing is queued if it did not change. RTC parameters set the
+// clock, so they are written at once rather than with the flush.
+static void param_edited(int param_idx, const param_value_t *before)
+{
+    if (memcmp(before, &param_values[param_idx], sizeof(*before)) == 0)
+    {
+        return;
+    }
+    if (parameters[param_idx].storage != STORAGE_RTC || store_parameter(param_idx) != ESP_OK)
+    {
+        param_set_dirty(param_idx);
+    }
+}
+
+void param_flush_task(void *pvParameters)
+{
+    // Edits made before the handle was published notified nobody
+    param_lock_take();
+    param_flush_handle = xTaskGetCurrentTaskHandle();
+    for (int w = 0; w < (NUM_PARAMETERS + 31) / 32; w++)
+    {
+        if (param_dirty[w] != 0)
+        {
+            xTaskNotifyGive(param_flush_handle);
+            break;
+        }
+    }
+    param_lock_give();
+
+    while (1)
+    {
+        // Wait for an edit, then for the edits to stop
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        while (ulTaskNotifyTake(pdTRUE, PARAM_FLUSH_DELAY_MS / portTICK_PERIOD_MS) > 0)
+        {
+        }
+        param_flush();
+    }
+}
+
+// Fix the load_all_parameters function to prioritize stored values over defaults
+void load_all_parameters(void)
+{
+    // Each description used to sit in RAM beside its value
+    ESP_LOGI("Storage", "Parameter store: %d entries, %u bytes of values in RAM, %u bytes of descriptions in flash, "
+             "%u bytes of RAM saved per entry",
+             NUM_PARAMETERS, (unsigned)sizeof(param_values), (unsigned)sizeof(parameters), (unsigned)sizeof(parameter_t));
+
+    // First load parameters from special storage (RTC, EEPROM)
+    for (int i = 0; i < NUM_PARAMETERS; i++)
+    {
+        if (parameters[i].storage == STORAGE_RTC)
+        {
+            load_parameter(i);
+        }
+    }
+    eeprom_journal_replay();
+
+    // Then every NVS parameter from the one blob
+    if (nvs_open(NVS_NAMESPACE, NVS_READWRITE, &my_nvs_handle) != ESP_OK)
+    {
+        ESP_LOGE("Storage", "Failed to open NVS, using defaults");
+        for (int i = 0; i < NUM_PARAMETERS; i++)
+        {
+            if (parameters[i].storage == STORAGE_NVS)
+            {
+                param_value_set_default(&parameters[i]);
+            }
+        }
+        return;
+    }
+    param_blob_load(my_nvs_handle);
+    nvs_close(my_nvs_handle);
+}
+
+// Replace the old store_parameters_to_nvs with store_all_parameters
+void store_parameters_to_nvs(void)
+{
+    store_all_parameters();
+}
+
+// Replace the old load_parameters_from_nvs with load_all_parameters
+void load_parameters_from_nvs(void)
+{
+    load_all_parameters();
+}
+
+static void IRAM_ATTR keypad_int_isr(void *arg)
+{
+    BaseType_t higher_priority_task_woken = pdFALSE;
+    xSemaphoreGiveFromISR(keypad_int_semaphore, &higher_priority_task_woken);
+    if (higher_priority_task_woken)
+    {
+        portYIELD_FROM_ISR();
+    }
+}
+
+// Called after a scan that ended with every row driven low. That final read
+// also cleared /INT; if no column read low the keypad is idle and
+// keypad_scan() can stop polling.
+static void keypad_arm(uint8_t idle_data)
+{
+    if (!keypad_int_enabled)
+    {
+        return;
+    }
+
+    // Drop edges caused by the row scan itself
+    xSemaphoreTake(keypad_int_semaphore, 0);
+    keypad_int_pending = false;
+
+    keypad_armed = ((idle_data & KEYPAD_IDLE_MASK) == KEYPAD_IDLE_MASK);
+}
+
+// True if the expander has flagged a change since the keypad was armed
+static bool keypad_int_asserted(void)
+{
+    if (keypad_int_pending)
+    {
+        return true;
+    }
+    if (xSemaphoreTake(keypad_int_semaphore, 0) == pdTRUE)
+    {
+        return true;
+    }
+    // The line stays low until the port is read, catch an edge we missed
+    return gpio_get_level(KEYPAD_INT_GPIO) == 0;
+}
+
+// Block until the keypad needs scanning or timeout_ticks pass. While idle
+// this sleeps on /INT; while a key is down it falls back to KEYPAD_POLL_MS.
+static bool keypad_wait_for_activity(TickType_t timeout_ticks)
+{
+    if (!keypad_armed)
+    {
+        TickType_t poll_ticks = KEYPAD_POLL_MS / portTICK_PERIOD_MS;
+        if (poll_ticks == 0)
+        {
+            poll_ticks = 1;
+        }
+        vTaskDelay(timeout_ticks < poll_ticks ? timeout_ticks : poll_ticks);
+        return true;
+    }
+
+    if (keypad_int_pending || gpio_get_level(KEYPAD_INT_GPIO) == 0)
+    {
+        keypad_int_pending = true;
+        return true;
+    }
+
+    if (xSemaphoreTake(keypad_int_semaphore, timeout_ticks) == pdTRUE)
+    {
+        keypad_int_pending = true;
+        return true;
+    }
+    return false;
+}
+
+uint16_t keypad_key_mask(char key)
+{
+    for (int row = 0; row < KEYPAD_ROWS; row++)
+    {
+        for (int col = 0; col < 4; col++)
+        {
+            if (keys[row][col] == key)
+            {
+                return 1u << (row * 4 + col);
+            }
+        }
+    }
+    return 0;
+}
+
+// The matrix has no diodes, so three keys on the corners of a rectangle make
+// the fourth corner read as pressed too. A scan like that can't be trusted.
+static bool keypad_bitmap_ambiguous(uint16_t bitmap)
+{
+    for (int row = 0; row < KEYPAD_ROWS; row++)
+    {
+        uint8_t cols = (bitmap >> (row * 4)) & 0x0F;
+        if ((cols & (cols - 1)) == 0)
+        {
+            continue; // Fewer than two keys in this row
+        }
+        for (int other = 0; other < KEYPAD_ROWS; other++)
+        {
+            if (other != row && ((bitmap >> (other * 4)) & cols))
+            {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+static void keypad_push_event(key_event_type_t type, int bit, TickType_t now, int64_t edge_us)
+{
+    key_event_t event = {
+        .type = type,
+        .key = keys[bit / 4][bit % 4],
+        .keys = keypad_down,
+        .timestamp = now,
+        .edge_us = edge_us,
+        .queued_us = esp_timer_get_time(),
+    };
+
+    // Traced before it is sent, keyboard_task may take it off the queue at once
+    TRACE_KEY_DETECTED(event);
+
+    // Never block the scanner; if the UI is this far behind, drop the event
+    if (xQueueSend(keypad_event_queue, &event, 0) != pdTRUE)
+    {
+        ESP_LOGW("Keypad", "Event queue full, dropping '%c'", event.key);
+    }
+}
+
+// Feed one scan sample through the per-key integrators and queue the
+// resulting press, chord, release, repeat and long-press events. sample_us
+// is when the sample was read; presses and releases carry the time of the
+// sample that first showed them, repeats and long presses this one.
+static void keypad_debounce(uint16_t sample, TickType_t now, int64_t sample_us)
+{
+    for (int bit = 0; bit < 16; bit++)
     {
-        if (parameters[i].storage == STORAGE_NVS)
+        uint16_t mask = 1u << bit;
+        bool down = (keypad_down & mask) != 0;
+
+        // Start of a possible change of state
+        if ((sample & mask) ? (!down && key_integrator[bit] == 0)
+                            : (down && key_integrator[bit] == KEYPAD_DEBOUNCE_SAMPLES))
         {
-            nvs_count++;
+            key_edge_us[bit] = sample_us;
         }
-        else
+
+        if (sample & mask)
         {
-            // Store non-NVS parameters individually
-            store_parameter(i);
+            if (key_integrator[bit] < KEYPAD_DEBOUNCE_SAMPLES)
+            {
+                key_integrator[bit]++;
+            }
+        }
+        else if (key_integrator[bit] > 0)
+        {
+            key_integrator[bit]--;
         }
-    }
 
-    // If we have NVS parameters, batch store them
-    if (nvs_count > 0)
-    {
-        nvs_open(NVS_NAMESPACE, NVS_READWRITE, &my_nvs_handle);
-        for (int i = 0; i < NUM_PARAMETERS; i++)
+        if (!(keypad_down & mask) && key_integrator[bit] == KEYPAD_DEBOUNCE_SAMPLES)
         {
-            if (parameters[i].storage == STORAGE_NVS)
+            bool chord = keypad_down != 0;
+            keypad_down |= mask;
+            keypad_long_sent &= ~mask;
+            key_down_since[bit] = now;
+            keypad_last_key = bit;
+            keypad_next_repeat = now + KEYPAD_REPEAT_DELAY_MS / portTICK_PERIOD_MS;
+            keypad_push_event(chord ? KEY_EVENT_CHORD : KEY_EVENT_PRESS, bit, now, key_edge_us[bit]);
+            ESP_LOGI("Keypad", "Detected '%c'%s (keys 0x%04X)", keys[bit / 4][bit % 4], chord ? " chord" : "", keypad_down);
+        }
+        else if ((keypad_down & mask) && key_integrator[bit] == 0)
+        {
+            keypad_down &= ~mask;
+            if (keypad_last_key == bit)
             {
-                nvs_set_str(my_nvs_handle, parameters[i].name, (char *)parameters[i].value);
+                keypad_last_key = -1;
             }
+            keypad_push_event(KEY_EVENT_RELEASE, bit, now, key_edge_us[bit]);
         }
-        nvs_commit(my_nvs_handle);
-        nvs_close(my_nvs_handle);
     }
-}
 
-// Fix the load_all_parameters function to prioritize stored values over defaults
-void load_all_parameters(void)
-{
-    // First load parameters from special storage (RTC, EEPROM)
-    for (int i = 0; i < NUM_PARAMETERS; i++)
+    // Only the most recent key repeats, and only while nothing else is held
+    if (keypad_last_key >= 0 && keypad_down == (1u << keypad_last_key))
     {
-        if (parameters[i].storage != STORAGE_NVS)
+        int bit = keypad_last_key;
+        // now has reached keypad_next_repeat, written to survive tick wraparound
+        if ((TickType_t)(now - keypad_next_repeat) < portMAX_DELAY / 2)
         {
-            load_parameter(i);
+            keypad_next_repeat = now + KEYPAD_REPEAT_RATE_MS / portTICK_PERIOD_MS;
+            keypad_push_event(KEY_EVENT_REPEAT, bit, now, sample_us);
+        }
+        if (!(keypad_long_sent & (1u << bit)) &&
+            (now - key_down_since[bit]) * portTICK_PERIOD_MS >= KEYPAD_LONG_PRESS_MS)
+        {
+            keypad_long_sent |= 1u << bit;
+            keypad_push_event(KEY_EVENT_LONG_PRESS, bit, now, sample_us);
         }
     }
+}
 
-    // Then batch load from NVS
-    nvs_open(NVS_NAMESPACE, NVS_READWRITE, &my_nvs_handle);
-    for (int i = 0; i < NUM_PARAMETERS; i++)
+// Take one scan sample and feed it to the debouncer
+static void keypad_sample(void)
+{
+    uint8_t row_data[KEYPAD_SCAN_STEPS];
+
+    // Idle and nothing reported on /INT, the keypad has not changed
+    if (keypad_armed)
     {
-        if (parameters[i].storage == STORAGE_NVS)
+        if (!keypad_int_asserted())
         {
-            size_t len = 16;
-            char *value = malloc(len);
-            esp_err_t err = nvs_get_str(my_nvs_handle, parameters[i].name, value, &len);
-            
-            if (err == ESP_OK)
-            {
-                // Successfully loaded from NVS
-                parameters[i].value = value;
-                if (parameters[i].validate != NULL) {
-                    parameters[i].validate(value);
-                }
-                ESP_LOGI("Keypad", "Loaded %s: %s from NVS", parameters[i].name, value);
-            }
-            else
-            {
-                // Failed to load from NVS, use default and store it
-                free(value); // Free the allocated memory since we're not using it
-                parameters[i].value = strdup((char *)parameters[i].default_value);
-                if (parameters[i].validate != NULL) {
-                    parameters[i].validate(parameters[i].value);
-                }
-                
-                // Store the default value to NVS
-                nvs_set_str(my_nvs_handle, parameters[i].name, parameters[i].value);
-                ESP_LOGI("Keypad", "Error loading from NVS. Default value %s: %s", 
-                         parameters[i].name, (char *)parameters[i].default_value);
-            }
+            return;
         }
+        keypad_armed = false;
+        keypad_int_pending = false;
+    }
+
+    // All rows plus the return to idle in one bus transaction
+    int64_t sample_us = esp_timer_get_time();
+    esp_err_t ret = read_pcf8574_matrix(row_data);
+    if (ret != ESP_OK)
+    {
+        return;
+    }
+
+    // Debug raw data for all rows
+    // ESP_LOGI("Keypad", "Raw row data: R0=0x%02X, R1=0x%02X, R2=0x%02X, R3=0x%02X",
+    //          row_data[0], row_data[1], row_data[2], row_data[3]);
+
+    // Columns are P4-P7, a pressed key pulls its column low
+    uint16_t bitmap = 0;
+    for (int row = 0; row < KEYPAD_ROWS; row++)
+    {
+        uint8_t cols = (uint8_t)(~row_data[row] >> 4) & 0x0F;
+        bitmap |= (uint16_t)cols << (row * 4);
+    }
+
+    // A ghosted sample is dropped, the integrators just wait for the next one
+    if (!keypad_bitmap_ambiguous(bitmap))
+    {
+        keypad_debounce(bitmap, xTaskGetTickCount(), sample_us);
+    }
+
+    // Every key settled up, go back to waiting on /INT
+    bool settled = (keypad_down == 0);
+    for (int bit = 0; bit < 16 && settled; bit++)
+    {
+        settled = (key_integrator[bit] == 0);
+    }
+    if (settled)
+    {
+        keypad_arm(row_data[KEYPAD_ROWS]);
     }
-    nvs_commit(my_nvs_handle);
-    nvs_close(my_nvs_handle);
 }
 
-// Replace the old store_parameters_to_nvs with store_all_parameters
-void store_parameters_to_nvs(void)
+static void keypad_scan_task(void *pvParameters)
 {
-    store_all_parameters();
+    while (1)
+    {
+        keypad_sample();
+        keypad_wait_for_activity(portMAX_DELAY);
+    }
 }
 
-// Replace the old load_parameters_from_nvs with load_all_parameters
-void load_parameters_from_nvs(void)
+bool keypad_get_event(key_event_t *event, TickType_t timeout_ticks)
 {
-    load_all_parameters();
+    if (keypad_event_queue == NULL)
+    {
+        vTaskDelay(timeout_ticks);
+        return false;
+    }
+    return xQueueReceive(keypad_event_queue, event, timeout_ticks) == pdTRUE;
 }
 
-char keypad_scan(void)
+esp_err_t keypad_init(i2c_port_t i2c_port)
 {
-    uint8_t row_data[4];
-    char key = '\0';
+    keypad_i2c_port = i2c_port;
+    ESP_LOGI("Keypad", "Initialized keypad on I2C port %d, address 0x%02X", i2c_port, PCF8574_ADDR);
 
-    // Only scan if no button is currently pressed (debounce)
-    if (!button_pressed)
+    // Hook up the PCF8574 /INT line. Without it the scanner keeps polling.
+    keypad_int_semaphore = xSemaphoreCreateBinary();
+    gpio_config_t int_conf = {
+        .pin_bit_mask = 1ULL << KEYPAD_INT_GPIO,
+        .mode = GPIO_MODE_INPUT,
+        .pull_up_en = GPIO_PULLUP_ENABLE,
+        .pull_down_en = GPIO_PULLDOWN_DISABLE,
+        .intr_type = GPIO_INTR_NEGEDGE,
+    };
+    esp_err_t gpio_ret = ESP_FAIL;
+    if (keypad_int_semaphore != NULL)
     {
-        // Scan all rows
-        row_data[0] = read_pcf8574(0b11111110); // Row 1 (P0 low)
-        vTaskDelay(1 / portTICK_PERIOD_MS);
-        row_data[1] = read_pcf8574(0b11111101); // Row 2 (P1 low)
-        vTaskDelay(1 / portTICK_PERIOD_MS);
-        row_data[2] = read_pcf8574(0b11111011); // Row 3 (P2 low)
-        vTaskDelay(1 / portTICK_PERIOD_MS);
-        row_data[3] = read_pcf8574(0b11110111); // Row 4 (P3 low)
-
-        // Debug raw data for all rows
-        // ESP_LOGI("Keypad", "Raw row data: R0=0x%02X, R1=0x%02X, R2=0x%02X, R3=0x%02X",
-        //          row_data[0], row_data[1], row_data[2], row_data[3]);
-
-        // Check for keypress in each row
-        for (int row = 0; row < 4; row++)
+        gpio_ret = gpio_config(&int_conf);
+    }
+    if (gpio_ret == ESP_OK)
+    {
+        // Another driver may already have installed the ISR service
+        gpio_ret = gpio_install_isr_service(0);
+        if (gpio_ret == ESP_ERR_INVALID_STATE)
         {
-            if (row_data[row] == 0xFF)
-                continue; // Skip if I2C read failed
-
-            // Match the patterns from Arduino code
-            switch (row_data[row])
-            {
-            // Row 1 (P0 low)
-            case 238:
-                key = keys[0][0];
-                break; // 1110 1110 - '1'
-            case 222:
-                key = keys[0][1];
-                break; // 1101 1110 - '2'
-            case 190:
-                key = keys[0][2];
-                break; // 1011 1110 - '3'
-            case 126:
-                key = keys[0][3];
-                break; // 0111 1110 - 'A'
-
-            // Row 2 (P1 low)
-            case 237:
-                key = keys[1][0];
-                break; // 1110 1101 - '4'
-            case 221:
-                key = keys[1][1];
-                break; // 1101 1101 - '5'
-            case 189:
-                key = keys[1][2];
-                break; // 1011 1101 - '6'
-            case 125:
-                key = keys[1][3];
-                break; // 0111 1101 - 'B'
-
-            // Row 3 (P2 low)
-            case 235:
-                key = keys[2][0];
-                break; // 1110 1011 - '7'
-            case 219:
-                key = keys[2][1];
-                break; // 1101 1011 - '8'
-            case 187:
-                key = keys[2][2];
-                break; // 1011 1011 - '9'
-            case 123:
-                key = keys[2][3];
-                break; // 0111 1011 - 'C'
-
-            // Row 4 (P3 low)
-            case 231:
-                key = keys[3][0];
-                break; // 1110 0111 - '*'
-            case 215:
-                key = keys[3][1];
-                break; // 1101 0111 - '0'
-            case 183:
-                key = keys[3][2];
-                break; // 1011 0111 - '#'
-            case 119:
-                key = keys[3][3];
-                break; // 0111 0111 - 'D'
-            }
-
-            if (key != '\0')
-            {
-                if (!button_pressed)
-                {
-                    button_pressed = true;
-                    button_timer = xTaskGetTickCount();
-                    pressed_character[0] = key;
-                    pressed_character[1] = '\0';
-                    ESP_LOGI("Keypad", "Detected '%c' (Raw: 0x%02X)", key, row_data[row]);
-                    return key;
-                }
-            }
+            gpio_ret = ESP_OK;
         }
     }
-    else
+    if (gpio_ret == ESP_OK)
+    {
+        gpio_ret = gpio_isr_handler_add(KEYPAD_INT_GPIO, keypad_int_isr, NULL);
+    }
+    if (gpio_ret == ESP_OK)
     {
-        // Handle debounce timeout
-        if ((xTaskGetTickCount() - button_timer) > (DEBOUNCE_DELAY_MS / portTICK_PERIOD_MS))
+        keypad_int_enabled = true;
+        uint8_t row_data[KEYPAD_SCAN_STEPS];
+        if (read_pcf8574_matrix(row_data) == ESP_OK)
         {
-            button_timer = xTaskGetTickCount();
-            button_pressed = false;
-            pressed_character[0] = '\0'; // Reset pressed character
+            keypad_arm(row_data[KEYPAD_ROWS]);
         }
+        ESP_LOGI("Keypad", "Using /INT on GPIO %d", KEYPAD_INT_GPIO);
+    }
+    else
+    {
+        ESP_LOGW("Keypad", "Keypad /INT unavailable, polling instead: %s", esp_err_to_name(gpio_ret));
     }
 
-    return '\0';
-}
-
-esp_err_t keypad_init(i2c_port_t i2c_port)
-{
-    keypad_i2c_port = i2c_port;
-    i2c_semaphore = xSemaphoreCreateMutex();
-    if (i2c_semaphore == NULL)
+    keypad_event_queue = xQueueCreate(KEYPAD_EVENT_QUEUE_LEN, sizeof(key_event_t));
+    if (keypad_event_queue == NULL ||
+        xTaskCreate(keypad_scan_task, "keypad_scan", KEYPAD_TASK_STACK, NULL, KEYPAD_TASK_PRIORITY, NULL) != pdPASS)
     {
-        ESP_LOGE("Keypad", "Failed to create I2C semaphore");
+        ESP_LOGE("Keypad", "Failed to start keypad scanner");
         return ESP_FAIL;
     }
-    ESP_LOGI("Keypad", "Initialized keypad on I2C port %d, address 0x%02X", i2c_port, PCF8574_ADDR);
 
     // Initialize DS1307 RTC
     esp_err_t rtc_init_result = ds1307_init();
@@ -1597,224 +2360,138 @@ esp_err_t keypad_init(i2c_port_t i2c_port)
 // Add a refresh_rtc_time function
 static void refresh_rtc_time(void)
 {
-    // Find the time parameter index
-    int time_param_idx = -1;
-    for (int i = 0; i < NUM_PARAMETERS; i++)
-    {
-        if (parameters[i].address == PARAM_ADDRESS_TIME)
-        {
-            time_param_idx = i;
-            break;
-        }
-    }
-
-    if (time_param_idx == -1)
-    {
-        ESP_LOGE("RTC", "Time parameter not found");
-        return;
-    }
-
-    // Free old time value if it exists
-    if (parameters[time_param_idx].value != NULL)
-    {
-        free(parameters[time_param_idx].value);
-        parameters[time_param_idx].value = NULL;
-    }
-
     // Read current time from RTC
     uint8_t rtc_registers[8];
+    uint8_t hour = 0; // Default time
+    uint8_t minute = 0;
     esp_err_t ret = ds1307_read(0x00, rtc_registers, 7);
     if (ret != ESP_OK && rtc_present)
     {
         ESP_LOGE("RTC", "Failed to read from RTC: %s", esp_err_to_name(ret));
-        parameters[time_param_idx].value = strdup("00:00"); // Default time
-        return;
-    }
-
-    // Get time from RTC: HH:MM format
-    uint8_t hour = bcd_to_binary(rtc_registers[2]);
-    uint8_t minute = bcd_to_binary(rtc_registers[1]);
-
-    // Validate time values
-    if (hour > 23 || minute > 59)
-    {
-        ESP_LOGW("RTC", "Invalid time values read from RTC: %02d:%02d", hour, minute);
-        parameters[time_param_idx].value = strdup("00:00"); // Default time
     }
     else
     {
-        char time_str[16];
-        snprintf(time_str, sizeof(time_str), "%02d:%02d", hour, minute);
-        parameters[time_param_idx].value = strdup(time_str);
-        ESP_LOGI("RTC", "Refreshed time: %s", time_str);
-    }
-}
-
-// Add category definitions
-typedef enum {
-    CAT_TIME_DATE,
-    CAT_SYSTEM,
-    CAT_PROTECTION,
-    CAT_STAGGERING,
-    CAT_TWILIGHT,
-    NUM_CATEGORIES
-} param_category_t;
-
-// Add category info
-const char* category_names[NUM_CATEGORIES] = {
-    "TIME & DATE",
-    "SYSTEM SETUP",
-    "PROTECTION",
-    "STAGGERING",
-    "TWILIGHT"
-};
-
-// Assign categories to parameters
-// This maps each parameter to its category
-const param_category_t param_categories[NUM_PARAMETERS] = {
-    CAT_TIME_DATE,    // 01.Time
-    CAT_TIME_DATE,    // 02.Date
-    CAT_SYSTEM,       // 03.HiVolt
-    CAT_SYSTEM,       // 04.LoVolt
-    CAT_SYSTEM,       // 05.HiAmps
-    CAT_SYSTEM,       // 06.MinAmps
-    CAT_SYSTEM,       // 07.MaxAmps
-    CAT_SYSTEM,       // 08.MinDC
-    CAT_PROTECTION,   // 09.Alarm
-    CAT_PROTECTION,   // 10.Protect
-    CAT_STAGGERING,   // 11.Rotate
-    CAT_STAGGERING,   // 12.Stagger
-    CAT_STAGGERING,   // 13.EvDelay
-    CAT_STAGGERING,   // 14.A OnTm
-    CAT_STAGGERING,   // 15.A OffTm
-    CAT_STAGGERING,   // 16.B OnTm
-    CAT_STAGGERING,   // 17.B OffTm
-    CAT_TWILIGHT,     // 18.BackSet
-    CAT_TWILIGHT,     // 19.BackRise
-    CAT_TWILIGHT,     // 20.JanDusk
-    CAT_TWILIGHT,     // 21.JunDusk
-    CAT_TWILIGHT,     // 22.JanDawn
-    CAT_SYSTEM,       // 23.LockTm
-    CAT_SYSTEM,       // 24.Password
-    CAT_SYSTEM        // 25.PassEd
-};
+        // Get time from RTC: HH:MM format
+        hour = bcd_to_binary(rtc_registers[2]);
+        minute = bcd_to_binary(rtc_registers[1]);
 
-// Function to find the first parameter in a category
-static int find_first_param_in_category(param_category_t category) {
-    for (int i = 0; i < NUM_PARAMETERS; i++) {
-        if (param_categories[i] == category) {
-            return i;
+        // Validate time values
+        if (hour > 23 || minute > 59)
+        {
+            ESP_LOGW("RTC", "Invalid time values read from RTC: %02d:%02d", hour, minute);
+            hour = 0;
+            minute = 0;
+        }
+        else
+        {
+            ESP_LOGI("RTC", "Refreshed time: %02d:%02d", hour, minute);
         }
     }
-    return 0; // Default to first parameter if not found
+
+    // An edit the RTC has not taken yet is newer than what was just read
+    param_lock_take();
+    if (!param_is_dirty(PARAM_ID_TIME))
+    {
+        param_values[PARAM_ID_TIME].time.hour = hour;
+        param_values[PARAM_ID_TIME].time.minute = minute;
+    }
+    param_lock_give();
+}
+
+// Menu categories are the parameter groups. Each group is one contiguous
+// range of the table, so moving within it is index arithmetic.
+static int find_first_param_in_category(param_group_t category) {
+    return param_groups[category].first;
 }
 
 // Function to find the next parameter in the same category
-static int find_next_param_in_category(int current_idx) {
-    param_category_t current_category = param_categories[current_idx];
-    int next_idx = (current_idx + 1) % NUM_PARAMETERS;
-    
-    // If the next parameter is in the same category, return it
-    if (param_categories[next_idx] == current_category) {
-        return next_idx;
-    }
-    
-    // Otherwise, find the first parameter in the current category
-    return find_first_param_in_category(current_category);
+int find_next_param_in_category(int current_idx) {
+    const param_group_info_t *group = &param_groups[parameters[current_idx].group];
+    return group->first + (current_idx - group->first + 1) % group->count;
 }
 
 // Function to find the previous parameter in the same category
-static int find_prev_param_in_category(int current_idx) {
-    param_category_t current_category = param_categories[current_idx];
-    int prev_idx = (current_idx > 0) ? (current_idx - 1) : (NUM_PARAMETERS - 1);
-    
-    // If the previous parameter is in the same category, return it
-    if (param_categories[prev_idx] == current_category) {
-        return prev_idx;
-    }
-    
-    // Otherwise, find the last parameter in the current category
-    int last_idx = current_idx;
-    for (int i = 0; i < NUM_PARAMETERS; i++) {
-        if (param_categories[i] == current_category) {
-            last_idx = i;
-        }
-    }
-    
-    return last_idx;
+int find_prev_param_in_category(int current_idx) {
+    const param_group_info_t *group = &param_groups[parameters[current_idx].group];
+    return group->first + (current_idx - group->first + group->count - 1) % group->count;
 }
 
 // Find the next category
-static param_category_t find_next_category(param_category_t current_category) {
-    return (current_category + 1) % NUM_CATEGORIES;
+static param_group_t find_next_category(param_group_t current_category) {
+    return (current_category + 1) % NUM_GROUPS;
 }
 
 // Find the previous category
-static param_category_t find_prev_category(param_category_t current_category) {
-    return (current_category > 0) ? (current_category - 1) : (NUM_CATEGORIES - 1);
+static param_group_t find_prev_category(param_group_t current_category) {
+    return (current_category > 0) ? (current_category - 1) : (NUM_GROUPS - 1);
 }
 
 // Function to find parameter by number
-static int find_param_by_number(int number) {
-    // Parameter numbers displayed to user start from 1
-    if (number < 1 || number > NUM_PARAMETERS) {
+int find_param_by_number(int number) {
+    // The number shown to the user is the parameter's address
+    int idx = param_index_from_address(number);
+    if (idx < 0) {
         return 0; // Default to first parameter if invalid
     }
-    
-    // Convert 1-based user number to 0-based index
-    return number - 1;
+    return idx;
+}
+
+// Highest parameter number, for the search prompt
+static int param_address_last(void) {
+    static int last = 0;
+    for (int address = PARAM_ADDRESS_MAX; last == 0 && address > 0; address--) {
+        if (param_index_by_address[address] != 0) {
+            last = address;
+        }
+    }
+    return last;
 }
 
 // Function to show parameter search mode
 static void show_search_mode(void) {
-    if (xSemaphoreTake(lcd_semaphore, portMAX_DELAY) == pdTRUE) {
-        lcd_clear();
-        lcd_set_cursor(0, 0);
-        lcd_print("Go to parameter:");
-        lcd_set_cursor(1, 0);
-        lcd_print("Enter number (1-25)");
-        lcd_set_cursor(1, 16); // Position cursor at the end
-        lcd_cursor_show(true);
-        lcd_cursor_blink(true);
-        xSemaphoreGive(lcd_semaphore);
+    lcd_clear();
+    lcd_set_line(0, "Go to parameter:");
+    lcd_set_line(1, "Enter (1-%d)", param_address_last());
+    lcd_set_cursor_state(1, 16, true, true);
+}
+
+// Key-to-display latency screen. The figures cover keys up to the previous
+// one; the redraw for the current key is what it gets measured against, so
+// the press count keeps every redraw different from the last.
+static void show_latency_figures(uint32_t presses) {
+    trace_latency_t latency;
+    lcd_set_line(0, "Key>LCD ms #%lu", (unsigned long)presses);
+    if (!trace_latency_get(&latency)) {
+        lcd_set_line(1, TRACE_ENABLED ? "p50 p95 p99" : "Trace disabled");
+        return;
     }
+    lcd_set_line(1, "%.1f %.1f %.1f", latency.p50_us / 1000.0, latency.p95_us / 1000.0, latency.p99_us / 1000.0);
+    ESP_LOGI("Keypad", "Key to display over %lu keys: p50 %lu us, p95 %lu us, p99 %lu us, latest %lu us",
+             (unsigned long)latency.samples, (unsigned long)latency.p50_us, (unsigned long)latency.p95_us,
+             (unsigned long)latency.p99_us, (unsigned long)latency.last_us);
 }
 
 // Helper function to display parameter value with unit
 static void display_parameter_value(int param_idx) {
-    if (parameters[param_idx].value != NULL) {
-        char formatted_output[32] = {0};
-        format_input_according_to_rules(
-            (char *)parameters[param_idx].value, 
-            shared_buffer,
-            &parameters[param_idx].validation);
-            
-        // Get unit for this parameter
-        const char* unit = get_param_unit(parameters[param_idx].name);
+    param_value_format(&parameters[param_idx], &param_values[param_idx], shared_buffer, sizeof(shared_buffer));
         
-        if (unit[0] != '\0') {
-            lcd_print("Val: %s %s", shared_buffer, unit);
-        } else {
-            lcd_print("Val: %s", shared_buffer);
-        }
+    // Get unit for this parameter
+    const char* unit = parameters[param_idx].unit;
+    
+    if (unit[0] != '\0') {
+        lcd_set_line(1, "Val: %s %s", shared_buffer, unit);
     } else {
-        lcd_print("Val: <none>");
+        lcd_set_line(1, "Val: %s", shared_buffer);
     }
 }
 
 // Helper function to display current parameter
 static void display_current_parameter(int param_idx) {
-    if (xSemaphoreTake(lcd_semaphore, portMAX_DELAY) == pdTRUE) {
-        lcd_clear();
-        lcd_set_cursor(0, 0);
-        lcd_print("%s", parameters[param_idx].name);
-        lcd_set_cursor(1, 0);
-        
-        // Display value with unit
-        display_parameter_value(param_idx);
-        
-        xSemaphoreGive(lcd_semaphore);
-    }
+    lcd_clear();
+    lcd_set_line(0, "%s", parameters[param_idx].name);
+    
+    // Display value with unit
+    display_parameter_value(param_idx);
 }
 
 // Add this global flag to track if we're saving a parameter
@@ -1823,6 +2500,28 @@ static volatile bool is_saving_parameter = false;
 // At the top of the file, with other tags/includes
 static const char *TAG = "Keypad";
 
+// True if event is the second key of the a+b chord, in either order
+static bool is_chord(const key_event_t *event, char a, char b)
+{
+    return event->type == KEY_EVENT_CHORD &&
+           event->keys == (keypad_key_mask(a) | keypad_key_mask(b));
+}
+
+// First key of the B+C, B+D and *+# shortcuts
+static bool is_shortcut_lead(char key)
+{
+    return key == 'B' || key == '*';
+}
+
+// Ticks left until start + period_ms, capped at limit
+static TickType_t ticks_until(TickType_t start, uint32_t period_ms, TickType_t now, TickType_t limit)
+{
+    TickType_t period = period_ms / portTICK_PERIOD_MS;
+    TickType_t elapsed = now - start;
+    TickType_t remaining = (elapsed >= period) ? 0 : period - elapsed;
+    return (remaining < limit) ? remaining : limit;
+}
+
 void keyboard_task(void *pvParameters)
 {
     load_all_parameters();
@@ -1830,30 +2529,25 @@ void keyboard_task(void *pvParameters)
     int param_idx = 0;
     int input_pos = 0;
     bool password_mode = false;
-    param_category_t current_category = param_categories[0];
+    param_group_t current_category = parameters[0].group;
     bool showing_category = false;
     TickType_t key_press_time = 0;
-    char last_key = '\0';
-    char prev_key = '\0';  // Add explicit prev_key definition
-
-    // Add long-press detection variables
-    TickType_t key_hold_time = 0;
-    bool key_held = false;
-    char held_key = '\0';
 
     // Add search mode variables
     bool in_search_mode = false;
-    char search_input[3] = {0}; // Store up to 2 digits + null terminator
+    char search_input[PARAM_ADDRESS_DIGITS + 1] = {0}; // Parameter number + null terminator
     int search_pos = 0;
 
-    // Initialize last activity time
-    last_activity_time = xTaskGetTickCount();
+    // Key-to-display latency mode, toggled by holding D on the main screen
+    bool latency_mode = false;
+    uint32_t latency_presses = 0;
 
-    // This variable is used throughout the function to track semaphore state
-    volatile bool semaphore_taken __attribute__((unused)) = false;
+    // Press of a shortcut's first key, held back until we know it is not
+    // the start of a chord
+    char held_key = '\0';
 
-    // Use a check to ensure semaphore is always released
-    bool ensure_semaphore_release = false;
+    // Initialize last activity time
+    last_activity_time = xTaskGetTickCount();
 
     // Add debugging variables
     bool key_processed = false;
@@ -1865,125 +2559,164 @@ void keyboard_task(void *pvParameters)
         is_saving_parameter = false;
         key_processed = false;
         
-        char key = keypad_scan();
-        TickType_t current_time = xTaskGetTickCount();
-        
-        // Always release semaphore if it was taken
-        if (ensure_semaphore_release) {
-            xSemaphoreGive(lcd_semaphore);
-            ensure_semaphore_release = false;
-            semaphore_taken = false;
+        // Wait for the next key event or the nearest UI timer, whichever
+        // comes first. With nothing pending this blocks until a key is pressed;
+        // keys pressed while the previous pass was busy are already queued.
+        TickType_t wait_ticks = portMAX_DELAY;
+        TickType_t now = xTaskGetTickCount();
+        if (showing_category)
+        {
+            wait_ticks = ticks_until(key_press_time, 1000, now, wait_ticks);
         }
-        
-        // Long-press detection
-        if (key != '\0' && key == held_key) {
-            // Same key is still pressed
-            if (!key_held && (current_time - key_hold_time) * portTICK_PERIOD_MS >= 1500) {
-                // Key has been held for 1.5 seconds - trigger long press action
-                key_held = true;
-                
-                // Handle long-press actions
-                if (in_keyboard_mode && is_authenticated && !password_mode) {
-                    if (key == '0') {
-                        // Long-press 0 - reset to default value
-                        if (xSemaphoreTake(lcd_semaphore, portMAX_DELAY) == pdTRUE) {
-                            semaphore_taken = true;
-                            
-                            // Show reset message
-                            lcd_clear();
-                            lcd_set_cursor(0, 0);
-                            lcd_print("Resetting to");
-                            lcd_set_cursor(1, 0);
-                            lcd_print("default value");
-                            
-                            xSemaphoreGive(lcd_semaphore);
-                            semaphore_taken = false;
-                            
-                            vTaskDelay(1000 / portTICK_PERIOD_MS);
-                            
-                            // Reset to default value
-                            if (parameters[param_idx].value != NULL) {
-                                free(parameters[param_idx].value);
-                            }
-                            parameters[param_idx].value = strdup((char *)parameters[param_idx].default_value);
-                            
-                            // Validate and store
-                            if (parameters[param_idx].validate != NULL) {
-                                parameters[param_idx].validate(parameters[param_idx].value);
-                            }
-                            store_parameter(param_idx);
-                            
-                            // Refresh display
-                            if (xSemaphoreTake(lcd_semaphore, portMAX_DELAY) == pdTRUE) {
-                                semaphore_taken = true;
-                                lcd_clear();
-                                lcd_set_cursor(0, 0);
-                                lcd_print("%s", parameters[param_idx].name);
-                                lcd_set_cursor(1, 0);
-                                
-                                // Format and display the updated value
-                                format_input_according_to_rules(
-                                    (char *)parameters[param_idx].value, 
-                                    shared_buffer,
-                                    &parameters[param_idx].validation);
-                                lcd_print("Val: %s", shared_buffer);
-                                
-                                xSemaphoreGive(lcd_semaphore);
-                                semaphore_taken = false;
-                            }
-                        }
-                    }
-                    else if (key == '#' && parameters[param_idx].address == PARAM_ADDRESS_TIME) {
-                        // Long-press # on time parameter - set to current time
-                        if (xSemaphoreTake(lcd_semaphore, portMAX_DELAY) == pdTRUE) {
-                            semaphore_taken = true;
-                            
-                            // Show message
-                            lcd_clear();
-                            lcd_set_cursor(0, 0);
-                            lcd_print("Setting to");
-                            lcd_set_cursor(1, 0);
-                            lcd_print("current time");
-                            
-                            xSemaphoreGive(lcd_semaphore);
-                            semaphore_taken = false;
-                            
-                            vTaskDelay(1000 / portTICK_PERIOD_MS);
-                            
-                            // Refresh RTC time
-                            refresh_rtc_time();
-                            
-                            // Refresh display
-                            if (xSemaphoreTake(lcd_semaphore, portMAX_DELAY) == pdTRUE) {
-                                semaphore_taken = true;
-                                lcd_clear();
-                                lcd_set_cursor(0, 0);
-                                lcd_print("%s", parameters[param_idx].name);
-                                lcd_set_cursor(1, 0);
-                                
-                                // Format and display the updated value
-                                format_input_according_to_rules(
-                                    (char *)parameters[param_idx].value, 
-                                    shared_buffer,
-                                    &parameters[param_idx].validation);
-                                lcd_print("Val: %s", shared_buffer);
-                                
-                                xSemaphoreGive(lcd_semaphore);
-                                semaphore_taken = false;
-                            }
-                        }
+        if (in_keyboard_mode)
+        {
+            wait_ticks = ticks_until(last_activity_time, INACTIVITY_TIMEOUT_MS, now, wait_ticks);
+        }
+        if (in_keyboard_mode && password_mode && is_locked_out)
+        {
+            // Countdown on screen is refreshed once a second
+            wait_ticks = ticks_until(now, 1000, now, wait_ticks);
+        }
+
+        key_event_t event = {0};
+        char key = '\0';
+        bool shortcuts_live = in_keyboard_mode && is_authenticated && !password_mode && !in_search_mode &&
+                              !latency_mode;
+        if (keypad_get_event(&event, wait_ticks))
+        {
+            switch (event.type)
+            {
+            case KEY_EVENT_PRESS:
+                // B and * act when released, or B once it starts to repeat,
+                // so a shortcut never also runs its first key
+                if (shortcuts_live && is_shortcut_lead(event.key))
+                {
+                    held_key = event.key;
+                }
+                else
+                {
+                    key = event.key;
+                }
+                break;
+            case KEY_EVENT_CHORD:
+                held_key = '\0';
+                key = event.key;
+                break;
+            case KEY_EVENT_RELEASE:
+                if (event.key == held_key)
+                {
+                    key = held_key;
+                    held_key = '\0';
+                }
+                break;
+            case KEY_EVENT_REPEAT:
+                // Only navigation and delete auto-repeat
+                if (event.key == 'B' || event.key == 'C' || event.key == 'D')
+                {
+                    key = event.key;
+                    if (event.key == held_key)
+                    {
+                        held_key = '\0';
                     }
                 }
+                break;
+            default:
+                break;
+            }
+            TRACE_KEY_HANDLED(event, key != '\0' || event.type == KEY_EVENT_LONG_PRESS);
+        }
+        TickType_t current_time = xTaskGetTickCount();
+
+        // Latency mode takes over the screen and every key. Each key redraws
+        // the figures, so the operator's own presses are the measurement;
+        // # starts a fresh window.
+        if (event.type == KEY_EVENT_LONG_PRESS && event.key == 'D' && (latency_mode || !in_keyboard_mode))
+        {
+            latency_mode = !latency_mode;
+            in_keyboard_mode = latency_mode; // Keeps seconds_task off the screen
+            last_activity_time = current_time;
+            lcd_clear();
+            if (latency_mode)
+            {
+                trace_latency_reset();
+                latency_presses = 0;
+                show_latency_figures(latency_presses);
+            }
+            continue;
+        }
+        if (latency_mode && key != '\0')
+        {
+            last_activity_time = current_time;
+            if (key == '#')
+            {
+                trace_latency_reset();
+                latency_presses = 0;
+            }
+            show_latency_figures(++latency_presses);
+            continue;
+        }
+        
+        // Long-press actions, reported once after the key is held for 1.5 seconds
+        if (event.type == KEY_EVENT_LONG_PRESS) {
+            last_activity_time = xTaskGetTickCount();
+
+            // Handle long-press actions
+            if (in_keyboard_mode && is_authenticated && !password_mode) {
+                if (event.key == '0') {
+                    // Long-press 0 - reset to default value
+                    
+                    // Show reset message
+                    lcd_clear();
+                    lcd_set_line(0, "Resetting to");
+                    lcd_set_line(1, "default value");
+
+                    vTaskDelay(1000 / portTICK_PERIOD_MS);
+                    
+                    // Reset to default value
+                    param_lock_take();
+                    param_value_t before = param_values[param_idx];
+                    param_value_set_default(&parameters[param_idx]);
+                    
+                    // Defaults are always valid, just queue for storing
+                    param_edited(param_idx, &before);
+                    param_lock_give();
+
+                    // Drop the '0' typed by the initial press
+                    memset(input, 0, sizeof(input));
+                    input_pos = 0;
+                    
+                    // Refresh display
+                    lcd_clear();
+                    lcd_set_line(0, "%s", parameters[param_idx].name);
+                    
+                    // Format and display the updated value
+                    param_value_format(&parameters[param_idx], &param_values[param_idx], shared_buffer, sizeof(shared_buffer));
+                    lcd_set_line(1, "Val: %s", shared_buffer);
+                    
+                }
+                else if (event.key == '#' && param_idx == PARAM_ID_TIME) {
+                    // Long-press # on time parameter - set to current time
+                    
+                    // Show message
+                    lcd_clear();
+                    lcd_set_line(0, "Setting to");
+                    lcd_set_line(1, "current time");
+
+                    vTaskDelay(1000 / portTICK_PERIOD_MS);
+                    
+                    // Refresh RTC time
+                    refresh_rtc_time();
+                    
+                    // Refresh display
+                    lcd_clear();
+                    lcd_set_line(0, "%s", parameters[param_idx].name);
+                    
+                    // Format and display the updated value
+                    param_value_format(&parameters[param_idx], &param_values[param_idx], shared_buffer, sizeof(shared_buffer));
+                    lcd_set_line(1, "Val: %s", shared_buffer);
+                    
+                }
             }
-        } else if (key != '\0' && key != held_key) {
-            // New key pressed
-            held_key = key;
-            key_hold_time = current_time;
-            key_held = false;
-        } else if (key == '\0') {
-            // No key pressed
-            held_key = '\0';
-            key_held = false;
         }
 
         // Check if showing category and we should return to parameter display
@@ -1994,7 +2727,7 @@ void keyboard_task(void *pvParameters)
             param_idx = find_first_param_in_category(current_category);
             
             // Refresh RTC time if showing time parameter
-            if (parameters[param_idx].address == PARAM_ADDRESS_TIME) {
+            if (param_idx == PARAM_ID_TIME) {
                 refresh_rtc_time();
             }
             
@@ -2012,24 +2745,16 @@ void keyboard_task(void *pvParameters)
             password_mode = false;
             is_locked_out = false;
             in_search_mode = false; // Also reset search mode flag
+            latency_mode = false;
 
-            if (xSemaphoreTake(lcd_semaphore, portMAX_DELAY) == pdTRUE)
-            {
-                ensure_semaphore_release = true;
-                semaphore_taken = true;
-                lcd_cursor_show(false); // Turn off cursor when exiting
-                lcd_clear();
-                lcd_set_cursor(0, 0);
-                lcd_print("Timeout");
-                lcd_set_cursor(1, 0);
-                lcd_print("Returning to main");
-                vTaskDelay(1000 / portTICK_PERIOD_MS);
-                xSemaphoreGive(lcd_semaphore);
-                ensure_semaphore_release = false;
-                semaphore_taken = false;
-            }
+            lcd_set_cursor_state(0, 0, false, false); // Turn off cursor when exiting
+            lcd_clear();
+            lcd_set_line(0, "Timeout");
+            lcd_set_line(1, "Returning to main");
+            vTaskDelay(1000 / portTICK_PERIOD_MS);
 
             // Reset all input state
+            held_key = '\0';
             input_pos = 0;
             memset(input, 0, sizeof(input));
             search_pos = 0;
@@ -2044,7 +2769,7 @@ void keyboard_task(void *pvParameters)
         if (in_keyboard_mode && password_mode && is_locked_out)
         {
             TickType_t elapsed_seconds = ((current_time - lockout_start) * portTICK_PERIOD_MS) / 1000;
-            int remaining = parameters[23].validation.lockout_time - elapsed_seconds;
+            int remaining = parameters[PARAM_ID_PASSWORD].validation.lockout_time - elapsed_seconds;
 
             if (remaining <= 0)
             {
@@ -2052,52 +2777,32 @@ void keyboard_task(void *pvParameters)
                 is_locked_out = false;
                 password_retries = 0;
 
-                if (xSemaphoreTake(lcd_semaphore, portMAX_DELAY) == pdTRUE)
-                {
-                    semaphore_taken = true;
-                    lcd_clear();
-                    lcd_set_cursor(0, 0);
-                    lcd_print("Lockout ended");
-                    vTaskDelay(1000 / portTICK_PERIOD_MS);
+                lcd_clear();
+                lcd_set_line(0, "Lockout ended");
+                vTaskDelay(1000 / portTICK_PERIOD_MS);
 
-                    // Return to password entry screen
-                    lcd_clear();
-                    lcd_set_cursor(0, 0);
-                    lcd_print("Enter Password:");
-                    lcd_set_cursor(1, 0);
-                    lcd_print(">");
-                    xSemaphoreGive(lcd_semaphore);
-                    semaphore_taken = false;
-                }
+                // Return to password entry screen
+                lcd_clear();
+                lcd_set_line(0, "Enter Password:");
+                lcd_set_line(1, ">");
             }
             else if (remaining % 1 == 0)
             { // Update every second
                 // Update the countdown timer
-                if (xSemaphoreTake(lcd_semaphore, portMAX_DELAY) == pdTRUE)
-                {
-                    semaphore_taken = true;
-                    // Only update the remaining time display
-                    lcd_set_cursor(0, 0);
-                    lcd_print("Locked: %ds     ", remaining);
-                    xSemaphoreGive(lcd_semaphore);
-                    semaphore_taken = false;
-                }
+                // Only update the remaining time display
+                lcd_set_line(0, "Locked: %ds     ", remaining);
             }
         }
 
-        if (key != '\0' && !key_held)
+        // Keys typed in search mode are the parameter number, handled below
+        if (key != '\0' && !in_search_mode)
         {
             // Update last activity time when a key is pressed
             last_activity_time = xTaskGetTickCount();
             key_press_time = current_time;
             
-            // Store last key for detecting key combinations
-            prev_key = last_key;
-            last_key = key;
-            
             // Special shortcut: B+C together to switch categories (forward)
-            if (key == 'C' && prev_key == 'B' && 
-                (current_time - key_press_time) * portTICK_PERIOD_MS < 500) 
+            if (is_chord(&event, 'B', 'C'))
             {
                 // Only process if in edit mode and authenticated
                 if (in_keyboard_mode && is_authenticated && !password_mode) {
@@ -2106,27 +2811,18 @@ void keyboard_task(void *pvParameters)
                     showing_category = true;
                     
                     // Display category header
-                    if (xSemaphoreTake(lcd_semaphore, portMAX_DELAY) == pdTRUE) {
-                        semaphore_taken = true;
-                        lcd_clear();
-                        lcd_set_cursor(0, 0);
-                        lcd_print(">%s<", category_names[current_category]);
-                        
-                        // Show navigation hint
-                        lcd_set_cursor(1, 0);
-                        lcd_print("B+C:Next B+D:Prev");
-                        
-                        xSemaphoreGive(lcd_semaphore);
-                        semaphore_taken = false;
-                    }
+                    lcd_clear();
+                    lcd_set_line(0, ">%s<", param_groups[current_category].title);
                     
+                    // Show navigation hint
+                    lcd_set_line(1, "B+C:Next B+D:Prev");
+
                     continue;
                 }
             }
             
             // Special shortcut: B+D together to switch categories (backward)
-            if (key == 'D' && prev_key == 'B' && 
-                (current_time - key_press_time) * portTICK_PERIOD_MS < 500) 
+            if (is_chord(&event, 'B', 'D'))
             {
                 // Only process if in edit mode and authenticated
                 if (in_keyboard_mode && is_authenticated && !password_mode) {
@@ -2135,348 +2831,323 @@ void keyboard_task(void *pvParameters)
                     showing_category = true;
                     
                     // Display category header
-                    if (xSemaphoreTake(lcd_semaphore, portMAX_DELAY) == pdTRUE) {
-                        semaphore_taken = true;
-                        lcd_clear();
-                        lcd_set_cursor(0, 0);
-                        lcd_print(">%s<", category_names[current_category]);
-                        
-                        // Show navigation hint
-                        lcd_set_cursor(1, 0);
-                        lcd_print("B+C:Next B+D:Prev");
-                        
-                        xSemaphoreGive(lcd_semaphore);
-                        semaphore_taken = false;
-                    }
+                    lcd_clear();
+                    lcd_set_line(0, ">%s<", param_groups[current_category].title);
+                    
+                    // Show navigation hint
+                    lcd_set_line(1, "B+C:Next B+D:Prev");
+
+                    continue;
+                }
+            }
+
+            // Special shortcut: * and # together to enter search mode
+            if (is_chord(&event, '*', '#') && !in_search_mode)
+            {
+                // Only process if in edit mode and authenticated
+                if (in_keyboard_mode && is_authenticated && !password_mode) {
+                    // Enter search mode
+                    in_search_mode = true;
+                    search_pos = 0;
+                    memset(search_input, 0, sizeof(search_input));
                     
+                    // Show search interface
+                    show_search_mode();
+
                     continue;
                 }
             }
 
             if (!in_keyboard_mode && key == 'A')
             {
-                // Check if password protection is enabled - fixed to use parameter 24 (PassED)
+                // Check if password protection is enabled (25.PassED)
                 bool password_enabled = false;
 
-                // Find parameter 24.PassED
-                for (int i = 0; i < NUM_PARAMETERS; i++)
+                if (param_values[PARAM_ID_PASS_ED].choice == 1)
                 {
-                    if (strstr(parameters[i].name, "PassED") != NULL)
-                    {
-                        // Check if password is enabled (value is "1" or "Enable")
-                        if (((char*)parameters[i].value)[0] == '1' && ((char*)parameters[i].value)[1] == '\0')
-                        {
-                            password_enabled = true;
-                        }
-                        break;
-                    }
+                    password_enabled = true;
                 }
 
                 in_keyboard_mode = true;
                 password_mode = password_enabled;
 
-                if (xSemaphoreTake(lcd_semaphore, portMAX_DELAY) == pdTRUE)
-                {
-                    semaphore_taken = true;
-                    lcd_clear();
+                lcd_clear();
 
-                    if (password_enabled)
-                    {
-                        lcd_set_cursor(0, 0);
-                        lcd_print("Enter Password:");
-                        lcd_set_cursor(1, 0);
-                        lcd_print(">");
-                        lcd_set_cursor(1, 1); // Position cursor after ">"
-                        lcd_cursor_show(true); // Show cursor for password entry
-                        lcd_cursor_blink(true); // Enable blinking
-                    }
-                    else
+                if (password_enabled)
+                {
+                    lcd_set_line(0, "Enter Password:");
+                    lcd_set_line(1, ">");
+                    lcd_set_cursor_state(1, 1, true, true);
+                }
+                else
+                {
+                    is_authenticated = true;
+                    param_idx = 0;
+                    
+                    // Refresh RTC time if showing time parameter (when first entering)
+                    if (param_idx == PARAM_ID_TIME)
                     {
-                        is_authenticated = true;
-                        param_idx = 0;
-                        
-                        // Refresh RTC time if showing time parameter (when first entering)
-                        if (parameters[param_idx].address == PARAM_ADDRESS_TIME)
-                        {
-                            refresh_rtc_time();
-                        }
-                        
-                        lcd_set_cursor(0, 0);
-                        lcd_print("%s", parameters[param_idx].name);
-                        lcd_set_cursor(1, 0);
-
-                        // Format and display the current value
-                        if (parameters[param_idx].value != NULL)
-                        {
-                            format_input_according_to_rules(
-                                (char *)parameters[param_idx].value,
-                                shared_buffer,
-                                &parameters[param_idx].validation);
-                            lcd_print("Val: %s", shared_buffer);
-                            
-                            // Don't show cursor yet as we're not editing
-                            lcd_cursor_show(false);
-                        }
-                        else
-                        {
-                            lcd_print("Val: <none>");
-                            lcd_cursor_show(false);
-                        }
+                        refresh_rtc_time();
                     }
+                    
+                    lcd_set_line(0, "%s", parameters[param_idx].name);
 
-                    xSemaphoreGive(lcd_semaphore);
-                    semaphore_taken = false;
+                    // Format and display the current value
+                    param_value_format(&parameters[param_idx], &param_values[param_idx], shared_buffer, sizeof(shared_buffer));
+                    lcd_set_line(1, "Val: %s", shared_buffer);
+                    
+                    // Don't show cursor yet as we're not editing
+                    lcd_set_cursor_state(0, 0, false, false);
                 }
+
             }
             else if (in_keyboard_mode)
             {
                 if (password_mode && !is_authenticated)
                 {
                     // Handle password mode
-                    if (xSemaphoreTake(lcd_semaphore, portMAX_DELAY) == pdTRUE)
+
+                    if (is_locked_out)
                     {
-                        semaphore_taken = true;
+                        // Turn off cursor during lockout
+                        lcd_set_cursor_state(0, 0, false, false);
+                        
+                        // Display lockout message and countdown
+                        TickType_t current_time = xTaskGetTickCount();
+                        int elapsed_seconds = ((current_time - lockout_start) * portTICK_PERIOD_MS) / 1000;
+                        int remaining = parameters[PARAM_ID_PASSWORD].validation.lockout_time - elapsed_seconds;
 
-                        if (is_locked_out)
+                        lcd_clear();
+                        lcd_set_line(0, "Locked: %ds", remaining);
+                        lcd_set_line(1, "Please wait...");
+                    }
+                    else if (key >= '0' && key <= '9')
+                    {
+                        // Handle digit entry for password
+                        if (input_pos < 8) // Assume max password length is 8
                         {
-                            // Turn off cursor during lockout
-                            lcd_cursor_show(false);
-                            
-                            // Display lockout message and countdown
-                            TickType_t current_time = xTaskGetTickCount();
-                            int elapsed_seconds = ((current_time - lockout_start) * portTICK_PERIOD_MS) / 1000;
-                            int remaining = parameters[23].validation.lockout_time - elapsed_seconds;
+                            input[input_pos++] = key;
+                            input[input_pos] = '\0';
 
-                            lcd_clear();
-                            lcd_set_cursor(0, 0);
-                            lcd_print("Locked: %ds", remaining);
-                            lcd_set_cursor(1, 0);
-                            lcd_print("Please wait...");
+                            // Update display with asterisks for password
+                            lcd_set_line(1, ">%s", input);
+                            
+                            // Position cursor for next input
+                            lcd_set_cursor_state(1, input_pos + 1, true, true); // +1 for the '>' character
                         }
-                        else if (key >= '0' && key <= '9')
+                    }
+                    else if (key == 'D') // Delete
+                    {
+                        if (input_pos > 0)
                         {
-                            // Handle digit entry for password
-                            if (input_pos < 8) // Assume max password length is 8
-                            {
-                                input[input_pos++] = key;
-                                input[input_pos] = '\0';
-
-                                // Update display with asterisks for password
-                                lcd_set_cursor(1, 0);
-                                lcd_print(">%s", input);
-                                
-                                // Position cursor for next input
-                                lcd_set_cursor(1, input_pos + 1); // +1 for the '>' character
-                            }
+                            input[--input_pos] = '\0';
+                            
+                            // Update display
+                            lcd_set_line(1, ">%s ", input); // Space to clear last character
+                            
+                            // Position cursor for next input
+                            lcd_set_cursor_state(1, input_pos + 1, true, true); // +1 for the '>' character
                         }
-                        else if (key == 'D') // Delete
+                    }
+                    else if (key == '#') // Submit password
+                    {
+                        // Hide cursor during processing
+                        lcd_set_cursor_state(0, 0, false, false);
+                        
+                        if (check_password(input))
                         {
-                            if (input_pos > 0)
-                            {
-                                input[--input_pos] = '\0';
-                                
-                                // Update display
-                                lcd_set_cursor(1, 0);
-                                lcd_print(">%s ", input); // Space to clear last character
-                                
-                                // Position cursor for next input
-                                lcd_set_cursor(1, input_pos + 1); // +1 for the '>' character
-                            }
+                            // Password correct
+                            is_authenticated = true;
+                            password_mode = false;
+                            password_retries = 0;
+                            
+                            lcd_clear();
+                            lcd_set_line(0, "Access Granted");
+                            vTaskDelay(1000 / portTICK_PERIOD_MS);
+                            
+                            // Show first parameter
+                            param_idx = 0;
+                            lcd_clear();
+                            lcd_set_line(0, "%s", parameters[param_idx].name);
+                            
+                            // Format and display current value
+                            param_value_format(&parameters[param_idx], &param_values[param_idx], shared_buffer, sizeof(shared_buffer));
+                            lcd_set_line(1, "Val: %s", shared_buffer);
                         }
-                        else if (key == '#') // Submit password
+                        else
                         {
-                            // Hide cursor during processing
-                            lcd_cursor_show(false);
+                            // Password incorrect
+                            password_retries++;
                             
-                            if (check_password(input))
+                            if (password_retries >= MAX_PASSWORD_RETRIES)
                             {
-                                // Password correct
-                                is_authenticated = true;
-                                password_mode = false;
-                                password_retries = 0;
-                                
-                                lcd_clear();
-                                lcd_set_cursor(0, 0);
-                                lcd_print("Access Granted");
-                                vTaskDelay(1000 / portTICK_PERIOD_MS);
+                                // Max retries reached, activate lockout
+                                is_locked_out = true;
+                                lockout_start = xTaskGetTickCount();
                                 
-                                // Show first parameter
-                                param_idx = 0;
                                 lcd_clear();
-                                lcd_set_cursor(0, 0);
-                                lcd_print("%s", parameters[param_idx].name);
-                                lcd_set_cursor(1, 0);
-                                
-                                // Format and display current value
-                                if (parameters[param_idx].value != NULL)
-                                {
-                                    format_input_according_to_rules(
-                                        (char *)parameters[param_idx].value,
-                                        shared_buffer,
-                                        &parameters[param_idx].validation);
-                                    lcd_print("Val: %s", shared_buffer);
-                                }
-                                else
-                                {
-                                    lcd_print("Val: <none>");
-                                }
+                                lcd_set_line(0, "Max retries");
+                                lcd_set_line(1, "Locked for %ds", parameters[PARAM_ID_PASSWORD].validation.lockout_time);
                             }
                             else
                             {
-                                // Password incorrect
-                                password_retries++;
-                                
-                                if (password_retries >= MAX_PASSWORD_RETRIES)
-                                {
-                                    // Max retries reached, activate lockout
-                                    is_locked_out = true;
-                                    lockout_start = xTaskGetTickCount();
-                                    
-                                    lcd_clear();
-                                    lcd_set_cursor(0, 0);
-                                    lcd_print("Max retries");
-                                    lcd_set_cursor(1, 0);
-                                    lcd_print("Locked for %ds", parameters[23].validation.lockout_time);
-                                }
-                                else
-                                {
-                                    lcd_clear();
-                                    lcd_set_cursor(0, 0);
-                                    lcd_print("Wrong Password!");
-                                    lcd_set_cursor(1, 0);
-                                    lcd_print("Retry %d/%d", password_retries, MAX_PASSWORD_RETRIES);
-                                    vTaskDelay(1500 / portTICK_PERIOD_MS);
-                                    
-                                    // Reset for next attempt
-                                    lcd_clear();
-                                    lcd_set_cursor(0, 0);
-                                    lcd_print("Enter Password:");
-                                    lcd_set_cursor(1, 0);
-                                    lcd_print(">");
-                                    lcd_set_cursor(1, 1); // Position cursor after ">"
-                                    lcd_cursor_show(true); // Show cursor for password entry
-                                }
+                                lcd_clear();
+                                lcd_set_line(0, "Wrong Password!");
+                                lcd_set_line(1, "Retry %d/%d", password_retries, MAX_PASSWORD_RETRIES);
+                                vTaskDelay(1500 / portTICK_PERIOD_MS);
                                 
-                                // Clear input for next attempt
-                                memset(input, 0, sizeof(input));
-                                input_pos = 0;
+                                // Reset for next attempt
+                                lcd_clear();
+                                lcd_set_line(0, "Enter Password:");
+                                lcd_set_line(1, ">");
+                                lcd_set_cursor_state(1, 1, true, false);
                             }
-                        }
-                        else if (key == 'A')
-                        {
-                            // Exit password mode
-                            in_keyboard_mode = false;
-                            password_mode = false;
                             
-                            // Hide cursor when exiting
-                            lcd_cursor_show(false);
-                            lcd_clear();
+                            // Clear input for next attempt
+                            memset(input, 0, sizeof(input));
+                            input_pos = 0;
                         }
-
-                        xSemaphoreGive(lcd_semaphore);
-                        semaphore_taken = false;
+                    }
+                    else if (key == 'A')
+                    {
+                        // Exit password mode
+                        in_keyboard_mode = false;
+                        password_mode = false;
+                        
+                        // Hide cursor when exiting
+                        lcd_set_cursor_state(0, 0, false, false);
+                        lcd_clear();
                     }
                 }
                 else if (is_authenticated)
                 {
                     // Regular parameter editing mode
-                    if (xSemaphoreTake(lcd_semaphore, portMAX_DELAY) == pdTRUE)
+                    if (key == 'A') // Exit keyboard mode
+                    {
+                        // Turn off cursor when exiting
+                        lcd_set_cursor_state(0, 0, false, false);
+                        
+                        // Exit keyboard mode
+                        in_keyboard_mode = false;
+                        is_authenticated = false;
+                        lcd_clear();
+                    }
+                    else if (key == 'B') // Previous parameter (within same category)
                     {
-                        semaphore_taken = true;
+                        // Find previous parameter in the same category
+                        param_idx = find_prev_param_in_category(param_idx);
                         
-                        if (key == 'A') // Exit keyboard mode
+                        // Refresh RTC time if showing time parameter
+                        if (param_idx == PARAM_ID_TIME)
                         {
-                            // Turn off cursor when exiting
-                            lcd_cursor_show(false);
+                            refresh_rtc_time();
+                        }
                             
-                            // Exit keyboard mode
-                            in_keyboard_mode = false;
-                            is_authenticated = false;
-                            lcd_clear();
+                        // Display new parameter
+                        lcd_clear();
+                        lcd_set_line(0, "%s", parameters[param_idx].name);
+                        
+                        // Format and display current value
+                        param_value_format(&parameters[param_idx], &param_values[param_idx], shared_buffer, sizeof(shared_buffer));
+                        lcd_set_line(1, "Val: %s", shared_buffer);
+                        
+                        // Hide cursor when just viewing
+                        lcd_set_cursor_state(0, 0, false, false);
+                        
+                        // Reset input
+                        memset(input, 0, sizeof(input));
+                        input_pos = 0;
+                    }
+                    else if (key == 'C') // Next parameter (within same category)
+                    {
+                        // Find next parameter in the same category
+                        param_idx = find_next_param_in_category(param_idx);
+                        
+                        // Refresh RTC time if showing time parameter
+                        if (param_idx == PARAM_ID_TIME)
+                        {
+                            refresh_rtc_time();
                         }
-                        else if (key == 'B') // Previous parameter (within same category)
+                        
+                        // Display new parameter
+                        lcd_clear();
+                        lcd_set_line(0, "%s", parameters[param_idx].name);
+                        
+                        // Format and display current value
+                        param_value_format(&parameters[param_idx], &param_values[param_idx], shared_buffer, sizeof(shared_buffer));
+                        lcd_set_line(1, "Val: %s", shared_buffer);
+                        
+                        // Hide cursor when just viewing
+                        lcd_set_cursor_state(0, 0, false, false);
+                        
+                        // Reset input
+                        memset(input, 0, sizeof(input));
+                        input_pos = 0;
+                    }
+                    else if (key == 'D') // Delete character
+                    {
+                        if (input_pos > 0)
                         {
-                            // Find previous parameter in the same category
-                            param_idx = find_prev_param_in_category(param_idx);
+                            input[--input_pos] = '\0';
                             
-                            // Refresh RTC time if showing time parameter
-                            if (parameters[param_idx].address == PARAM_ADDRESS_TIME)
-                            {
-                                refresh_rtc_time();
-                            }
-                                
-                            // Display new parameter
-                            lcd_clear();
-                            lcd_set_cursor(0, 0);
-                            lcd_print("%s", parameters[param_idx].name);
-                            lcd_set_cursor(1, 0);
+                            // Update display
+                            format_input_according_to_rules(
+                                input, 
+                                shared_buffer,
+                                &parameters[param_idx].validation);
                             
-                            // Format and display current value
-                            if (parameters[param_idx].value != NULL)
-                            {
-                                char formatted_output[32] = {0};
-                                format_input_according_to_rules(
-                                    (char *)parameters[param_idx].value, 
-                                    formatted_output,
-                                    &parameters[param_idx].validation);
-                                lcd_print("Val: %s", formatted_output);
+                            lcd_set_line(1, "Val: %s ", shared_buffer); // Space to clear last character
+                            
+                            // Set cursor position for editing
+                            int cursor_pos = 5; // "Val: " is 5 characters
+                            
+                            // Handle formatted display with different cursor positions
+                            if (parameters[param_idx].validation.format == FORMAT_TIME) {
+                                // For time format (HH:MM), calculate cursor position
+                                cursor_pos += (input_pos < 2) ? input_pos : input_pos + 1; // +1 for the colon
+                            } 
+                            else if (parameters[param_idx].validation.format == FORMAT_DATE) {
+                                // For date format (DD/MM/YY), calculate cursor position
+                                if (input_pos < 2) cursor_pos += input_pos;
+                                else if (input_pos < 4) cursor_pos += input_pos + 1; // +1 for first slash
+                                else cursor_pos += input_pos + 2; // +2 for two slashes
                             }
-                            else
-                            {
-                                lcd_print("Val: <none>");
+                            else {
+                                cursor_pos += input_pos;
                             }
                             
-                            // Hide cursor when just viewing
-                            lcd_cursor_show(false);
-                            
-                            // Reset input
-                            memset(input, 0, sizeof(input));
-                            input_pos = 0;
+                            lcd_set_cursor_state(1, cursor_pos, true, true);
                         }
-                        else if (key == 'C') // Next parameter (within same category)
+                    }
+                    else if (key == '*') // Decimal point or negative sign
+                    {
+                        if (parameters[param_idx].validation.format == FORMAT_DECIMAL)
                         {
-                            // Find next parameter in the same category
-                            param_idx = find_next_param_in_category(param_idx);
-                            
-                            // Refresh RTC time if showing time parameter
-                            if (parameters[param_idx].address == PARAM_ADDRESS_TIME)
+                            // If this is the first character entered, clear the previous value
+                            if (input_pos == 0)
                             {
-                                refresh_rtc_time();
+                                // Clear the display first
+                                lcd_set_line(1, "Val:                "); // Clear the entire line
+                                
+                                // Enable cursor
+                                lcd_set_cursor_state(1, 5, true, true);
                             }
                             
-                            // Display new parameter
-                            lcd_clear();
-                            lcd_set_cursor(0, 0);
-                            lcd_print("%s", parameters[param_idx].name);
-                            lcd_set_cursor(1, 0);
-                            
-                            // Format and display current value
-                            if (parameters[param_idx].value != NULL)
+                            // Only add decimal if we haven't already added one
+                            bool has_decimal = false;
+                            for (int i = 0; i < input_pos; i++)
                             {
-                                char formatted_output[32] = {0};
-                                format_input_according_to_rules(
-                                    (char *)parameters[param_idx].value, 
-                                    formatted_output,
-                                    &parameters[param_idx].validation);
-                                lcd_print("Val: %s", formatted_output);
-                            }
-                            else
-                            {
-                                lcd_print("Val: <none>");
+                                if (input[i] == '.')
+                                {
+                                    has_decimal = true;
+                                    break;
+                                }
                             }
                             
-                            // Hide cursor when just viewing
-                            lcd_cursor_show(false);
-                            
-                            // Reset input
-                            memset(input, 0, sizeof(input));
-                            input_pos = 0;
-                        }
-                        else if (key == 'D') // Delete character
-                        {
-                            if (input_pos > 0)
+                            if (!has_decimal && input_pos < parameters[param_idx].validation.max_length)
                             {
-                                input[--input_pos] = '\0';
+                                input[input_pos++] = '.';
+                                input[input_pos] = '\0';
                                 
                                 // Update display
                                 format_input_according_to_rules(
@@ -2484,536 +3155,311 @@ void keyboard_task(void *pvParameters)
                                     shared_buffer,
                                     &parameters[param_idx].validation);
                                 
-                                lcd_set_cursor(1, 0);
-                                lcd_print("Val: %s ", shared_buffer); // Space to clear last character
+                                lcd_set_line(1, "Val: %s", shared_buffer);
                                 
                                 // Set cursor position for editing
-                                int cursor_pos = 5; // "Val: " is 5 characters
-                                
-                                // Handle formatted display with different cursor positions
-                                if (parameters[param_idx].validation.format == FORMAT_TIME) {
-                                    // For time format (HH:MM), calculate cursor position
-                                    cursor_pos += (input_pos < 2) ? input_pos : input_pos + 1; // +1 for the colon
-                                } 
-                                else if (parameters[param_idx].validation.format == FORMAT_DATE) {
-                                    // For date format (DD/MM/YY), calculate cursor position
-                                    if (input_pos < 2) cursor_pos += input_pos;
-                                    else if (input_pos < 4) cursor_pos += input_pos + 1; // +1 for first slash
-                                    else cursor_pos += input_pos + 2; // +2 for two slashes
-                                }
-                                else {
-                                    cursor_pos += input_pos;
-                                }
-                                
-                                lcd_set_cursor(1, cursor_pos);
-                                lcd_cursor_show(true);
-                                lcd_cursor_blink(true);
+                                lcd_set_cursor_state(1, 5 + input_pos, true, true);
                             }
                         }
-                        else if (key == '*') // Decimal point or negative sign
+                        else if (parameters[param_idx].validation.allow_negative)
                         {
-                            if (parameters[param_idx].validation.format == FORMAT_DECIMAL)
+                            // For parameters that allow negative values, use '*' as a sign toggle
+                            
+                            // If no input yet, start with a minus sign
+                            if (input_pos == 0)
                             {
-                                // If this is the first character entered, clear the previous value
-                                if (input_pos == 0)
-                                {
-                                    // Clear the display first
-                                    lcd_set_cursor(1, 0);
-                                    lcd_print("Val:                "); // Clear the entire line
-                                    
-                                    // Enable cursor
-                                    lcd_cursor_show(true);
-                                    lcd_cursor_blink(true);
-                                }
-                                
-                                // Only add decimal if we haven't already added one
-                                bool has_decimal = false;
-                                for (int i = 0; i < input_pos; i++)
-                                {
-                                    if (input[i] == '.')
-                                    {
-                                        has_decimal = true;
-                                        break;
-                                    }
-                                }
+                                input[input_pos++] = '-';
+                                input[input_pos] = '\0';
                                 
-                                if (!has_decimal && input_pos < parameters[param_idx].validation.max_length)
-                                {
-                                    input[input_pos++] = '.';
-                                    input[input_pos] = '\0';
-                                    
-                                    // Update display
-                                    format_input_according_to_rules(
-                                        input, 
-                                        shared_buffer,
-                                        &parameters[param_idx].validation);
-                                    
-                                    lcd_set_cursor(1, 0);
-                                    lcd_print("Val: %s", shared_buffer);
-                                    
-                                    // Set cursor position for editing
-                                    lcd_set_cursor(1, 5 + input_pos); // "Val: " is 5 characters
-                                    lcd_cursor_show(true);
-                                    lcd_cursor_blink(true);
-                                }
+                                // Display the minus sign
+                                lcd_set_line(1, "Val: -");
+                                lcd_set_cursor_state(1, 6, true, true);
                             }
-                            else if (parameters[param_idx].validation.allow_negative)
+                            else if (input_pos > 0)
                             {
-                                // For parameters that allow negative values, use '*' as a sign toggle
-                                
-                                // If no input yet, start with a minus sign
-                                if (input_pos == 0)
+                                // Toggle the sign if there's already input
+                                if (input[0] == '-')
                                 {
-                                    // Clear the display first
-                                    lcd_set_cursor(1, 0);
-                                    lcd_print("Val:                "); // Clear the entire line
-                                    
-                                    input[input_pos++] = '-';
-                                    input[input_pos] = '\0';
+                                    // Remove the minus sign
+                                    for (int i = 0; i < input_pos; i++)
+                                    {
+                                        input[i] = input[i+1];
+                                    }
+                                    input_pos--;
                                     
-                                    // Display the minus sign
-                                    lcd_set_cursor(1, 0);
-                                    lcd_print("Val: -");
-                                    lcd_set_cursor(1, 6); // Position after the minus
-                                    lcd_cursor_show(true);
-                                    lcd_cursor_blink(true);
+                                    // Update display
+                                    lcd_set_line(1, "Val: %s", input);
+                                    lcd_set_cursor_state(1, 5 + input_pos, true, true);
                                 }
-                                else if (input_pos > 0)
+                                else
                                 {
-                                    // Toggle the sign if there's already input
-                                    if (input[0] == '-')
-                                    {
-                                        // Remove the minus sign
-                                        for (int i = 0; i < input_pos; i++)
-                                        {
-                                            input[i] = input[i+1];
-                                        }
-                                        input_pos--;
-                                        
-                                        // Update display
-                                        lcd_set_cursor(1, 0);
-                                        lcd_print("Val:                "); // Clear line
-                                        lcd_set_cursor(1, 0);
-                                        lcd_print("Val: %s", input);
-                                        lcd_set_cursor(1, 5 + input_pos);
-                                    }
-                                    else
+                                    // Add minus sign at the beginning
+                                    for (int i = input_pos; i > 0; i--)
                                     {
-                                        // Add minus sign at the beginning
-                                        for (int i = input_pos; i > 0; i--)
-                                        {
-                                            input[i] = input[i-1];
-                                        }
-                                        input[0] = '-';
-                                        input_pos++;
-                                        input[input_pos] = '\0';
-                                        
-                                        // Update display
-                                        lcd_set_cursor(1, 0);
-                                        lcd_print("Val:                "); // Clear line
-                                        lcd_set_cursor(1, 0);
-                                        lcd_print("Val: %s", input);
-                                        lcd_set_cursor(1, 5 + input_pos);
+                                        input[i] = input[i-1];
                                     }
+                                    input[0] = '-';
+                                    input_pos++;
+                                    input[input_pos] = '\0';
+                                    
+                                    // Update display
+                                    lcd_set_line(1, "Val: %s", input);
+                                    lcd_set_cursor_state(1, 5 + input_pos, true, true);
                                 }
                             }
                         }
-                        else if (key >= '0' && key <= '9') // Number input
+                    }
+                    else if (key >= '0' && key <= '9') // Number input
+                    {
+                        // If this is the first digit entered, clear the previous value
+                        if (input_pos == 0)
                         {
-                            // If this is the first digit entered, clear the previous value
-                            if (input_pos == 0)
-                            {
-                                // Clear the display first
-                                lcd_set_cursor(1, 0);
-                                lcd_print("Val:                "); // Clear the entire line
-                                
-                                // Enable cursor for editing
-                                lcd_cursor_show(true);
-                                lcd_cursor_blink(true);
-                            }
+                            // Clear the display first
+                            lcd_set_line(1, "Val:                "); // Clear the entire line
                             
-                            if (input_pos < parameters[param_idx].validation.max_length)
-                            {
-                                input[input_pos++] = key;
-                                input[input_pos] = '\0';
-                                
-                                // Format and display input
-                                format_input_according_to_rules(
-                                    input, 
-                                    shared_buffer,
-                                    &parameters[param_idx].validation);
-                                
-                                lcd_set_cursor(1, 0);
-                                lcd_print("Val: %s", shared_buffer);
-                                
-                                // Set cursor position for editing based on format type
-                                int cursor_pos = 5; // "Val: " is 5 characters
-                                
-                                // Handle formatted display with different cursor positions
-                                if (parameters[param_idx].validation.format == FORMAT_TIME) {
-                                    // For time format (HH:MM), calculate cursor position
-                                    cursor_pos += (input_pos < 2) ? input_pos : input_pos + 1; // +1 for the colon
-                                } 
-                                else if (parameters[param_idx].validation.format == FORMAT_DATE) {
-                                    // For date format (DD/MM/YY), calculate cursor position
-                                    if (input_pos < 2) cursor_pos += input_pos;
-                                    else if (input_pos < 4) cursor_pos += input_pos + 1; // +1 for first slash
-                                    else cursor_pos += input_pos + 2; // +2 for two slashes
-                                }
-                                else {
-                                    cursor_pos += input_pos;
-                                }
-                                
-                                lcd_set_cursor(1, cursor_pos);
+                            // Enable cursor for editing
+                            lcd_set_cursor_state(1, 5, true, true);
+                        }
+                        
+                        if (input_pos < parameters[param_idx].validation.max_length)
+                        {
+                            input[input_pos++] = key;
+                            input[input_pos] = '\0';
+                            
+                            // Format and display input
+                            format_input_according_to_rules(
+                                input, 
+                                shared_buffer,
+                                &parameters[param_idx].validation);
+                            
+                            lcd_set_line(1, "Val: %s", shared_buffer);
+                            
+                            // Set cursor position for editing based on format type
+                            int cursor_pos = 5; // "Val: " is 5 characters
+                            
+                            // Handle formatted display with different cursor positions
+                            if (parameters[param_idx].validation.format == FORMAT_TIME) {
+                                // For time format (HH:MM), calculate cursor position
+                                cursor_pos += (input_pos < 2) ? input_pos : input_pos + 1; // +1 for the colon
+                            } 
+                            else if (parameters[param_idx].validation.format == FORMAT_DATE) {
+                                // For date format (DD/MM/YY), calculate cursor position
+                                if (input_pos < 2) cursor_pos += input_pos;
+                                else if (input_pos < 4) cursor_pos += input_pos + 1; // +1 for first slash
+                                else cursor_pos += input_pos + 2; // +2 for two slashes
+                            }
+                            else {
+                                cursor_pos += input_pos;
                             }
+                            
+                            lcd_set_cursor_state(1, cursor_pos, true, true);
                         }
-                        else if (key == '#' && !is_saving_parameter) // Submit value
+                    }
+                    else if (key == '#' && !is_saving_parameter) // Submit value
+                    {
+                        key_processed = true;
+                        last_key_processed = '#';
+                        
+                        // Set the flag to indicate we're saving
+                        is_saving_parameter = true;
+                        
+                        // Hide cursor during processing
+                        lcd_set_cursor_state(0, 0, false, false);
+                        
+                        if (input_pos > 0)
                         {
-                            key_processed = true;
-                            last_key_processed = '#';
+                            // After saving time, refresh from RTC to ensure accurate display
+                            bool was_time_param = (param_idx == PARAM_ID_TIME);
                             
-                            // Set the flag to indicate we're saving
-                            is_saving_parameter = true;
+                            // Parse the typed digits once and check them without
+                            // the lock; a value that fails leaves the old one in place
+                            param_result_t result;
+                            param_value_t parsed;
+                            if (!param_value_parse(&parameters[param_idx], input, &parsed))
+                            {
+                                result.status = PARAM_ERR_FORMAT;
+                                strcpy(result.message, "Invalid format");
+                            }
+                            else
+                            {
+                                int64_t validate_start_us = TRACE_NOW();
+                                param_validate(param_idx, &parsed, &result);
+                                TRACE_PARAM_VALIDATED(param_idx, validate_start_us);
+                            }
                             
-                            // Hide cursor during processing
-                            lcd_cursor_show(false);
+                            // Then queue the new value for storing
+                            if (result.status == PARAM_VALID)
+                            {
+                                param_lock_take();
+                                param_value_t before = param_values[param_idx];
+                                param_values[param_idx] = parsed;
+                                param_edited(param_idx, &before);
+                                param_lock_give();
+                            }
                             
-                            if (input_pos > 0)
+                            // Check if validation failed and show error message
+                            if (result.status != PARAM_VALID)
                             {
-                                // After saving time, refresh from RTC to ensure accurate display
-                                bool was_time_param = (parameters[param_idx].address == PARAM_ADDRESS_TIME);
+                                // Show error message
+                                lcd_clear();
+                                lcd_set_line(0, "Invalid input!");
+                                lcd_set_line(1, "%s", result.message);
+                                vTaskDelay(2000 / portTICK_PERIOD_MS); // Show error for 2 seconds
                                 
-                                // For time parameters, convert HHMM to standard format
-                                if (parameters[param_idx].type == PARAM_TYPE_TIME && strlen(input) == 4)
-                                {
-                                    // Convert from HHMM to HH:MM - fixed to avoid double colon
-                                    char formatted_time[6]; // HH:MM + null
-                                    snprintf(formatted_time, 6, "%c%c:%c%c", 
-                                             input[0], input[1], input[2], input[3]);
-                                    strcpy(input, formatted_time);
-                                }
+                                // Return to parameter display
+                                lcd_clear();
+                                lcd_set_line(0, "%s", parameters[param_idx].name);
                                 
-                                // Free old value if exists
-                                if (parameters[param_idx].value != NULL)
-                                {
-                                    free(parameters[param_idx].value);
-                                }
+                                // Format and display the value kept
+                                param_value_format(&parameters[param_idx], &param_values[param_idx], shared_buffer, sizeof(shared_buffer));
+                                lcd_set_line(1, "Val: %s", shared_buffer);
+                            }
+                            else
+                            {
+                                // Value is valid and queued for the background flush
                                 
-                                // Set new value
-                                parameters[param_idx].value = strdup(input);
+                                // Format and display the updated value
+                                param_value_format(&parameters[param_idx], &param_values[param_idx], shared_buffer, sizeof(shared_buffer));
                                 
-                                // Reset validation status before validating
-                                validation_failed = false;
-                                validation_error_message[0] = '\0';
+                                // Get unit for this parameter
+                                const char* unit = parameters[param_idx].unit;
                                 
-                                // Validate and store
-                                if (parameters[param_idx].validate != NULL)
-                                {
-                                    parameters[param_idx].validate(parameters[param_idx].value);
+                                // Show confirmation with unit if applicable
+                                lcd_clear();
+                                lcd_set_line(0, "Value saved!");
+                                if (unit[0] != '\0') {
+                                    lcd_set_line(1, "%s %s", shared_buffer, unit);
+                                } else {
+                                    lcd_set_line(1, "%s", shared_buffer);
                                 }
                                 
-                                // Check if validation failed and show error message
-                                if (validation_failed)
-                                {
-                                    // Show error message
-                                    lcd_clear();
-                                    lcd_set_cursor(0, 0);
-                                    lcd_print("Invalid input!");
-                                    lcd_set_cursor(1, 0);
-                                    lcd_print("%s", validation_error_message);
-                                    vTaskDelay(2000 / portTICK_PERIOD_MS); // Show error for 2 seconds
-                                    
-                                    // Return to parameter display
-                                    lcd_clear();
-                                    lcd_set_cursor(0, 0);
-                                    lcd_print("%s", parameters[param_idx].name);
-                                    lcd_set_cursor(1, 0);
-                                    
-                                    // Format and display the current (corrected) value
-                                    format_input_according_to_rules(
-                                        (char *)parameters[param_idx].value, 
-                                        shared_buffer,
-                                        &parameters[param_idx].validation);
-                                    lcd_print("Val: %s", shared_buffer);
+                                vTaskDelay(1500 / portTICK_PERIOD_MS);
+                                
+                                // Show parameter again
+                                lcd_clear();
+                                lcd_set_line(0, "%s", parameters[param_idx].name);
+                                if (unit[0] != '\0') {
+                                    lcd_set_line(1, "Val: %s %s", shared_buffer, unit);
+                                } else {
+                                    lcd_set_line(1, "Val: %s", shared_buffer);
                                 }
-                                else
+                                
+                                // After saving time, refresh the RTC value
+                                if (was_time_param)
                                 {
-                                    // Value is valid, proceed with storing
-                                    lcd_clear();
-                                    lcd_set_cursor(0, 0);
-                                    lcd_print("Saving...");
-                                    
-                                    // Release semaphore to ensure display updates
-                                    xSemaphoreGive(lcd_semaphore);
-                                    vTaskDelay(300 / portTICK_PERIOD_MS);
-                                    
-                                    // Re-take semaphore for next step
-                                    if (xSemaphoreTake(lcd_semaphore, portMAX_DELAY) == pdTRUE)
-                                    {
-                                        // Store the parameter
-                                        store_parameter(param_idx);
-                                        
-                                        // Format and display the updated value
-                                        format_input_according_to_rules(
-                                            (char *)parameters[param_idx].value, 
-                                            shared_buffer,
-                                            &parameters[param_idx].validation);
-                                        
-                                        // Get unit for this parameter
-                                        const char* unit = get_param_unit(parameters[param_idx].name);
-                                        
-                                        // Show confirmation with unit if applicable
-                                        lcd_clear();
-                                        lcd_set_cursor(0, 0);
-                                        lcd_print("Value saved!");
-                                        lcd_set_cursor(1, 0);
-                                        if (unit[0] != '\0') {
-                                            lcd_print("%s %s", shared_buffer, unit);
-                                        } else {
-                                            lcd_print("%s", shared_buffer);
-                                        }
-                                        
-                                        // Release semaphore to ensure display updates
-                                        xSemaphoreGive(lcd_semaphore);
-                                        vTaskDelay(1500 / portTICK_PERIOD_MS);
-                                        
-                                        // Re-take semaphore for next step
-                                        if (xSemaphoreTake(lcd_semaphore, portMAX_DELAY) == pdTRUE)
-                                        {
-                                            // Show parameter again
-                                            lcd_clear();
-                                            lcd_set_cursor(0, 0);
-                                            lcd_print("%s", parameters[param_idx].name);
-                                            lcd_set_cursor(1, 0);
-                                            if (unit[0] != '\0') {
-                                                lcd_print("Val: %s %s", shared_buffer, unit);
-                                            } else {
-                                                lcd_print("Val: %s", shared_buffer);
-                                            }
-                                            
-                                            // After saving time, refresh the RTC value
-                                            if (was_time_param)
-                                            {
-                                                // Wait a moment for RTC to update
-                                                vTaskDelay(100 / portTICK_PERIOD_MS);
-                                                refresh_rtc_time();
-                                            }
-                                            
-                                            // Make sure to release semaphore before continuing
-                                            xSemaphoreGive(lcd_semaphore);
-                                            semaphore_taken = false;
-                                        }
-                                        else
-                                        {
-                                            semaphore_taken = false;
-                                        }
-                                    }
-                                    else
-                                    {
-                                        semaphore_taken = false;
-                                    }
+                                    // Wait a moment for RTC to update
+                                    vTaskDelay(100 / portTICK_PERIOD_MS);
+                                    refresh_rtc_time();
                                 }
                             }
-                            
-                            // Reset input - ALWAYS do this after handling the # key
-                            memset(input, 0, sizeof(input));
-                            input_pos = 0;
-                            
-                            // Update the last activity time to prevent immediate timeout
-                            last_activity_time = xTaskGetTickCount();
-                            
-                            // Clear the flag now that we're done saving
-                            is_saving_parameter = false;
                         }
-
-                        xSemaphoreGive(lcd_semaphore);
-                        semaphore_taken = false;
+                        
+                        // Reset input - ALWAYS do this after handling the # key
+                        memset(input, 0, sizeof(input));
+                        input_pos = 0;
+                        
+                        // Update the last activity time to prevent immediate timeout
+                        last_activity_time = xTaskGetTickCount();
+                        
+                        // Clear the flag now that we're done saving
+                        is_saving_parameter = false;
                     }
                 }
             }
         }
         
-        // Small delay to prevent high CPU usage
-        vTaskDelay(50 / portTICK_PERIOD_MS);
-
         // Handle key press for search mode
-        if (in_search_mode && key != '\0' && !key_held)
+        if (in_search_mode && key != '\0')
         {
             // Update activity time
             last_activity_time = xTaskGetTickCount();
             key_press_time = current_time;
             
-            // Store key history even in search mode
-            prev_key = last_key;
-            last_key = key;
-
-            if (xSemaphoreTake(lcd_semaphore, portMAX_DELAY) == pdTRUE)
+            if (key >= '0' && key <= '9' && search_pos < PARAM_ADDRESS_DIGITS)
             {
-                semaphore_taken = true;
+                // Add digit to search input
+                search_input[search_pos++] = key;
+                search_input[search_pos] = '\0';
                 
-                if (key >= '0' && key <= '9' && search_pos < 2)
-                {
-                    // Add digit to search input
-                    search_input[search_pos++] = key;
-                    search_input[search_pos] = '\0';
-                    
-                    // Show input
-                    lcd_set_cursor(1, 0);
-                    lcd_print("Enter: %s_        ", search_input);
-                    lcd_set_cursor(1, 7 + search_pos);
-                }
-                else if (key == 'D' && search_pos > 0)
-                {
-                    // Delete last digit
-                    search_input[--search_pos] = '\0';
-                    
-                    // Show input
-                    lcd_set_cursor(1, 0);
-                    if (search_pos > 0) {
-                        lcd_print("Enter: %s_        ", search_input);
-                    } else {
-                        lcd_print("Enter number (1-25)");
-                    }
-                    lcd_set_cursor(1, 7 + search_pos);
+                // Show input
+                lcd_set_line(1, "Enter: %s_        ", search_input);
+                lcd_set_cursor_state(1, 7 + search_pos, true, true);
+            }
+            else if (key == 'D' && search_pos > 0)
+            {
+                // Delete last digit
+                search_input[--search_pos] = '\0';
+                
+                // Show input
+                if (search_pos > 0) {
+                    lcd_set_line(1, "Enter: %s_        ", search_input);
+                } else {
+                    lcd_set_line(1, "Enter (1-%d)", param_address_last());
                 }
-                else if (key == '#' && search_pos > 0)
+                lcd_set_cursor_state(1, 7 + search_pos, true, true);
+            }
+            else if (key == '#' && search_pos > 0)
+            {
+                // Process search
+                int number = atoi(search_input);
+                param_idx = find_param_by_number(number);
+                
+                // Exit search mode
+                in_search_mode = false;
+                lcd_set_cursor_state(0, 0, false, false);
+                
+                // Update current category based on the selected parameter
+                current_category = parameters[param_idx].group;
+                
+                // Refresh RTC time if showing time parameter
+                if (param_idx == PARAM_ID_TIME)
                 {
-                    // Process search
-                    int number = atoi(search_input);
-                    param_idx = find_param_by_number(number);
-                    
-                    // Exit search mode
-                    in_search_mode = false;
-                    lcd_cursor_show(false);
-                    
-                    // Update current category based on the selected parameter
-                    current_category = param_categories[param_idx];
-                    
-                    // Refresh RTC time if showing time parameter
-                    if (parameters[param_idx].address == PARAM_ADDRESS_TIME)
-                    {
-                        refresh_rtc_time();
-                    }
-                    
-                    // Display parameter
-                    lcd_clear();
-                    lcd_set_cursor(0, 0);
-                    lcd_print("%s", parameters[param_idx].name);
-                    lcd_set_cursor(1, 0);
-                    
-                    // Format and display current value
-                    if (parameters[param_idx].value != NULL)
-                    {
-                        char formatted_output[32] = {0};
-                        format_input_according_to_rules(
-                            (char *)parameters[param_idx].value, 
-                            formatted_output,
-                            &parameters[param_idx].validation);
-                            
-                        // Get unit for this parameter
-                        const char* unit = get_param_unit(parameters[param_idx].name);
-                        
-                        if (unit[0] != '\0') {
-                            lcd_print("Val: %s %s", formatted_output, unit);
-                        } else {
-                            lcd_print("Val: %s", formatted_output);
-                        }
-                    }
-                    else
-                    {
-                        lcd_print("Val: <none>");
-                    }
+                    refresh_rtc_time();
                 }
-                else if (key == 'A' || key == 'B' || key == 'C')
-                {
-                    // Cancel search mode
-                    in_search_mode = false;
-                    lcd_cursor_show(false);
-                    
-                    // Return to parameter display
-                    lcd_clear();
-                    lcd_set_cursor(0, 0);
-                    lcd_print("%s", parameters[param_idx].name);
-                    lcd_set_cursor(1, 0);
+                
+                // Display parameter
+                lcd_clear();
+                lcd_set_line(0, "%s", parameters[param_idx].name);
+                
+                // Format and display current value
+                param_value_format(&parameters[param_idx], &param_values[param_idx], shared_buffer, sizeof(shared_buffer));
                     
-                    // Format and display current value
-                    if (parameters[param_idx].value != NULL)
-                    {
-                        char formatted_output[32] = {0};
-                        format_input_according_to_rules(
-                            (char *)parameters[param_idx].value, 
-                            formatted_output,
-                            &parameters[param_idx].validation);
-                            
-                        // Get unit for this parameter
-                        const char* unit = get_param_unit(parameters[param_idx].name);
-                        
-                        if (unit[0] != '\0') {
-                            lcd_print("Val: %s %s", formatted_output, unit);
-                        } else {
-                            lcd_print("Val: %s", formatted_output);
-                        }
-                    }
-                    else
-                    {
-                        lcd_print("Val: <none>");
-                    }
-                }
+                // Get unit for this parameter
+                const char* unit = parameters[param_idx].unit;
                 
-                xSemaphoreGive(lcd_semaphore);
-                semaphore_taken = false;
+                if (unit[0] != '\0') {
+                    lcd_set_line(1, "Val: %s %s", shared_buffer, unit);
+                } else {
+                    lcd_set_line(1, "Val: %s", shared_buffer);
+                }
             }
-        }
-
-        // Handle normal key presses when not in search mode
-        if (key != '\0' && !key_held && !in_search_mode)
-        {
-            // Update last activity time when a key is pressed
-            last_activity_time = xTaskGetTickCount();
-            key_press_time = current_time;
-            
-            // Store last key for detecting key combinations
-            prev_key = last_key;
-            last_key = key;
-            
-            // Special shortcut: * and # together to enter search mode
-            if (key == '#' && prev_key == '*' && 
-                (current_time - key_press_time) * portTICK_PERIOD_MS < 500) 
+            else if (key == 'A' || key == 'B' || key == 'C')
             {
-                // Only process if in edit mode and authenticated
-                if (in_keyboard_mode && is_authenticated && !password_mode) {
-                    // Enter search mode
-                    in_search_mode = true;
-                    search_pos = 0;
-                    memset(search_input, 0, sizeof(search_input));
+                // Cancel search mode
+                in_search_mode = false;
+                lcd_set_cursor_state(0, 0, false, false);
+                
+                // Return to parameter display
+                lcd_clear();
+                lcd_set_line(0, "%s", parameters[param_idx].name);
+                
+                // Format and display current value
+                param_value_format(&parameters[param_idx], &param_values[param_idx], shared_buffer, sizeof(shared_buffer));
                     
-                    // Show search interface
-                    show_search_mode();
+                // Get unit for this parameter
+                const char* unit = parameters[param_idx].unit;
+                
+                if (unit[0] != '\0') {
+                    lcd_set_line(1, "Val: %s %s", shared_buffer, unit);
+                } else {
+                    lcd_set_line(1, "Val: %s", shared_buffer);
                 }
             }
-            else if (!in_keyboard_mode && key == 'A')
-            {
-                // ... existing code ...
-            }
-            else if (in_keyboard_mode)
-            {
-                // ... existing code ...
-            }
         }
-        
-        // Small delay to prevent high CPU usage
-        vTaskDelay(50 / portTICK_PERIOD_MS);
 
         // Add safety checks at the end of each loop iteration
         // to ensure we never get stuck in an unresponsive state
         
-        // Safety check: Make sure semaphore is always released
-        if (semaphore_taken) {
-            ESP_LOGW(TAG, "Semaphore still held at end of loop - releasing");
-            xSemaphoreGive(lcd_semaphore);
-            semaphore_taken = false;
-        }
-        
         // Safety check: Always process timeout
         current_time = xTaskGetTickCount();
         if ((current_time - last_activity_time) > INACTIVITY_TIMEOUT_MS) {
@@ -3021,11 +3467,8 @@ void keyboard_task(void *pvParameters)
             if (in_search_mode) {
                 in_search_mode = false;
                 // Clear search mode display
-                if (xSemaphoreTake(lcd_semaphore, portMAX_DELAY) == pdTRUE) {
-                    lcd_clear();
-                    display_current_parameter(param_idx);
-                    xSemaphoreGive(lcd_semaphore);
-                }
+                lcd_clear();
+                display_current_parameter(param_idx);
             }
             
             // Reset input if in edit mode
@@ -3034,90 +3477,81 @@ void keyboard_task(void *pvParameters)
                 input_pos = 0;
                 
                 // Refresh display
-                if (xSemaphoreTake(lcd_semaphore, portMAX_DELAY) == pdTRUE) {
-                    display_current_parameter(param_idx);
-                    xSemaphoreGive(lcd_semaphore);
-                }
+                display_current_parameter(param_idx);
             }
             
             // Update timestamp to prevent repeated timeout handling
             last_activity_time = current_time;
         }
-        
-        // Always have a delay at the end of the loop to allow other tasks to run
-        vTaskDelay(50 / portTICK_PERIOD_MS);
     }
 }
 
-// Function to write data to 24C32 EEPROM
-static esp_err_t eeprom_write(uint16_t addr, uint8_t *data, size_t data_len)
+// The 24C32 does not ACK its address while a write cycle is running. Probe
+// it with an empty write until it does, rather than sleeping for the
+// datasheet maximum after every page.
+static esp_err_t eeprom_wait_ready(void)
 {
-    if (xSemaphoreTake(i2c_semaphore, portMAX_DELAY) != pdTRUE)
+    int64_t deadline_us = esp_timer_get_time() + EEPROM_WRITE_CYCLE_MAX_US;
+    while (i2c_bus_write(I2C_BUS_DEV_EEPROM, EEPROM_24C32_ADDR, NULL, 0, I2C_TIMEOUT_MS) != ESP_OK)
     {
-        ESP_LOGE("EEPROM", "Failed to take I2C semaphore");
-        return ESP_FAIL;
+        if (esp_timer_get_time() >= deadline_us)
+        {
+            return ESP_ERR_TIMEOUT;
+        }
+        esp_rom_delay_us(EEPROM_POLL_INTERVAL_US);
     }
+    return ESP_OK;
+}
 
-    i2c_cmd_handle_t cmd = i2c_cmd_link_create();
-    i2c_master_start(cmd);
-    i2c_master_write_byte(cmd, (EEPROM_24C32_ADDR << 1) | I2C_MASTER_WRITE, true);
-    i2c_master_write_byte(cmd, (addr >> 8) & 0xFF, true); // High byte of address
-    i2c_master_write_byte(cmd, addr & 0xFF, true);        // Low byte of address
-    i2c_master_write(cmd, data, data_len, true);
-    i2c_master_stop(cmd);
-    esp_err_t ret = i2c_master_cmd_begin(keypad_i2c_port, cmd, I2C_TIMEOUT_MS / portTICK_PERIOD_MS);
-    i2c_cmd_link_delete(cmd);
-
-    xSemaphoreGive(i2c_semaphore);
-
-    if (ret != ESP_OK)
+// Function to write data to 24C32 EEPROM. A page write wraps inside its
+// 32-byte page, so the data goes out one page-bounded piece at a time.
+static esp_err_t eeprom_write(uint16_t addr, uint8_t *data, size_t data_len)
+{
+    if (addr + data_len > EEPROM_24C32_SIZE)
     {
-        ESP_LOGE("EEPROM", "Failed to write to 24C32: %s", esp_err_to_name(ret));
+        return ESP_ERR_INVALID_ARG;
     }
-    else
+
+    while (data_len > 0)
     {
-        // EEPROM write cycle time - typically 5ms
-        vTaskDelay(5 / portTICK_PERIOD_MS);
+        size_t chunk = EEPROM_24C32_PAGE_SIZE - (addr % EEPROM_24C32_PAGE_SIZE);
+        if (chunk > data_len)
+        {
+            chunk = data_len;
+        }
+
+        uint8_t addr_bytes[2] = {
+            (addr >> 8) & 0xFF, // High byte of address
+            addr & 0xFF         // Low byte of address
+        };
+        esp_err_t ret = i2c_bus_write_reg(I2C_BUS_DEV_EEPROM, EEPROM_24C32_ADDR, addr_bytes, sizeof(addr_bytes),
+                                          data, chunk, I2C_TIMEOUT_MS);
+        if (ret == ESP_OK)
+        {
+            ret = eeprom_wait_ready();
+        }
+        if (ret != ESP_OK)
+        {
+            ESP_LOGE("EEPROM", "Failed to write to 24C32 at 0x%03X: %s", addr, esp_err_to_name(ret));
+            return ret;
+        }
+
+        addr += chunk;
+        data += chunk;
+        data_len -= chunk;
     }
-    return ret;
+    return ESP_OK;
 }
 
 // Function to read data from 24C32 EEPROM
 static esp_err_t eeprom_read(uint16_t addr, uint8_t *data, size_t data_len)
 {
-    if (xSemaphoreTake(i2c_semaphore, portMAX_DELAY) != pdTRUE)
-    {
-        ESP_LOGE("EEPROM", "Failed to take I2C semaphore");
-        return ESP_FAIL;
-    }
-
-    // First set the address
-    i2c_cmd_handle_t cmd = i2c_cmd_link_create();
-    i2c_master_start(cmd);
-    i2c_master_write_byte(cmd, (EEPROM_24C32_ADDR << 1) | I2C_MASTER_WRITE, true);
-    i2c_master_write_byte(cmd, (addr >> 8) & 0xFF, true); // High byte of address
-    i2c_master_write_byte(cmd, addr & 0xFF, true);        // Low byte of address
-    i2c_master_stop(cmd);
-    esp_err_t ret = i2c_master_cmd_begin(keypad_i2c_port, cmd, I2C_TIMEOUT_MS / portTICK_PERIOD_MS);
-    i2c_cmd_link_delete(cmd);
-
-    if (ret != ESP_OK)
-    {
-        ESP_LOGE("EEPROM", "Failed to set address: %s", esp_err_to_name(ret));
-        xSemaphoreGive(i2c_semaphore);
-        return ret;
-    }
-
-    // Then read the data
-    cmd = i2c_cmd_link_create();
-    i2c_master_start(cmd);
-    i2c_master_write_byte(cmd, (EEPROM_24C32_ADDR << 1) | I2C_MASTER_READ, true);
-    i2c_master_read(cmd, data, data_len, I2C_MASTER_LAST_NACK);
-    i2c_master_stop(cmd);
-    ret = i2c_master_cmd_begin(keypad_i2c_port, cmd, I2C_TIMEOUT_MS / portTICK_PERIOD_MS);
-    i2c_cmd_link_delete(cmd);
-
-    xSemaphoreGive(i2c_semaphore);
+    uint8_t addr_bytes[2] = {
+        (addr >> 8) & 0xFF, // High byte of address
+        addr & 0xFF         // Low byte of address
+    };
+    esp_err_t ret = i2c_bus_write_read(I2C_BUS_DEV_EEPROM, EEPROM_24C32_ADDR, addr_bytes, sizeof(addr_bytes),
+                                       data, data_len, I2C_TIMEOUT_MS);
 
     if (ret != ESP_OK)
     {
@@ -3126,61 +3560,45 @@ static esp_err_t eeprom_read(uint16_t addr, uint8_t *data, size_t data_len)
     return ret;
 }
 
-static esp_err_t write_pcf8574(uint8_t row_mask)
+esp_err_t keypad_scan_raw(uint8_t raw[5])
 {
-    i2c_cmd_handle_t cmd = i2c_cmd_link_create();
-    i2c_master_start(cmd);
-    i2c_master_write_byte(cmd, (PCF8574_ADDR << 1) | I2C_MASTER_WRITE, true);
-    i2c_master_write_byte(cmd, row_mask, true);
-    i2c_master_stop(cmd);
-    esp_err_t ret = i2c_master_cmd_begin(keypad_i2c_port, cmd, I2C_TIMEOUT_MS / portTICK_PERIOD_MS);
-    i2c_cmd_link_delete(cmd);
-    if (ret != ESP_OK)
-    {
-        ESP_LOGE("Keypad", "Failed to write row mask 0x%02X: %s", row_mask, esp_err_to_name(ret));
-    }
-    return ret;
+    return read_pcf8574_matrix(raw);
 }
 
-static uint8_t read_pcf8574(uint8_t row_mask)
+// Run every step of keypad_scan_masks as one high priority bus transaction:
+// write the row mask, repeated start, read the port back. The PCF8574 outputs
+// settle within a few microseconds of the ACK, well before the read address
+// byte is clocked out, so no delay is needed between the two. On failure
+// every byte is 0xFF, which decodes to no key.
+static esp_err_t read_pcf8574_matrix(uint8_t *raw)
 {
-    if (xSemaphoreTake(i2c_semaphore, portMAX_DELAY) != pdTRUE)
-    {
-        ESP_LOGE("Keypad", "Failed to take I2C semaphore");
-        return 0xFF;
-    }
-
-    // Write the row mask
-    esp_err_t write_ret = write_pcf8574(row_mask);
-    if (write_ret != ESP_OK)
-    {
-        xSemaphoreGive(i2c_semaphore);
-        return 0xFF;
-    }
-
-    // Small delay to allow PCF8574 to settle
-    esp_rom_delay_us(100); // 100µs delay
-
-    // Read the data
-    uint8_t data;
-    i2c_cmd_handle_t cmd = i2c_cmd_link_create();
-    i2c_master_start(cmd);
-    i2c_master_write_byte(cmd, (PCF8574_ADDR << 1) | I2C_MASTER_READ, true);
-    i2c_master_read_byte(cmd, &data, I2C_MASTER_NACK);
-    i2c_master_stop(cmd);
-    esp_err_t ret = i2c_master_cmd_begin(keypad_i2c_port, cmd, I2C_TIMEOUT_MS / portTICK_PERIOD_MS);
-    i2c_cmd_link_delete(cmd);
-
-    xSemaphoreGive(i2c_semaphore);
+    memset(raw, 0xFF, KEYPAD_SCAN_STEPS);
+
+    uint8_t data[KEYPAD_SCAN_STEPS];
+    i2c_bus_segment_t segs[2 * KEYPAD_SCAN_STEPS];
+    for (int step = 0; step < KEYPAD_SCAN_STEPS; step++)
+    {
+        segs[2 * step] = (i2c_bus_segment_t){ .op = I2C_BUS_WRITE, .tx = &keypad_scan_masks[step], .len = 1 };
+        segs[2 * step + 1] = (i2c_bus_segment_t){ .op = I2C_BUS_READ, .rx = &data[step], .len = 1 };
+    }
+    i2c_bus_transaction_t txn = {
+        .device = I2C_BUS_DEV_KEYPAD,
+        .addr = PCF8574_ADDR,
+        .priority = I2C_BUS_PRIO_HIGH,
+        .segments = segs,
+        .segment_count = 2 * KEYPAD_SCAN_STEPS,
+        .timeout_ms = I2C_TIMEOUT_MS,
+    };
+    esp_err_t ret = i2c_bus_transfer(&txn);
 
     if (ret != ESP_OK)
     {
-        ESP_LOGE("Keypad", "Failed to read PCF8574 with mask 0x%02X: %s", row_mask, esp_err_to_name(ret));
-        return 0xFF;
+        ESP_LOGE("Keypad", "Failed to scan PCF8574: %s", esp_err_to_name(ret));
+        return ret;
     }
 
-    // ESP_LOGI("Keypad", "Row mask 0x%02X, data: 0x%02X (%d)", row_mask, data, data);
-    return data;
+    memcpy(raw, data, KEYPAD_SCAN_STEPS);
+    return ESP_OK;
 }
 
 // Update format_input_according_to_rules to properly handle time formatting
@@ -3270,19 +3688,8 @@ static bool check_password(const char *entered_password)
         return false;
     }
 
-    // Find the password parameter
-    const char *stored_password = NULL;
-    for (int i = 0; i < NUM_PARAMETERS; i++)
-    {
-        if (strstr(parameters[i].name, "Password") != NULL)
-        {
-            stored_password = (const char *)parameters[i].value;
-            break;
-        }
-    }
-
-    // If no password is set, or password doesn't match
-    if (stored_password == NULL || strcmp(entered_password, stored_password) != 0)
+    // If password doesn't match
+    if (strcmp(entered_password, param_values[PARAM_ID_PASSWORD].password) != 0)
     {
         return false;
     }
@@ -3290,86 +3697,34 @@ static bool check_password(const char *entered_password)
     return true;
 }
 
-void validate_decimal(void *value)
+param_status_t validate_decimal(const param_validation_t *rules, const param_value_t *value, param_result_t *result)
 {
-    char *val_str = (char *)value;
-    if (!val_str)
-        return;
-
-    // Reset validation status
-    validation_failed = false;
-    validation_error_message[0] = '\0';
-
-    // Find the parameter this value belongs to
-    parameter_t *param = NULL;
-    for (int i = 0; i < NUM_PARAMETERS; i++)
-    {
-        if (parameters[i].value == value)
-        {
-            param = &parameters[i];
-            break;
-        }
-    }
-    if (!param)
-        return;
-
-    // Parse the decimal value
-    double val = atof(val_str);
-
-    // Check range
-    if (val < param->validation.min_value || val > param->validation.max_value)
+    // The limits are in the value's own scale
+    if (value->decimal < rules->min_value || value->decimal > rules->max_value)
     {
-        // Set validation error flag and message
-        validation_failed = true;
-        snprintf(validation_error_message, sizeof(validation_error_message), 
-                "Range %.1f-%.1f", param->validation.min_value, param->validation.max_value);
-        
-        // Reset to default value
-        strcpy(val_str, param->default_value);
-        return;
+        char min_text[16], max_text[16];
+        decimal_format(rules->min_value, rules->decimal_places, min_text, sizeof(min_text));
+        decimal_format(rules->max_value, rules->decimal_places, max_text, sizeof(max_text));
+        return param_result(result, PARAM_ERR_RANGE, "Range %s-%s", min_text, max_text);
     }
-
-    // Format according to decimal places
-    char format[10];
-    snprintf(format, sizeof(format), "%%.%df", param->validation.decimal_places);
-    char temp[32];
-    snprintf(temp, sizeof(temp), format, val);
-    strcpy(val_str, temp);
+    return param_result(result, PARAM_VALID, "");
 }
 
-void validate_password(void *value)
+param_status_t validate_password(const param_validation_t *rules, const param_value_t *value, param_result_t *result)
 {
-    char *password = (char *)value;
-    if (!password)
-        return;
-
-    // Find the password parameter
-    parameter_t *param = NULL;
-    for (int i = 0; i < NUM_PARAMETERS; i++)
-    {
-        if (parameters[i].type == PARAM_TYPE_PASSWORD)
-        {
-            param = &parameters[i];
-            break;
-        }
-    }
-    if (!param)
-        return;
-
-    // Check length
-    if (strlen(password) != param->validation.max_length)
+    // The union member may be garbage from storage, never read past it
+    size_t length = strnlen(value->password, sizeof(value->password));
+    if (length != (size_t)rules->max_length)
     {
-        strcpy(password, param->default_value);
-        return;
+        return param_result(result, PARAM_ERR_FORMAT, "%d digits needed", rules->max_length);
     }
 
-    // Check if all characters are digits
-    for (int i = 0; i < param->validation.max_length; i++)
+    for (size_t i = 0; i < length; i++)
     {
-        if (!isdigit((unsigned char)password[i]))
-        { // Cast to unsigned char to fix warning
-            strcpy(password, param->default_value);
-            return;
+        if (!isdigit((unsigned char)value->password[i]))
+        {
+            return param_result(result, PARAM_ERR_FORMAT, "Digits only");
         }
     }
-}
\ No newline at end of file
+    return param_result(result, PARAM_VALID, "");
+}
@@ -4,21 +4,41 @@
 #include <driver/i2c.h>
 #include <freertos/FreeRTOS.h>
 #include <freertos/semphr.h>
+#include "decimal.h"
+#include "param_table.h"
 
 // Define missing variables
 #define I2C_TIMEOUT_MS 1000
-#define DEBOUNCE_DELAY_MS 300
 
 // Device I2C addresses
 #define DS1307_ADDR 0x68
 #define EEPROM_24C32_ADDR 0x50
+#define EEPROM_24C32_SIZE 4096
+#define EEPROM_24C32_PAGE_SIZE 32 // A write wraps inside its page
+#define EEPROM_WRITE_CYCLE_MAX_US 10000 // Datasheet worst case, usually well under 5 ms
+#define EEPROM_POLL_INTERVAL_US 200 // Between ACK polls while a write cycle runs
 
 // Global variables that need to be declared
 extern i2c_port_t keypad_i2c_port;
-extern SemaphoreHandle_t i2c_semaphore;
-extern bool button_pressed;
-extern TickType_t button_timer;
-extern char pressed_character[2];
+
+// Keypad events
+typedef enum {
+    KEY_EVENT_NONE,
+    KEY_EVENT_PRESS,        // Key pressed with no other key held
+    KEY_EVENT_CHORD,        // Key pressed while other keys are still held
+    KEY_EVENT_RELEASE,      // Key released
+    KEY_EVENT_REPEAT,       // Sole held key, after KEYPAD_REPEAT_DELAY_MS
+    KEY_EVENT_LONG_PRESS    // Sole held key, once after KEYPAD_LONG_PRESS_MS
+} key_event_type_t;
+
+typedef struct {
+    key_event_type_t type;
+    char key;           // Key the event is about
+    uint16_t keys;      // Every key held at that moment, see keypad_key_mask()
+    TickType_t timestamp; // Tick count of the scan that produced the event
+    int64_t edge_us;    // esp_timer time of the first scan that saw the change, before debouncing
+    int64_t queued_us;  // esp_timer time the scanner queued the event
+} key_event_t;
 
 // Parameter storage types
 typedef enum {
@@ -38,13 +58,11 @@ typedef enum {
     PARAM_TYPE_PASSWORD
 } param_type_t;
 
-// Parameter groups
+// Parameter groups, also the menu categories
+#define PARAM_GROUP_ENUM(arg, group, title) group,
 typedef enum {
-    GROUP_DATE_TIME,
-    GROUP_PROTECTION,
-    GROUP_STAGGERING,
-    GROUP_CIVIL_TWILIGHT,
-    GROUP_SYSTEM
+    PARAM_GROUP_LIST(PARAM_GROUP_ENUM, _)
+    NUM_GROUPS
 } param_group_t;
 
 // Parameter format types
@@ -57,77 +75,121 @@ typedef enum {
     FORMAT_MULTIPLE
 } param_format_t;
 
-// Parameter addresses
-#define PARAM_ADDRESS_TIME 1
-#define PARAM_ADDRESS_DATE 2
-#define PARAM_ADDRESS_3 3
-#define PARAM_ADDRESS_4 4
-#define PARAM_ADDRESS_5 5
-#define PARAM_ADDRESS_6 6
-#define PARAM_ADDRESS_7 7
-#define PARAM_ADDRESS_8 8
-#define PARAM_ADDRESS_9 9
-#define PARAM_ADDRESS_10 10
-#define PARAM_ADDRESS_11 11
-#define PARAM_ADDRESS_12 12
-#define PARAM_ADDRESS_13 13
-#define PARAM_ADDRESS_14 14
-#define PARAM_ADDRESS_15 15
-#define PARAM_ADDRESS_16 16
-#define PARAM_ADDRESS_17 17
-#define PARAM_ADDRESS_18 18
-#define PARAM_ADDRESS_19 19
-#define PARAM_ADDRESS_20 20
-#define PARAM_ADDRESS_21 21
-#define PARAM_ADDRESS_22 22
-#define PARAM_ADDRESS_23 23
-#define PARAM_ADDRESS_24 24
-#define PARAM_ADDRESS_25 25
+// Parameter ids, the index into the parameter table, and addresses, the
+// number shown on screen and the key the value is stored under
+#define PARAM_ID_ENUM(arg, id, num, ...) PARAM_ID_##id,
+typedef enum {
+    PARAM_LIST(PARAM_ID_ENUM, _)
+    NUM_PARAMETERS
+} param_id_t;
+
+#define PARAM_ADDRESS_ENUM(arg, id, num, ...) PARAM_ADDRESS_##id = PARAM_NUMBER(num),
+enum {
+    PARAM_LIST(PARAM_ADDRESS_ENUM, _)
+};
+
+// Addresses are 1..PARAM_ADDRESS_MAX, which bounds the address lookup table
+// and the digits typed in parameter search
+#define PARAM_ADDRESS_MAX 999
+#define PARAM_ADDRESS_DIGITS 3
 
 // Format validation rules
 typedef struct {
     int min_length;           // Minimum length of input
     int max_length;           // Maximum length of input
     param_format_t format;     // Changed from char* to param_format_t
-    float min_value;          // Minimum value (for numeric types)
-    float max_value;          // Maximum value (for numeric types)
+    int32_t min_value;        // Minimum value (for numeric types), decimals scaled like the value
+    int32_t max_value;        // Maximum value (for numeric types), decimals scaled like the value
     int decimal_places;       // Number of decimal places (for decimal types)
     bool allow_negative;      // Whether negative numbers are allowed
     int max_retries;          // Maximum number of retries (for password)
     int lockout_time;         // Lockout time in seconds after max retries
 } param_validation_t;
 
-// Parameter structure
+#define PARAM_PASSWORD_LEN 8
+
+// Parameter value, held in a RAM table beside the const parameter table and
+// parsed once when it is entered or loaded. The member in use follows parameter_t.type.
+typedef union {
+    int32_t number;     // PARAM_TYPE_NUMBER
+    decimal_t decimal;  // PARAM_TYPE_DECIMAL, scaled by 10^validation.decimal_places
+    struct {
+        uint8_t hour;
+        uint8_t minute;
+    } time;             // PARAM_TYPE_TIME
+    struct {
+        uint8_t day;
+        uint8_t month;
+        uint8_t year;   // Years since 2000
+    } date;             // PARAM_TYPE_DATE
+    uint8_t choice;     // PARAM_TYPE_ENABLE_DISABLE (1 enabled), PARAM_TYPE_MULTIPLE
+    char password[PARAM_PASSWORD_LEN + 1]; // PARAM_TYPE_PASSWORD, digits
+} param_value_t;
+
+// What a validator found wrong with a value
+typedef enum {
+    PARAM_VALID = 0,
+    PARAM_ERR_FORMAT,   // Not the shape the type needs: choice off the list, password not all digits
+    PARAM_ERR_RANGE,    // Outside validation.min_value/max_value
+    PARAM_ERR_TIME,     // Hour or minute out of range
+    PARAM_ERR_DATE,     // Day not in the month
+    PARAM_ERR_UNKNOWN,  // No such parameter
+} param_status_t;
+
+#define PARAM_MESSAGE_LEN 32
+
+// Verdict on a candidate value. message is "" when valid, otherwise short
+// enough for the LCD's second line where the text allows.
+typedef struct {
+    param_status_t status;
+    char message[PARAM_MESSAGE_LEN];
+} param_result_t;
+
+// Validators look only at the rules and the candidate. They change nothing,
+// so any task can call them without the parameter lock. result may be NULL.
+typedef param_status_t (*param_validator_t)(const param_validation_t *rules, const param_value_t *value,
+                                            param_result_t *result);
+
+// Parameter description. The table of these is const and stays in flash;
+// the values live in a separate table with the same indices.
 typedef struct {
     const char *name;
     param_type_t type;
     param_group_t group;
     storage_type_t storage;
     int address;
-    void *value;
-    const char *default_value;
-    void (*validate)(void *value);
+    const char *unit;               // Shown after the value, "" for none
+    const char *default_value;      // Text, parsed into the value at boot and on reset
+    param_validator_t validate;     // Never NULL
     param_validation_t validation;  // New validation rules
 } parameter_t;
 
 // Add these before the function prototypes
-#define NUM_PARAMETERS 25
 #define NVS_NAMESPACE "params"
 
 // Function prototypes
 esp_err_t keypad_init(i2c_port_t i2c_port);
-char keypad_scan(void);
+bool keypad_get_event(key_event_t *event, TickType_t timeout_ticks);
+uint16_t keypad_key_mask(char key);
+// One full matrix scan outside the scanner task, for diagnostics. raw gets
+// the port read for each of the four rows and then the idle read-back.
+esp_err_t keypad_scan_raw(uint8_t raw[5]);
 void keyboard_task(void *pvParameters);
 void seconds_task(void *pvParameters);
 
-// Validation functions
-void validate_date(void *value);
-void validate_time(void *value);
-void validate_number(void *value);
-void validate_enable_disable(void *value);
-void validate_multiple(void *value);
-void validate_password(void *value);
-void validate_decimal(void *value);
+// Check a candidate value for parameter id against its rules, without
+// touching the stored value. Safe from any task. result may be NULL.
+param_status_t param_validate(param_id_t id, const param_value_t *candidate, param_result_t *result);
+
+// Validators for the parameter table, see param_validator_t
+param_status_t validate_date(const param_validation_t *rules, const param_value_t *value, param_result_t *result);
+param_status_t validate_time(const param_validation_t *rules, const param_value_t *value, param_result_t *result);
+param_status_t validate_number(const param_validation_t *rules, const param_value_t *value, param_result_t *result);
+param_status_t validate_enable_disable(const param_validation_t *rules, const param_value_t *value,
+                                       param_result_t *result);
+param_status_t validate_multiple(const param_validation_t *rules, const param_value_t *value, param_result_t *result);
+param_status_t validate_password(const param_validation_t *rules, const param_value_t *value, param_result_t *result);
+param_status_t validate_decimal(const param_validation_t *rules, const param_value_t *value, param_result_t *result);
 
 // Storage functions
 void store_parameters_to_nvs(void);
@@ -136,9 +198,23 @@ esp_err_t store_parameter_to_rtc(int param_idx);
 esp_err_t load_parameter_from_rtc(int param_idx);
 esp_err_t store_parameter_to_eeprom(int param_idx);
 esp_err_t load_parameter_from_eeprom(int param_idx);
-void store_parameter(int param_idx);
+esp_err_t store_parameter(int param_idx);
 void load_parameter(int param_idx);
 void store_all_parameters(void);
 void load_all_parameters(void);
+// Creates the parameter locks. Call once, before any parameter is stored
+// and before keyboard_task or param_flush_task is started.
+esp_err_t param_store_init(void);
+// Write every parameter edited since the last flush. param_flush_task runs
+// it in the background once edits have stopped for a moment.
+void param_flush(void);
+void param_flush_task(void *pvParameters);
+
+// Menu navigation, all constant time. Next and previous wrap within the
+// parameter's group; find by number takes the number shown on screen and
+// falls back to the first parameter.
+int find_next_param_in_category(int current_idx);
+int find_prev_param_in_category(int current_idx);
+int find_param_by_number(int number);
 
 #endif // KEYBOARD_H
\ No newline at end of file
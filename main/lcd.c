@@ -2,14 +2,19 @@
 #include <esp_log.h>
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
+#include <esp_rom_sys.h>
 #include "lcd.h"
+#include "i2c_bus.h"
+#include "trace.h"
 #include "stdarg.h"
+#include <string.h>
 
 
 #define LCD_ADDR 0x27
 #define I2C_TIMEOUT_MS 1000
 
-static i2c_port_t lcd_i2c_port;
 static uint8_t lcd_addr;
 static uint8_t backlight_state = 0x08;
 
@@ -25,140 +30,416 @@ static uint8_t backlight_state = 0x08;
 #define LCD_DISPLAY_ON_CURSOR_OFF 0x0C
 #define LCD_DISPLAY_ON_CURSOR_ON  0x0E
 #define LCD_DISPLAY_ON_CURSOR_BLINK 0x0F
+#define LCD_CURSOR_BIT            0x02
 
-static void lcd_write_nibble(uint8_t nibble, uint8_t rs) {
-    uint8_t data = (nibble << 4) | (rs ? 0x01 : 0x00) | backlight_state;
-    i2c_cmd_handle_t cmd = i2c_cmd_link_create();
-    i2c_master_start(cmd);
-    i2c_master_write_byte(cmd, (lcd_addr << 1) | I2C_MASTER_WRITE, true);
-    i2c_master_write_byte(cmd, data | 0x04, true); // Enable high
-    i2c_master_write_byte(cmd, data, true);        // Enable low
-    i2c_master_stop(cmd);
-    esp_err_t ret = i2c_master_cmd_begin(lcd_i2c_port, cmd, I2C_TIMEOUT_MS / portTICK_PERIOD_MS);
-    i2c_cmd_link_delete(cmd);
+// Shadow framebuffer, owned by the LCD task. Requests only touch lcd_shadow;
+// lcd_flush() compares it against lcd_glass (what the controller is showing)
+// and sends the changes.
+static char lcd_shadow[LCD_ROWS][LCD_COLS];
+static char lcd_glass[LCD_ROWS][LCD_COLS];
+static uint8_t cursor_row = 0;
+static uint8_t cursor_col = 0;
+static uint8_t display_ctrl = LCD_DISPLAY_ON_CURSOR_OFF; // Requested display control
+static uint8_t glass_ctrl = LCD_DISPLAY_ON_CURSOR_OFF;   // Display control on the glass
+static uint8_t glass_addr = 0;                           // Controller's DDRAM address counter
+
+// HD44780 timing. Normal instructions take 37 us, data writes 41 us with
+// the address update. The controller acts on the falling edge of E, and each
+// nibble is an E-high byte followed by an E-low byte, so the edge that starts
+// the next instruction comes two bus bytes (18 SCL clocks) after the one that
+// finished the last: 45 us at 400 kHz. The stream paces itself as long as
+// the LCD runs no faster than LCD_MAX_SCL_HZ. Only clear/home (1.52 ms) and
+// the power-on sequence need explicit waits.
+#define LCD_MAX_SCL_HZ   400000
+#define LCD_SLOW_CMD_US  2000
+#define LCD_INIT_WAIT_US 4500
+#define LCD_INIT_SHORT_US 150
+
+// Streaming write buffer. Every E-high/E-low byte for a command sequence or a
+// string is queued here and sent to the backpack in as few transactions as
+// possible.
+// Sized for a full-screen flush: two address sets plus 32 characters.
+#define LCD_STREAM_MAX ((LCD_ROWS * (LCD_COLS + 1) + 2) * 4)
+static uint8_t lcd_stream[LCD_STREAM_MAX];
+static size_t lcd_stream_len = 0;
+
+// The stream goes to the bus manager in pieces of this size. Every byte is a
+// complete backpack state, so it can be split anywhere; shorter pieces let a
+// keypad scan get onto the bus between them.
+#define LCD_BUS_CHUNK 32
+
+static esp_err_t lcd_stream_send(void) {
+    esp_err_t ret = ESP_OK;
+    for (size_t off = 0; off < lcd_stream_len && ret == ESP_OK; off += LCD_BUS_CHUNK) {
+        size_t len = lcd_stream_len - off;
+        if (len > LCD_BUS_CHUNK) {
+            len = LCD_BUS_CHUNK;
+        }
+        ret = i2c_bus_write(I2C_BUS_DEV_LCD, lcd_addr, &lcd_stream[off], len, I2C_TIMEOUT_MS);
+    }
 
     if (ret != ESP_OK) {
-        ESP_LOGE("LCD", "Failed to write nibble (0x%02X): %s", data, esp_err_to_name(ret));
+        ESP_LOGE("LCD", "Failed to write %d bytes: %s", (int)lcd_stream_len, esp_err_to_name(ret));
+    }
+    lcd_stream_len = 0;
+    return ret;
+}
+
+static void lcd_stream_nibble(uint8_t nibble, uint8_t rs) {
+    uint8_t data = (nibble << 4) | (rs ? 0x01 : 0x00) | backlight_state;
+    if (lcd_stream_len + 2 > sizeof(lcd_stream)) {
+        lcd_stream_send();
     }
-    vTaskDelay(1 / portTICK_PERIOD_MS); // Reduced delay
+    lcd_stream[lcd_stream_len++] = data | 0x04; // Enable high
+    lcd_stream[lcd_stream_len++] = data;        // Enable low
+}
+
+static void lcd_write_nibble(uint8_t nibble, uint8_t rs) {
+    lcd_stream_nibble(nibble, rs);
+    lcd_stream_send();
 }
 
 static void lcd_write_byte(uint8_t data, uint8_t rs) {
-    lcd_write_nibble(data >> 4, rs);
-    lcd_write_nibble(data & 0x0F, rs);
-    vTaskDelay(1 / portTICK_PERIOD_MS); // Reduced delay
+    lcd_stream_nibble(data >> 4, rs);
+    lcd_stream_nibble(data & 0x0F, rs);
 }
 
 static void lcd_command(uint8_t cmd) {
-    vTaskDelay(50 / portTICK_PERIOD_MS); // Reduced delay
     lcd_write_byte(cmd, 0);
-    vTaskDelay(5 / portTICK_PERIOD_MS); // Reduced delay for commands
+    if (cmd == LCD_CLEAR || cmd == LCD_HOME) {
+        lcd_stream_send();
+        esp_rom_delay_us(LCD_SLOW_CMD_US);
+    }
+}
+
+// Render requests. Other tasks never touch the bus or the shadow themselves,
+// they post one of these and the LCD task applies it.
+typedef enum {
+    LCD_REQ_CLEAR,
+    LCD_REQ_LINE,
+    LCD_REQ_CELL,
+    LCD_REQ_CURSOR,
+    LCD_REQ_BACKLIGHT,
+    LCD_REQ_MEASURE,
+    LCD_REQ_SYNC,
+} lcd_request_type_t;
+
+#define LCD_REQ_FLAG_SHOW  0x01
+#define LCD_REQ_FLAG_BLINK 0x02
+
+typedef struct {
+    uint8_t type;
+    uint8_t row;
+    uint8_t col;
+    uint8_t flags;
+    char text[LCD_COLS];
+} lcd_request_t;
+
+// Deep enough for a couple of full screens. A producer waits at most
+// LCD_POST_TIMEOUT_MS for room, then drops the request, so a stalled LCD
+// task cannot freeze the UI tasks with it.
+#define LCD_QUEUE_LEN 32
+#define LCD_POST_TIMEOUT_MS 100
+#define LCD_TASK_STACK 2560
+// Below the UI tasks, so a screen is fully composed before it is rendered
+#define LCD_TASK_PRIORITY 4
+
+static QueueHandle_t lcd_queue = NULL;
+static SemaphoreHandle_t lcd_synced = NULL; // Given after a flush that followed LCD_REQ_SYNC
+static uint32_t lcd_dropped = 0;
+static portMUX_TYPE lcd_dropped_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static void lcd_post(const lcd_request_t *req) {
+    if (lcd_queue == NULL) {
+        return;
+    }
+    if (xQueueSend(lcd_queue, req, pdMS_TO_TICKS(LCD_POST_TIMEOUT_MS)) == pdTRUE) {
+        return;
+    }
+
+    portENTER_CRITICAL(&lcd_dropped_lock);
+    uint32_t dropped = ++lcd_dropped;
+    portEXIT_CRITICAL(&lcd_dropped_lock);
+    // The first drop and then every hundredth, not one line per request
+    if (dropped % 100 == 1) {
+        ESP_LOGW("LCD", "LCD task not keeping up, %lu requests dropped", (unsigned long)dropped);
+    }
+}
+
+static uint8_t lcd_ddram_addr(uint8_t row, uint8_t col) {
+    return ((row == 0) ? 0x00 : 0x40) + col;
+}
+
+// Send only the cells that differ between the shadow and the glass. Each
+// contiguous run of changed cells costs one DDRAM address set. Returns
+// false if the glass was already up to date.
+static bool lcd_flush(void) {
+    for (uint8_t row = 0; row < LCD_ROWS; row++) {
+        uint8_t col = 0;
+        while (col < LCD_COLS) {
+            if (lcd_shadow[row][col] == lcd_glass[row][col]) {
+                col++;
+                continue;
+            }
+
+            uint8_t address = lcd_ddram_addr(row, col);
+            if (glass_addr != address) {
+                lcd_command(LCD_SET_DDRAM | address);
+            }
+            while (col < LCD_COLS && lcd_shadow[row][col] != lcd_glass[row][col]) {
+                lcd_write_byte(lcd_shadow[row][col], 1);
+                lcd_glass[row][col] = lcd_shadow[row][col];
+                col++;
+            }
+            glass_addr = lcd_ddram_addr(row, col);
+        }
+    }
+
+    if (glass_ctrl != display_ctrl) {
+        lcd_command(display_ctrl);
+        glass_ctrl = display_ctrl;
+    }
+
+    // A visible cursor sits at the DDRAM address counter, park it where the caller asked
+    if (display_ctrl & LCD_CURSOR_BIT) {
+        uint8_t address = lcd_ddram_addr(cursor_row, cursor_col);
+        if (glass_addr != address) {
+            lcd_command(LCD_SET_DDRAM | address);
+            glass_addr = address;
+        }
+    }
+
+    // Everything above goes out as one transaction
+    bool changed = lcd_stream_len > 0;
+    lcd_stream_send();
+    return changed;
+}
+
+// Redraw every cell at each bus clock and log how long it took. Invalidating
+// the glass copy makes lcd_flush() resend the whole screen, so each pass
+// moves the same bytes and only the SCL rate differs. The time reported is
+// the LCD's own time on the wire from the bus manager, which other devices'
+// transactions interleaved with the flush do not inflate.
+static void lcd_measure_flush(void) {
+    static const uint32_t rates[] = { 100000, 400000 };
+    uint32_t configured_hz = i2c_bus_get_device_clock(I2C_BUS_DEV_LCD);
+
+    for (size_t i = 0; i < sizeof(rates) / sizeof(rates[0]); i++) {
+        i2c_bus_set_device_clock(I2C_BUS_DEV_LCD, rates[i]);
+        memset(lcd_glass, 0, sizeof(lcd_glass));
+        glass_addr = 0xFF;
+
+        i2c_bus_stats_t before, after;
+        i2c_bus_get_stats(I2C_BUS_DEV_LCD, &before);
+        lcd_flush();
+        i2c_bus_get_stats(I2C_BUS_DEV_LCD, &after);
+        uint64_t busy_us = after.total_busy_us - before.total_busy_us;
+
+        ESP_LOGI("LCD", "Full refresh at %lu kHz: %llu us on the bus, %.1f chars/ms",
+                 (unsigned long)(rates[i] / 1000), (unsigned long long)busy_us,
+                 busy_us > 0 ? (LCD_ROWS * LCD_COLS) * 1000.0 / busy_us : 0.0);
+    }
+
+    i2c_bus_set_device_clock(I2C_BUS_DEV_LCD, configured_hz);
+}
+
+static void lcd_apply(const lcd_request_t *req) {
+    switch (req->type) {
+        case LCD_REQ_CLEAR:
+            memset(lcd_shadow, ' ', sizeof(lcd_shadow));
+            break;
+        case LCD_REQ_LINE:
+            memcpy(lcd_shadow[req->row], req->text, LCD_COLS);
+            break;
+        case LCD_REQ_CELL:
+            lcd_shadow[req->row][req->col] = req->text[0];
+            break;
+        case LCD_REQ_CURSOR:
+            cursor_row = req->row;
+            cursor_col = req->col;
+            if (!(req->flags & LCD_REQ_FLAG_SHOW)) {
+                display_ctrl = LCD_DISPLAY_ON_CURSOR_OFF;
+            } else if (req->flags & LCD_REQ_FLAG_BLINK) {
+                display_ctrl = LCD_DISPLAY_ON_CURSOR_BLINK;
+            } else {
+                display_ctrl = LCD_DISPLAY_ON_CURSOR_ON;
+            }
+            break;
+        case LCD_REQ_BACKLIGHT:
+            backlight_state = (req->flags & LCD_REQ_FLAG_SHOW) ? 0x08 : 0x00;
+            // The backlight is a plain PCF8574 pin, latch it without strobing E
+            lcd_stream_send();
+            lcd_stream[lcd_stream_len++] = backlight_state;
+            lcd_stream_send();
+            break;
+        case LCD_REQ_MEASURE:
+            lcd_measure_flush();
+            break;
+        default:
+            break;
+    }
+}
+
+// Sole owner of the display. Blocks until a request arrives, then drains
+// whatever else is already queued before flushing, so a burst of updates
+// from one screen costs a single bus transaction.
+static void lcd_task(void *pvParameters) {
+    lcd_request_t req;
+    while (1) {
+        if (xQueueReceive(lcd_queue, &req, portMAX_DELAY) != pdTRUE) {
+            continue;
+        }
+        bool sync = false;
+        do {
+            if (req.type == LCD_REQ_SYNC) {
+                sync = true;
+            } else {
+                lcd_apply(&req);
+            }
+        } while (xQueueReceive(lcd_queue, &req, 0) == pdTRUE);
+
+        int64_t flush_start_us = TRACE_NOW();
+        if (lcd_flush()) {
+            TRACE_FRAME_RENDERED(flush_start_us);
+        }
+        if (sync) {
+            xSemaphoreGive(lcd_synced);
+        }
+    }
+}
+
+// Either may be NULL, after a partly failed lcd_init()
+static void lcd_delete_queue(QueueHandle_t queue, SemaphoreHandle_t synced) {
+    if (queue != NULL) {
+        vQueueDelete(queue);
+    }
+    if (synced != NULL) {
+        vSemaphoreDelete(synced);
+    }
 }
 
 esp_err_t lcd_init(i2c_port_t i2c_port, uint8_t addr) {
-    lcd_i2c_port = i2c_port;
+    // The port itself belongs to the bus manager, see i2c_bus_init()
     lcd_addr = addr;
 
     ESP_LOGI("LCD", "Initializing LCD at address 0x%02X", lcd_addr);
-    vTaskDelay(50 / portTICK_PERIOD_MS); // Reduced initial delay
+    if (i2c_bus_get_device_clock(I2C_BUS_DEV_LCD) > LCD_MAX_SCL_HZ) {
+        // Faster and back-to-back instructions would overrun the controller
+        i2c_bus_set_device_clock(I2C_BUS_DEV_LCD, LCD_MAX_SCL_HZ);
+    }
+    vTaskDelay(50 / portTICK_PERIOD_MS); // Power-on wait, > 40 ms after Vcc rises
 
     for (int i = 0; i < 3; i++) {
         lcd_write_nibble(0x03, 0);
-        vTaskDelay(5 / portTICK_PERIOD_MS);
+        esp_rom_delay_us(LCD_INIT_WAIT_US);
         lcd_write_nibble(0x03, 0);
-        vTaskDelay(1 / portTICK_PERIOD_MS);
+        esp_rom_delay_us(LCD_INIT_SHORT_US);
         lcd_write_nibble(0x03, 0);
+        esp_rom_delay_us(LCD_INIT_SHORT_US);
         lcd_write_nibble(0x02, 0); // Set 4-bit mode
-        vTaskDelay(5 / portTICK_PERIOD_MS);
+        esp_rom_delay_us(LCD_INIT_SHORT_US);
     }
 
     lcd_command(0x28); // Function set: 4-bit, 2 lines, 5x8 dots
-    vTaskDelay(5 / portTICK_PERIOD_MS);
     lcd_command(LCD_DISPLAY_ON); // Display on, cursor off, blink off
-    vTaskDelay(5 / portTICK_PERIOD_MS);
-    lcd_command(LCD_CLEAR); // Clear display
-    vTaskDelay(5 / portTICK_PERIOD_MS);
-    lcd_command(LCD_HOME); // Reset cursor to home
-    vTaskDelay(5 / portTICK_PERIOD_MS);
     lcd_command(LCD_ENTRY_MODE); // Entry mode: increment, no shift
-    vTaskDelay(5 / portTICK_PERIOD_MS);
+    lcd_command(LCD_CLEAR); // Clear display, also homes the cursor
+    esp_err_t ret = lcd_stream_send();
 
-    return ESP_OK;
+    // Glass is blank after LCD_CLEAR, keep the shadow in sync with it
+    memset(lcd_glass, ' ', sizeof(lcd_glass));
+    memset(lcd_shadow, ' ', sizeof(lcd_shadow));
+    cursor_row = 0;
+    cursor_col = 0;
+    display_ctrl = LCD_DISPLAY_ON;
+    glass_ctrl = LCD_DISPLAY_ON;
+    glass_addr = 0;
+
+    if (lcd_queue == NULL) {
+        SemaphoreHandle_t synced = xSemaphoreCreateBinary();
+        QueueHandle_t queue = xQueueCreate(LCD_QUEUE_LEN, sizeof(lcd_request_t));
+        if (queue == NULL || synced == NULL) {
+            ESP_LOGE("LCD", "Failed to create request queue");
+            lcd_delete_queue(queue, synced);
+            return ESP_ERR_NO_MEM;
+        }
+        // Published before the task starts, it reads both
+        lcd_synced = synced;
+        lcd_queue = queue;
+        if (xTaskCreate(lcd_task, "lcd_task", LCD_TASK_STACK, NULL, LCD_TASK_PRIORITY, NULL) != pdPASS) {
+            ESP_LOGE("LCD", "Failed to create LCD task");
+            lcd_queue = NULL;
+            lcd_synced = NULL;
+            lcd_delete_queue(queue, synced);
+            return ESP_ERR_NO_MEM;
+        }
+    }
+
+    return ret;
 }
 
 void lcd_clear(void) {
-    // ESP_LOGI("LCD", "Clearing display");
-    
-    lcd_command(LCD_CLEAR);
-    vTaskDelay(5 / portTICK_PERIOD_MS); // Reduced delay
-    lcd_command(LCD_HOME);
-    vTaskDelay(2 / portTICK_PERIOD_MS);
-}
-
-// void lcd_set_cursor(uint8_t col, uint8_t row) {
-//     // ESP_LOGI("LCD", "Setting cursor to row %d, col %d", row, col);
-//     uint8_t address = (row == 0) ? 0x40 : 0x00;
-//     address += col;
-//     lcd_command(LCD_SET_DDRAM | address);
-//     vTaskDelay(2 / portTICK_PERIOD_MS); // Reduced delay
-// }
-
-// In lcd.c (corrected)
-void lcd_set_cursor(uint8_t row, uint8_t col) { // <-- Row first, then column
-    uint8_t address = (row == 0) ? 0x00 : 0x40;
-    address += col;
-    lcd_command(LCD_SET_DDRAM | address);
-    vTaskDelay(2 / portTICK_PERIOD_MS);
-}
-
-// void lcd_print(const char *str) {
-//     // ESP_LOGI("LCD", "Printing: %s", str);
-//     while (*str) {
-//         lcd_write_byte(*str++, 1);
-//         vTaskDelay(1 / portTICK_PERIOD_MS); // Reduced delay
-//     }
-// }
-
-void lcd_backlight(bool on) {
-    // ESP_LOGI("LCD", "Setting backlight: %s", on ? "ON" : "OFF");
-    backlight_state = on ? 0x08 : 0x00;
-    lcd_write_byte(0, 0);
-    vTaskDelay(2 / portTICK_PERIOD_MS); // Reduced delay
+    lcd_request_t req = { .type = LCD_REQ_CLEAR };
+    lcd_post(&req);
 }
 
-// Update lcd_print to handle format strings
-void lcd_print(const char *fmt, ...) {
-    char buf[33];  // 32 chars max plus null terminator
+// Formats one full row. Text past the last column is dropped and the rest
+// of the row is padded with spaces, so callers never leave stale characters.
+void lcd_set_line(uint8_t row, const char *fmt, ...) {
+    char buf[LCD_COLS + 1];
     va_list args;
     va_start(args, fmt);
-    vsnprintf(buf, sizeof(buf), fmt, args);
+    int len = vsnprintf(buf, sizeof(buf), fmt, args);
     va_end(args);
-    
-    // Original implementation
-    char *str = buf;
-    while (*str) {
-        lcd_write_byte(*str++, 1);
-        vTaskDelay(1 / portTICK_PERIOD_MS);
+    if (len < 0) {
+        len = 0;
+    } else if (len > LCD_COLS) {
+        len = LCD_COLS;
     }
+
+    lcd_request_t req = { .type = LCD_REQ_LINE, .row = (row == 0) ? 0 : 1 };
+    memset(req.text, ' ', LCD_COLS);
+    memcpy(req.text, buf, len);
+    lcd_post(&req);
 }
 
-// Implement cursor control functions
-void lcd_cursor_show(bool show) {
-    if (show) {
-        // Display on, cursor on, blink off
-        lcd_command(LCD_DISPLAY_ON_CURSOR_ON);
-    } else {
-        // Display on, cursor off, blink off
-        lcd_command(LCD_DISPLAY_ON_CURSOR_OFF);
+void lcd_set_cell(uint8_t row, uint8_t col, char c) {
+    if (col >= LCD_COLS) {
+        return;
     }
+    lcd_request_t req = { .type = LCD_REQ_CELL, .row = (row == 0) ? 0 : 1, .col = col };
+    req.text[0] = c;
+    lcd_post(&req);
 }
 
-void lcd_cursor_blink(bool blink) {
-    if (blink) {
-        // Display on, cursor on, blink on
-        lcd_command(LCD_DISPLAY_ON_CURSOR_BLINK);
-    } else {
-        // Display on, cursor on, blink off
-        lcd_command(LCD_DISPLAY_ON_CURSOR_ON);
+void lcd_set_cursor_state(uint8_t row, uint8_t col, bool show, bool blink) {
+    lcd_request_t req = {
+        .type = LCD_REQ_CURSOR,
+        .row = (row == 0) ? 0 : 1,
+        .col = (col < LCD_COLS) ? col : LCD_COLS - 1,
+        .flags = (show ? LCD_REQ_FLAG_SHOW : 0) | (blink ? LCD_REQ_FLAG_BLINK : 0),
+    };
+    lcd_post(&req);
+}
+
+void lcd_backlight(bool on) {
+    lcd_request_t req = { .type = LCD_REQ_BACKLIGHT, .flags = on ? LCD_REQ_FLAG_SHOW : 0 };
+    lcd_post(&req);
+}
+
+// Only one task may wait at a time, a second waiter could take the first
+// one's completion.
+bool lcd_sync(TickType_t timeout_ticks) {
+    if (lcd_queue == NULL) {
+        return false;
     }
-}
\ No newline at end of file
+    xSemaphoreTake(lcd_synced, 0);
+    lcd_request_t req = { .type = LCD_REQ_SYNC };
+    lcd_post(&req);
+    return xSemaphoreTake(lcd_synced, timeout_ticks) == pdTRUE;
+}
+
+void lcd_measure_refresh(void) {
+    lcd_request_t req = { .type = LCD_REQ_MEASURE };
+    lcd_post(&req);
+}
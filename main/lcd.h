@@ -1,18 +1,27 @@
 #ifndef LCD_H
 #define LCD_H
 
+#include <stdbool.h>
 #include <driver/i2c.h>
 #include <esp_err.h>
+#include <freertos/FreeRTOS.h>
 #define LCD_ADDR 0x27
+#define LCD_ROWS 2
+#define LCD_COLS 16
 
+// lcd_init() brings up the controller and starts the LCD task. Everything
+// below only queues a request for that task, none of it touches the bus.
+// If the task stops draining the queue, requests are dropped after a short
+// wait rather than blocking the caller.
 esp_err_t lcd_init(i2c_port_t i2c_port, uint8_t addr);
 void lcd_clear(void);
-void lcd_set_cursor(uint8_t row, uint8_t col);
-void lcd_print(const char *fmt, ...);  // Changed to accept format arguments
+void lcd_set_line(uint8_t row, const char *fmt, ...);   // Whole row, padded to LCD_COLS
+void lcd_set_cell(uint8_t row, uint8_t col, char c);     // Single character
+void lcd_set_cursor_state(uint8_t row, uint8_t col, bool show, bool blink);
 void lcd_backlight(bool on);
+bool lcd_sync(TickType_t timeout_ticks); // Wait until everything queued so far is on the glass
+// Redraws the whole screen at standard and fast mode and logs the bus time
+// of each. For bench_run(), not for production boots.
+void lcd_measure_refresh(void);
 
-// Add new cursor control functions
-void lcd_cursor_show(bool show);     // Show/hide the cursor underscore
-void lcd_cursor_blink(bool blink);   // Enable/disable cursor blinking
-
-#endif // LCD_H
\ No newline at end of file
+#endif // LCD_H
@@ -7,125 +7,74 @@
 #include <esp_log.h>
 // #include "keypad.h"
 #include "lcd.h"
+#include "i2c_bus.h"
 #include <string.h>
 #include <esp_log.h>
 #include "keyboard.h"
 #include "nvs_flash.h"
+#include "bench.h"
+#include "trace.h"
+#include <esp_console.h>
 
 
 #define I2C_PORT I2C_NUM_0
 #define I2C_SDA_IO 21
 #define I2C_SCL_IO 22
-#define I2C_FREQ_HZ 100000 // Reduced to 100kHz for better DS1307 compatibility
+#define I2C_FREQ_HZ 400000     // Fast mode for the keypad, LCD backpack and 24C32
+#define I2C_RTC_FREQ_HZ 100000 // The DS1307 only supports standard mode
 #define LCD_ADDR 0x27
 #define MAX_INPUT_LEN 15
 
-SemaphoreHandle_t lcd_semaphore;
 bool in_keypad_mode = false;
 bool in_keyboard_mode = false;
 static char full_string[MAX_INPUT_LEN + 1] = {0}; // Global string for input
-
-static void i2c_init(void) {
-    i2c_config_t conf = {
-        .mode = I2C_MODE_MASTER,
-        .sda_io_num = I2C_SDA_IO,
-        .scl_io_num = I2C_SCL_IO,
-        .sda_pullup_en = GPIO_PULLUP_ENABLE,
-        .scl_pullup_en = GPIO_PULLUP_ENABLE,
-        .master.clk_speed = I2C_FREQ_HZ
-    };
-    ESP_ERROR_CHECK(i2c_param_config(I2C_PORT, &conf));
-    ESP_ERROR_CHECK(i2c_driver_install(I2C_PORT, conf.mode, 0, 0, 0));
-    ESP_LOGI("I2C", "Initialized I2C on port %d, SDA: %d, SCL: %d", I2C_PORT, I2C_SDA_IO, I2C_SCL_IO);
-}
+static volatile bool splash_showing = true;
 
 void keypad_task(void *pvParameters) {
     char input[MAX_INPUT_LEN + 1] = {0};
     int input_pos = 0;
     bool local_in_keypad_mode = false;
-    bool semaphore_taken = false;
 
     while (1) {
-        char key = keypad_scan();
+        key_event_t event;
+        char key = '\0';
+        if (keypad_get_event(&event, portMAX_DELAY) && (event.type == KEY_EVENT_PRESS || event.type == KEY_EVENT_CHORD)) {
+            key = event.key;
+        }
         if (key != '\0') {
             ESP_LOGI("KeypadTask", "Key pressed: '%c'", key);
             if (!local_in_keypad_mode && key == 'A') {
                 local_in_keypad_mode = true;
                 in_keypad_mode = true;
-                if (xSemaphoreTake(lcd_semaphore, portMAX_DELAY) == pdTRUE) {
-                    semaphore_taken = true;
-                    ESP_LOGI("KeypadTask", "Took semaphore for entering mode");
-                    lcd_clear();
-                    lcd_set_cursor(0, 0);
-                    lcd_print("String: ");
-                    lcd_set_cursor(0, 1);
-                    lcd_print("Double: ");
-                    xSemaphoreGive(lcd_semaphore);
-                    semaphore_taken = false;
-                    ESP_LOGI("KeypadTask", "Released semaphore after entering mode");
-                }
+                lcd_set_line(0, "String: ");
+                lcd_set_line(1, "Double: ");
             } else if (local_in_keypad_mode) {
-                if (xSemaphoreTake(lcd_semaphore, portMAX_DELAY) == pdTRUE) {
-                    semaphore_taken = true;
-                    ESP_LOGI("KeypadTask", "Took semaphore for key input");
-                    lcd_clear();
-                    if (key == 'A') {
-                        // Convert string to double and display
-                        double converted_number = atof(full_string);
-                        lcd_set_cursor(0, 0);
-                        lcd_print("String: ");
-                        lcd_set_cursor(8, 0);
-                        lcd_print(full_string);
-                        lcd_set_cursor(0, 1);
-                        lcd_print("Double: ");
-                        lcd_set_cursor(8, 1);
-                        char buf[16];
-                        snprintf(buf, sizeof(buf), "%.2f", converted_number);
-                        lcd_print(buf);
-                        ESP_LOGI("KeypadTask", "String: %s, Double: %.2f", full_string, converted_number);
-                        full_string[0] = '\0';
-                        input_pos = 0;
-                        memset(input, 0, sizeof(input));
-                    } else if (key == 'D') {
-                        if (input_pos > 0) {
-                            input[--input_pos] = '\0';
-                            strncpy(full_string, input, MAX_INPUT_LEN);
-                            full_string[MAX_INPUT_LEN] = '\0';
-                            lcd_set_cursor(0, 0);
-                            lcd_print("String: ");
-                            lcd_set_cursor(8, 0);
-                            lcd_print(full_string);
-                            lcd_set_cursor(0, 1);
-                            lcd_print("Double: ");
-                            lcd_set_cursor(8, 1);
-                            lcd_print("       ");
-                        }
-                    } else if (key != 'B' && input_pos < MAX_INPUT_LEN) {
-                        input[input_pos++] = key;
-                        input[input_pos] = '\0';
+                if (key == 'A') {
+                    // Convert string to double and display
+                    double converted_number = atof(full_string);
+                    lcd_set_line(0, "String: %s", full_string);
+                    lcd_set_line(1, "Double: %.2f", converted_number);
+                    ESP_LOGI("KeypadTask", "String: %s, Double: %.2f", full_string, converted_number);
+                    full_string[0] = '\0';
+                    input_pos = 0;
+                    memset(input, 0, sizeof(input));
+                } else if (key == 'D') {
+                    if (input_pos > 0) {
+                        input[--input_pos] = '\0';
                         strncpy(full_string, input, MAX_INPUT_LEN);
                         full_string[MAX_INPUT_LEN] = '\0';
-                        lcd_set_cursor(0, 0);
-                        lcd_print("String: ");
-                        lcd_set_cursor(8, 0);
-                        lcd_print(full_string);
-                        lcd_set_cursor(0, 1);
-                        lcd_print("Double: ");
-                        lcd_set_cursor(8, 1);
-                        lcd_print("       ");
+                        lcd_set_line(0, "String: %s", full_string);
+                        lcd_set_line(1, "Double: ");
                     }
-                    xSemaphoreGive(lcd_semaphore);
-                    semaphore_taken = false;
-                    ESP_LOGI("KeypadTask", "Released semaphore after key input");
+                } else if (key != 'B' && input_pos < MAX_INPUT_LEN) {
+                    input[input_pos++] = key;
+                    input[input_pos] = '\0';
+                    strncpy(full_string, input, MAX_INPUT_LEN);
+                    full_string[MAX_INPUT_LEN] = '\0';
+                    lcd_set_line(0, "String: %s", full_string);
+                    lcd_set_line(1, "Double: ");
                 }
             }
-        } else {
-            if (semaphore_taken) {
-                xSemaphoreGive(lcd_semaphore);
-                semaphore_taken = false;
-                ESP_LOGI("KeypadTask", "Released semaphore (no key)");
-            }
-            vTaskDelay(100 / portTICK_PERIOD_MS);
         }
     }
 }
@@ -154,36 +103,45 @@ void keypad_task(void *pvParameters) {
 void seconds_task(void *pvParameters) {
     int seconds = 0;
     while (1) {
-        // Only take the semaphore and update display if not in keypad mode
-        if (!in_keyboard_mode) {
-            if (xSemaphoreTake(lcd_semaphore, portMAX_DELAY) == pdTRUE) {
-                lcd_clear();
-                lcd_set_cursor(0, 0);
-                lcd_print("Seconds: %d", seconds++);
-                lcd_set_cursor(1, 0);
-                lcd_print("Press A to edit");
-                xSemaphoreGive(lcd_semaphore);
-            }
+        // Leave the screen alone while the splash or the keyboard UI owns it
+        if (!in_keyboard_mode && !splash_showing) {
+            lcd_set_line(0, "Seconds: %d", seconds++);
+            lcd_set_line(1, "Press A to edit");
         }
         vTaskDelay(1000 / portTICK_PERIOD_MS);
     }
 }
 
 void splash_task(void *pvParameters) {
-    if (xSemaphoreTake(lcd_semaphore, portMAX_DELAY) == pdTRUE) {
-        ESP_LOGI("SplashTask", "Took semaphore for splash screen");
-        lcd_clear();
-        lcd_set_cursor(0, 0);
-        lcd_print("Keypad 123-ABC");
-        lcd_set_cursor(1, 0);
-        lcd_print("Demonstration");
-        vTaskDelay(2000 / portTICK_PERIOD_MS);
-        xSemaphoreGive(lcd_semaphore);
-        ESP_LOGI("SplashTask", "Released semaphore after splash screen");
-    }
+    lcd_clear();
+    lcd_set_line(0, "Keypad 123-ABC");
+    lcd_set_line(1, "Demonstration");
+    vTaskDelay(2000 / portTICK_PERIOD_MS);
+    splash_showing = false;
+    ESP_LOGI("SplashTask", "Splash screen done");
     vTaskDelete(NULL);
 }
 
+// Serial console for diagnostics; each module registers its own commands
+static void console_start(void) {
+    esp_console_repl_t *repl = NULL;
+    esp_console_repl_config_t repl_config = ESP_CONSOLE_REPL_CONFIG_DEFAULT();
+    repl_config.prompt = "panel>";
+    esp_console_dev_uart_config_t uart_config = ESP_CONSOLE_DEV_UART_CONFIG_DEFAULT();
+
+    esp_err_t ret = esp_console_new_repl_uart(&uart_config, &repl_config, &repl);
+    if (ret != ESP_OK) {
+        ESP_LOGW("Main", "Console unavailable: %s", esp_err_to_name(ret));
+        return;
+    }
+    esp_console_register_help_command();
+    trace_console_register();
+    ret = esp_console_start_repl(repl);
+    if (ret != ESP_OK) {
+        ESP_LOGW("Main", "Console failed to start: %s", esp_err_to_name(ret));
+    }
+}
+
 void app_main(void) {
     ESP_LOGI("Main", "Starting application");
     
@@ -197,22 +155,26 @@ void app_main(void) {
     }
     ESP_LOGI("Main", "NVS Flash initialized");
     
-    lcd_semaphore = xSemaphoreCreateMutex();
-    if (lcd_semaphore == NULL) {
-        ESP_LOGE("Main", "Failed to create LCD semaphore");
-        return;
-    }
-
-    i2c_init();
+    ESP_ERROR_CHECK(i2c_bus_init(I2C_PORT, I2C_SDA_IO, I2C_SCL_IO, I2C_FREQ_HZ));
+    i2c_bus_set_device_clock(I2C_BUS_DEV_RTC, I2C_RTC_FREQ_HZ);
     ESP_ERROR_CHECK(lcd_init(I2C_PORT, LCD_ADDR));
     ESP_ERROR_CHECK(keypad_init(I2C_PORT));
+    ESP_ERROR_CHECK(param_store_init());
 
     lcd_backlight(true);
 
+#ifdef APP_BENCH
+    // Before the UI tasks exist, so the numbers are not disturbed by them
+    bench_run();
+#endif
+
     xTaskCreate(splash_task, "splash_task", 2048, NULL, 7, NULL);
     // xTaskCreate(keypad_task, "keypad_task", 1024*4, NULL, 6, NULL);
     xTaskCreate(keyboard_task, "keypad_task", 1024*4, NULL, 6, NULL);
     xTaskCreate(seconds_task, "seconds_task", 2048, NULL, 5, NULL);
+    xTaskCreate(param_flush_task, "param_flush", 1024*4, NULL, 4, NULL);
+
+    console_start();
 
     ESP_LOGI("Main", "Tasks created, entering idle");
     while (1) {
@@ -0,0 +1,118 @@
+#ifndef PARAM_TABLE_H
+#define PARAM_TABLE_H
+
+// The one definition of every parameter. keyboard.h turns it into the
+// PARAM_ID_* enum and keyboard.c into the parameters[] table, the group
+// ranges and the number lookup, so none of them can drift from the others.
+//
+// X(arg, id, num, label, type, group, storage, default, unit, validate, rules...)
+//   arg      passed through unchanged, for expansions that need a parameter
+//   num      the number shown before the label. It is also the address the
+//            value is stored under, so it must never change once released.
+//   rules    designated initialisers for param_validation_t. Decimal limits
+//            are scaled like the value: 9999 with one place is 999.9.
+//
+// Parameters of a group must be listed together, groups in param_group_t
+// order; keyboard.c fails to compile otherwise. Numbers run up to
+// PARAM_ADDRESS_MAX, three digits.
+#define PARAM_LIST(X, arg) \
+    X(arg, TIME,       01, "Time",     PARAM_TYPE_TIME,           GROUP_DATE_TIME,      STORAGE_RTC,    "0000",     "",  validate_time, \
+      .min_length = 4, .max_length = 4, .format = FORMAT_TIME, .min_value = 0, .max_value = 2359) \
+    X(arg, DATE,       02, "Date",     PARAM_TYPE_DATE,           GROUP_DATE_TIME,      STORAGE_RTC,    "010123",   "",  validate_date, \
+      .min_length = 6, .max_length = 6, .format = FORMAT_DATE, .min_value = 0, .max_value = 311299) \
+    X(arg, HI_VOLT,    03, "Hi Volt",  PARAM_TYPE_DECIMAL,        GROUP_PROTECTION,     STORAGE_EEPROM, "280.0",    "V", validate_decimal, \
+      .min_length = 3, .max_length = 5, .format = FORMAT_DECIMAL, .min_value = 0, .max_value = 9999, .decimal_places = 1) \
+    X(arg, LO_VOLT,    04, "Lo Volt",  PARAM_TYPE_DECIMAL,        GROUP_PROTECTION,     STORAGE_NVS,    "180.0",    "V", validate_decimal, \
+      .min_length = 3, .max_length = 5, .format = FORMAT_DECIMAL, .min_value = 0, .max_value = 9999, .decimal_places = 1) \
+    X(arg, R_LOW_A,    05, "R-Low A",  PARAM_TYPE_DECIMAL,        GROUP_PROTECTION,     STORAGE_NVS,    "1.0",      "A", validate_decimal, \
+      .min_length = 1, .max_length = 3, .format = FORMAT_DECIMAL, .min_value = 0, .max_value = 99, .decimal_places = 1) \
+    X(arg, Y_LOW_A,    06, "Y-Low A",  PARAM_TYPE_DECIMAL,        GROUP_PROTECTION,     STORAGE_NVS,    "1.0",      "A", validate_decimal, \
+      .min_length = 1, .max_length = 3, .format = FORMAT_DECIMAL, .min_value = 0, .max_value = 99, .decimal_places = 1) \
+    X(arg, B_LOW_A,    07, "B-Low A",  PARAM_TYPE_DECIMAL,        GROUP_PROTECTION,     STORAGE_NVS,    "1.0",      "A", validate_decimal, \
+      .min_length = 1, .max_length = 3, .format = FORMAT_DECIMAL, .min_value = 0, .max_value = 99, .decimal_places = 1) \
+    X(arg, OC_PERCENT, 08, "OC %",     PARAM_TYPE_NUMBER,         GROUP_PROTECTION,     STORAGE_NVS,    "25",       "%", validate_number, \
+      .min_length = 1, .max_length = 3, .format = FORMAT_NONE, .min_value = 0, .max_value = 999) \
+    X(arg, ALARM,      09, "Alarm",    PARAM_TYPE_ENABLE_DISABLE, GROUP_PROTECTION,     STORAGE_NVS,    "0",        "",  validate_enable_disable, \
+      .min_length = 1, .max_length = 1, .format = FORMAT_ENABLE_DISABLE, .min_value = 0, .max_value = 1) \
+    X(arg, PROTECT,    10, "Protect",  PARAM_TYPE_MULTIPLE,       GROUP_PROTECTION,     STORAGE_NVS,    "0",        "",  validate_multiple, \
+      .min_length = 1, .max_length = 1, .format = FORMAT_MULTIPLE, .min_value = 0, .max_value = 3) \
+    X(arg, ROTATE,     11, "Rotate",   PARAM_TYPE_ENABLE_DISABLE, GROUP_STAGGERING,     STORAGE_NVS,    "0",        "",  validate_enable_disable, \
+      .min_length = 1, .max_length = 1, .format = FORMAT_ENABLE_DISABLE, .min_value = 0, .max_value = 1) \
+    X(arg, R_ON_TIME,  12, "R On Tm",  PARAM_TYPE_TIME,           GROUP_STAGGERING,     STORAGE_NVS,    "0000",     "",  validate_time, \
+      .min_length = 4, .max_length = 4, .format = FORMAT_TIME, .min_value = 0, .max_value = 2359) \
+    X(arg, Y_ON_TIME,  13, "Y On Tm",  PARAM_TYPE_TIME,           GROUP_STAGGERING,     STORAGE_NVS,    "0000",     "",  validate_time, \
+      .min_length = 4, .max_length = 4, .format = FORMAT_TIME, .min_value = 0, .max_value = 2359) \
+    X(arg, B_ON_TIME,  14, "B On Tm",  PARAM_TYPE_TIME,           GROUP_STAGGERING,     STORAGE_NVS,    "0000",     "",  validate_time, \
+      .min_length = 4, .max_length = 4, .format = FORMAT_TIME, .min_value = 0, .max_value = 2359) \
+    X(arg, R_OFF_TIME, 15, "R OffTm",  PARAM_TYPE_TIME,           GROUP_STAGGERING,     STORAGE_NVS,    "0000",     "",  validate_time, \
+      .min_length = 4, .max_length = 4, .format = FORMAT_TIME, .min_value = 0, .max_value = 2359) \
+    X(arg, Y_OFF_TIME, 16, "Y OffTm",  PARAM_TYPE_TIME,           GROUP_STAGGERING,     STORAGE_NVS,    "0000",     "",  validate_time, \
+      .min_length = 4, .max_length = 4, .format = FORMAT_TIME, .min_value = 0, .max_value = 2359) \
+    X(arg, B_OFF_TIME, 17, "B OffTm",  PARAM_TYPE_TIME,           GROUP_STAGGERING,     STORAGE_NVS,    "0000",     "",  validate_time, \
+      .min_length = 4, .max_length = 4, .format = FORMAT_TIME, .min_value = 0, .max_value = 2359) \
+    X(arg, BACK_SET,   18, "BackSet",  PARAM_TYPE_NUMBER,         GROUP_CIVIL_TWILIGHT, STORAGE_NVS,    "0",        "",  validate_number, \
+      .min_length = 1, .max_length = 3, .format = FORMAT_NONE, .min_value = -99, .max_value = 99, .allow_negative = true) \
+    X(arg, BACK_RISE,  19, "BackRise", PARAM_TYPE_NUMBER,         GROUP_CIVIL_TWILIGHT, STORAGE_NVS,    "0",        "",  validate_number, \
+      .min_length = 1, .max_length = 3, .format = FORMAT_NONE, .min_value = -99, .max_value = 99, .allow_negative = true) \
+    X(arg, JAN_DUSK,   20, "JanDusk",  PARAM_TYPE_TIME,           GROUP_CIVIL_TWILIGHT, STORAGE_NVS,    "0000",     "",  validate_time, \
+      .min_length = 4, .max_length = 4, .format = FORMAT_TIME, .min_value = 0, .max_value = 99) \
+    X(arg, JAN_DAWN,   21, "JanDawn",  PARAM_TYPE_TIME,           GROUP_CIVIL_TWILIGHT, STORAGE_NVS,    "0000",     "",  validate_time, \
+      .min_length = 4, .max_length = 4, .format = FORMAT_TIME, .min_value = 0, .max_value = 99) \
+    X(arg, DEC_DUSK,   22, "DecDusk",  PARAM_TYPE_TIME,           GROUP_CIVIL_TWILIGHT, STORAGE_NVS,    "0000",     "",  validate_time, \
+      .min_length = 4, .max_length = 4, .format = FORMAT_TIME, .min_value = 0, .max_value = 99) \
+    X(arg, DEC_DAWN,   23, "DecDawn",  PARAM_TYPE_TIME,           GROUP_CIVIL_TWILIGHT, STORAGE_NVS,    "0000",     "",  validate_time, \
+      .min_length = 4, .max_length = 4, .format = FORMAT_TIME, .min_value = 0, .max_value = 99) \
+    X(arg, PASSWORD,   24, "Password", PARAM_TYPE_PASSWORD,       GROUP_SYSTEM,         STORAGE_NVS,    "00000000", "",  validate_password, \
+      .min_length = 8, .max_length = 8, .format = FORMAT_NONE, .min_value = 0, .max_value = 0, .max_retries = 3, .lockout_time = 15) \
+    X(arg, PASS_ED,    25, "PassED",   PARAM_TYPE_ENABLE_DISABLE, GROUP_SYSTEM,         STORAGE_NVS,    "0",        "",  validate_enable_disable, \
+      .min_length = 1, .max_length = 1, .format = FORMAT_ENABLE_DISABLE, .min_value = 0, .max_value = 1) \
+    PARAM_BENCH_LIST(X, arg)
+
+// Host benchmark builds only: PARAM_BENCH_HUNDREDS (0-5) appends that many
+// hundred plain numbers to the SYSTEM group, at addresses 100 up, to show
+// how boot and navigation cost grow with the table. Firmware leaves it 0.
+#ifndef PARAM_BENCH_HUNDREDS
+#define PARAM_BENCH_HUNDREDS 0
+#endif
+
+#define PARAM_BENCH_ONE(X, arg, h, t, u)                                                          \
+    X(arg, BENCH_##h##t##u, h##t##u, "Bench", PARAM_TYPE_NUMBER, GROUP_SYSTEM, STORAGE_NVS, "0", "", \
+      validate_number, .min_length = 1, .max_length = 3, .format = FORMAT_NONE, .min_value = 0, .max_value = 999)
+#define PARAM_BENCH_TEN(X, arg, h, t)                                                             \
+    PARAM_BENCH_ONE(X, arg, h, t, 0) PARAM_BENCH_ONE(X, arg, h, t, 1) PARAM_BENCH_ONE(X, arg, h, t, 2) \
+    PARAM_BENCH_ONE(X, arg, h, t, 3) PARAM_BENCH_ONE(X, arg, h, t, 4) PARAM_BENCH_ONE(X, arg, h, t, 5) \
+    PARAM_BENCH_ONE(X, arg, h, t, 6) PARAM_BENCH_ONE(X, arg, h, t, 7) PARAM_BENCH_ONE(X, arg, h, t, 8) \
+    PARAM_BENCH_ONE(X, arg, h, t, 9)
+#define PARAM_BENCH_HUNDRED(X, arg, h)                                                      \
+    PARAM_BENCH_TEN(X, arg, h, 0) PARAM_BENCH_TEN(X, arg, h, 1) PARAM_BENCH_TEN(X, arg, h, 2) \
+    PARAM_BENCH_TEN(X, arg, h, 3) PARAM_BENCH_TEN(X, arg, h, 4) PARAM_BENCH_TEN(X, arg, h, 5) \
+    PARAM_BENCH_TEN(X, arg, h, 6) PARAM_BENCH_TEN(X, arg, h, 7) PARAM_BENCH_TEN(X, arg, h, 8) \
+    PARAM_BENCH_TEN(X, arg, h, 9)
+
+#if PARAM_BENCH_HUNDREDS == 0
+#define PARAM_BENCH_LIST(X, arg)
+#elif PARAM_BENCH_HUNDREDS == 1
+#define PARAM_BENCH_LIST(X, arg) PARAM_BENCH_HUNDRED(X, arg, 1)
+#elif PARAM_BENCH_HUNDREDS == 2
+#define PARAM_BENCH_LIST(X, arg) PARAM_BENCH_HUNDRED(X, arg, 1) PARAM_BENCH_HUNDRED(X, arg, 2)
+#elif PARAM_BENCH_HUNDREDS == 5
+#define PARAM_BENCH_LIST(X, arg)                                      \
+    PARAM_BENCH_HUNDRED(X, arg, 1) PARAM_BENCH_HUNDRED(X, arg, 2) PARAM_BENCH_HUNDRED(X, arg, 3) \
+    PARAM_BENCH_HUNDRED(X, arg, 4) PARAM_BENCH_HUNDRED(X, arg, 5)
+#else
+#error "PARAM_BENCH_HUNDREDS must be 0, 1, 2 or 5"
+#endif
+
+// Groups in menu order, X(arg, group, title)
+#define PARAM_GROUP_LIST(X, arg) \
+    X(arg, GROUP_DATE_TIME,      "TIME & DATE") \
+    X(arg, GROUP_PROTECTION,     "PROTECTION") \
+    X(arg, GROUP_STAGGERING,     "STAGGERING") \
+    X(arg, GROUP_CIVIL_TWILIGHT, "TWILIGHT") \
+    X(arg, GROUP_SYSTEM,         "SYSTEM SETUP")
+
+// Parameter number from the num token; 1##07 is 107, whatever the width
+#define PARAM_NUMBER(num) (1##num - (sizeof(#num) == 4 ? 1000 : sizeof(#num) == 3 ? 100 : 10))
+#define PARAM_NAME(num, label) #num "." label ":"
+
+#endif // PARAM_TABLE_H
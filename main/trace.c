@@ -0,0 +1,280 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <esp_console.h>
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include "trace.h"
+#include "i2c_bus.h"
+
+#if TRACE_ENABLED
+
+// Recent events, oldest overwritten first. Times are the low 32 bits of
+// esp_timer, which only ever get compared with their neighbours.
+#define TRACE_RING_LEN 128
+
+typedef struct {
+    uint32_t time_us;
+    uint8_t event;
+    uint8_t arg;
+} trace_entry_t;
+
+// Upper edges in microseconds; the last bucket takes everything above
+static const uint32_t trace_bucket_us[] = {
+    100, 250, 500, 1000, 2500, 5000, 10000, 25000, 50000, 100000, 250000, 500000, 1000000,
+};
+#define TRACE_BUCKETS (sizeof(trace_bucket_us) / sizeof(trace_bucket_us[0]) + 1)
+
+typedef struct {
+    uint32_t counts[TRACE_BUCKETS];
+    uint32_t samples;
+    uint32_t max_us;
+    uint64_t total_us;
+} trace_histogram_t;
+
+static trace_entry_t trace_ring[TRACE_RING_LEN];
+static uint32_t trace_ring_next = 0;  // Total events recorded, ring index is this modulo the length
+static trace_histogram_t trace_hists[TRACE_HIST_COUNT];
+static int64_t trace_key_pending_us = 0;  // Edge of the oldest handled key not yet on screen, 0 if none
+static uint32_t trace_latency_window[TRACE_LATENCY_WINDOW];
+static uint32_t trace_latency_next = 0;  // Total samples, window index is this modulo the length
+static portMUX_TYPE trace_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// Called with trace_lock held
+static void trace_log_event(trace_event_t event, uint8_t arg, int64_t now_us) {
+    trace_entry_t *entry = &trace_ring[trace_ring_next % TRACE_RING_LEN];
+    entry->time_us = (uint32_t)now_us;
+    entry->event = event;
+    entry->arg = arg;
+    trace_ring_next++;
+}
+
+// Called with trace_lock held
+static void trace_hist_add(trace_hist_t hist, int64_t elapsed_us) {
+    if (elapsed_us < 0) {
+        elapsed_us = 0;
+    }
+    uint32_t us = elapsed_us > UINT32_MAX ? UINT32_MAX : (uint32_t)elapsed_us;
+    size_t bucket = 0;
+    while (bucket < TRACE_BUCKETS - 1 && us > trace_bucket_us[bucket]) {
+        bucket++;
+    }
+
+    trace_histogram_t *h = &trace_hists[hist];
+    h->counts[bucket]++;
+    h->samples++;
+    h->total_us += us;
+    if (us > h->max_us) {
+        h->max_us = us;
+    }
+}
+
+void trace_key_detected(char key, int64_t queued_us) {
+    portENTER_CRITICAL(&trace_lock);
+    trace_log_event(TRACE_EV_KEY_DETECTED, (uint8_t)key, queued_us);
+    portEXIT_CRITICAL(&trace_lock);
+}
+
+void trace_key_handled(char key, bool acted, int64_t edge_us, int64_t queued_us) {
+    int64_t now_us = esp_timer_get_time();
+    portENTER_CRITICAL(&trace_lock);
+    trace_log_event(TRACE_EV_KEY_HANDLED, (uint8_t)key, now_us);
+    trace_hist_add(TRACE_HIST_KEY_QUEUE, now_us - queued_us);
+    if (acted && trace_key_pending_us == 0) {
+        trace_key_pending_us = edge_us;
+    }
+    portEXIT_CRITICAL(&trace_lock);
+}
+
+void trace_frame_rendered(int64_t start_us) {
+    int64_t now_us = esp_timer_get_time();
+    portENTER_CRITICAL(&trace_lock);
+    trace_log_event(TRACE_EV_FRAME_RENDERED, 0, now_us);
+    trace_hist_add(TRACE_HIST_RENDER, now_us - start_us);
+    if (trace_key_pending_us != 0) {
+        int64_t latency_us = now_us - trace_key_pending_us;
+        trace_hist_add(TRACE_HIST_KEY_TO_SCREEN, latency_us);
+        trace_latency_window[trace_latency_next % TRACE_LATENCY_WINDOW] =
+            latency_us > UINT32_MAX ? UINT32_MAX : (uint32_t)latency_us;
+        trace_latency_next++;
+        trace_key_pending_us = 0;
+    }
+    portEXIT_CRITICAL(&trace_lock);
+}
+
+void trace_param_validated(int param_idx, int64_t start_us) {
+    int64_t now_us = esp_timer_get_time();
+    portENTER_CRITICAL(&trace_lock);
+    trace_log_event(TRACE_EV_PARAM_VALIDATED, (uint8_t)param_idx, now_us);
+    trace_hist_add(TRACE_HIST_VALIDATE, now_us - start_us);
+    portEXIT_CRITICAL(&trace_lock);
+}
+
+void trace_param_stored(int param_idx, int64_t start_us) {
+    int64_t now_us = esp_timer_get_time();
+    portENTER_CRITICAL(&trace_lock);
+    trace_log_event(TRACE_EV_PARAM_STORED, (uint8_t)param_idx, now_us);
+    trace_hist_add(TRACE_HIST_STORE, now_us - start_us);
+    portEXIT_CRITICAL(&trace_lock);
+}
+
+static int trace_compare_u32(const void *a, const void *b) {
+    uint32_t x = *(const uint32_t *)a;
+    uint32_t y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+// Nearest-rank percentiles of a sorted copy, the window is small enough
+// that sorting on demand beats keeping it ordered on the render path
+bool trace_latency_get(trace_latency_t *latency) {
+    uint32_t sorted[TRACE_LATENCY_WINDOW];
+    portENTER_CRITICAL(&trace_lock);
+    uint32_t next = trace_latency_next;
+    uint32_t count = next < TRACE_LATENCY_WINDOW ? next : TRACE_LATENCY_WINDOW;
+    memcpy(sorted, trace_latency_window, sizeof(sorted));
+    portEXIT_CRITICAL(&trace_lock);
+
+    memset(latency, 0, sizeof(*latency));
+    if (count == 0) {
+        return false;
+    }
+    latency->samples = count;
+    latency->last_us = sorted[(next - 1) % TRACE_LATENCY_WINDOW];
+    qsort(sorted, count, sizeof(sorted[0]), trace_compare_u32);
+    latency->p50_us = sorted[(count * 50 + 99) / 100 - 1];
+    latency->p95_us = sorted[(count * 95 + 99) / 100 - 1];
+    latency->p99_us = sorted[(count * 99 + 99) / 100 - 1];
+    return true;
+}
+
+// Also forgets a key still waiting for its frame, it belongs to the old window
+void trace_latency_reset(void) {
+    portENTER_CRITICAL(&trace_lock);
+    trace_latency_next = 0;
+    trace_key_pending_us = 0;
+    portEXIT_CRITICAL(&trace_lock);
+}
+
+static const char *trace_event_names[TRACE_EV_COUNT] = {
+    "key_detected",
+    "key_handled",
+    "frame_rendered",
+    "param_validated",
+    "param_stored",
+};
+
+static const char *trace_hist_names[TRACE_HIST_COUNT] = {
+    "key_queue",
+    "key_to_screen",
+    "render",
+    "validate",
+    "store",
+};
+
+// Printed straight to the console rather than the log, the tables are meant
+// to be read or parsed as a block
+void trace_dump(void) {
+    // Copy under the lock, print without it
+    static trace_histogram_t hists[TRACE_HIST_COUNT];
+    static trace_entry_t ring[TRACE_RING_LEN];
+    portENTER_CRITICAL(&trace_lock);
+    memcpy(hists, trace_hists, sizeof(hists));
+    memcpy(ring, trace_ring, sizeof(ring));
+    uint32_t next = trace_ring_next;
+    portEXIT_CRITICAL(&trace_lock);
+
+    printf("%-14s %6s %9s %9s", "histogram", "n", "avg_us", "max_us");
+    for (size_t b = 0; b < TRACE_BUCKETS - 1; b++) {
+        printf(" <=%-7lu", (unsigned long)trace_bucket_us[b]);
+    }
+    printf(" >%-8lu\n", (unsigned long)trace_bucket_us[TRACE_BUCKETS - 2]);
+    for (int i = 0; i < TRACE_HIST_COUNT; i++) {
+        const trace_histogram_t *h = &hists[i];
+        printf("%-14s %6lu %9lu %9lu", trace_hist_names[i], (unsigned long)h->samples,
+               (unsigned long)(h->samples ? h->total_us / h->samples : 0), (unsigned long)h->max_us);
+        for (size_t b = 0; b < TRACE_BUCKETS; b++) {
+            printf(" %9lu", (unsigned long)h->counts[b]);
+        }
+        printf("\n");
+    }
+
+    trace_latency_t latency;
+    if (trace_latency_get(&latency)) {
+        printf("key_to_screen last %lu: p50 %lu us, p95 %lu us, p99 %lu us, latest %lu us\n",
+               (unsigned long)latency.samples, (unsigned long)latency.p50_us, (unsigned long)latency.p95_us,
+               (unsigned long)latency.p99_us, (unsigned long)latency.last_us);
+    }
+
+    uint32_t count = next < TRACE_RING_LEN ? next : TRACE_RING_LEN;
+    printf("last %lu events, us since the previous one:\n", (unsigned long)count);
+    uint32_t prev_us = 0;
+    for (uint32_t n = next - count; n != next; n++) {
+        const trace_entry_t *e = &ring[n % TRACE_RING_LEN];
+        uint32_t delta_us = (n == next - count) ? 0 : e->time_us - prev_us;
+        prev_us = e->time_us;
+        if (e->event == TRACE_EV_KEY_DETECTED || e->event == TRACE_EV_KEY_HANDLED) {
+            printf("%10lu %-16s '%c'\n", (unsigned long)delta_us, trace_event_names[e->event], e->arg);
+        } else if (e->event == TRACE_EV_FRAME_RENDERED) {
+            printf("%10lu %-16s\n", (unsigned long)delta_us, trace_event_names[e->event]);
+        } else {
+            printf("%10lu %-16s param %u\n", (unsigned long)delta_us, trace_event_names[e->event], e->arg);
+        }
+    }
+    fflush(stdout);
+}
+
+void trace_reset(void) {
+    portENTER_CRITICAL(&trace_lock);
+    memset(trace_hists, 0, sizeof(trace_hists));
+    trace_ring_next = 0;
+    trace_key_pending_us = 0;
+    trace_latency_next = 0;
+    portEXIT_CRITICAL(&trace_lock);
+}
+
+#else
+
+void trace_dump(void) {
+    printf("tracing is compiled out, build with TRACE_ENABLED 1\n");
+}
+
+void trace_reset(void) {
+}
+
+bool trace_latency_get(trace_latency_t *latency) {
+    memset(latency, 0, sizeof(*latency));
+    return false;
+}
+
+void trace_latency_reset(void) {
+}
+
+#endif // TRACE_ENABLED
+
+static int trace_cmd(int argc, char **argv) {
+    if (argc < 2) {
+        trace_dump();
+    } else if (strcmp(argv[1], "reset") == 0) {
+        trace_reset();
+    } else if (strcmp(argv[1], "bus") == 0) {
+        i2c_bus_log_stats();
+    } else {
+        printf("usage: trace [reset|bus]\n");
+        return 1;
+    }
+    return 0;
+}
+
+void trace_console_register(void) {
+    const esp_console_cmd_t cmd = {
+        .command = "trace",
+        .help = "Dump latency histograms and recent events. 'reset' clears them, 'bus' shows I2C statistics",
+        .hint = "[reset|bus]",
+        .func = &trace_cmd,
+    };
+    esp_err_t ret = esp_console_cmd_register(&cmd);
+    if (ret != ESP_OK) {
+        ESP_LOGW("Trace", "Failed to register console command: %s", esp_err_to_name(ret));
+    }
+}
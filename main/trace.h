@@ -0,0 +1,84 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <esp_timer.h>
+
+// Hot-path tracing. Each hook stamps an event into a static ring buffer and,
+// where it closes an interval, adds that interval to a fixed-bucket latency
+// histogram. The "trace" console command dumps both. Build with
+// TRACE_ENABLED 0 and every hook compiles to nothing.
+#ifndef TRACE_ENABLED
+#define TRACE_ENABLED 1
+#endif
+
+typedef enum {
+    TRACE_EV_KEY_DETECTED,   // Scanner queued a key event, stamped with the queueing time
+    TRACE_EV_KEY_HANDLED,    // keyboard_task took it off the queue
+    TRACE_EV_FRAME_RENDERED, // LCD task finished sending a changed frame
+    TRACE_EV_PARAM_VALIDATED,
+    TRACE_EV_PARAM_STORED,
+    TRACE_EV_COUNT
+} trace_event_t;
+
+// Rolling key-to-screen percentiles over the last TRACE_LATENCY_WINDOW keys
+#define TRACE_LATENCY_WINDOW 64
+
+typedef struct {
+    uint32_t samples;  // In the window, at most TRACE_LATENCY_WINDOW
+    uint32_t last_us;
+    uint32_t p50_us;
+    uint32_t p95_us;
+    uint32_t p99_us;
+} trace_latency_t;
+
+typedef enum {
+    TRACE_HIST_KEY_QUEUE,     // Key detected to key handled
+    TRACE_HIST_KEY_TO_SCREEN, // Key edge to the last bus byte of the first frame rendered after it was handled
+    TRACE_HIST_RENDER,        // Time on the bus for one frame
+    TRACE_HIST_VALIDATE,
+    TRACE_HIST_STORE,
+    TRACE_HIST_COUNT
+} trace_hist_t;
+
+#if TRACE_ENABLED
+
+// Times come from the key event itself, so the scanner and keyboard_task
+// may run on different cores without the two ends getting mismatched
+void trace_key_detected(char key, int64_t queued_us);
+// acted is false for events the UI ignores (releases, most repeats); only
+// keys it acted on start a key-to-screen measurement, timed from edge_us
+void trace_key_handled(char key, bool acted, int64_t edge_us, int64_t queued_us);
+void trace_frame_rendered(int64_t start_us);
+void trace_param_validated(int param_idx, int64_t start_us);
+void trace_param_stored(int param_idx, int64_t start_us);
+
+#define TRACE_NOW() esp_timer_get_time()
+#define TRACE_KEY_DETECTED(event) trace_key_detected((event).key, (event).queued_us)
+#define TRACE_KEY_HANDLED(event, acted) trace_key_handled((event).key, (acted), (event).edge_us, (event).queued_us)
+#define TRACE_FRAME_RENDERED(start_us) trace_frame_rendered(start_us)
+#define TRACE_PARAM_VALIDATED(idx, start_us) trace_param_validated((idx), (start_us))
+#define TRACE_PARAM_STORED(idx, start_us) trace_param_stored((idx), (start_us))
+
+#else
+
+// Arguments are still evaluated, so the variables feeding them stay used
+#define TRACE_NOW() 0
+#define TRACE_KEY_DETECTED(event) do { (void)(event); } while (0)
+#define TRACE_KEY_HANDLED(event, acted) do { (void)(event); (void)(acted); } while (0)
+#define TRACE_FRAME_RENDERED(start_us) do { (void)(start_us); } while (0)
+#define TRACE_PARAM_VALIDATED(idx, start_us) do { (void)(idx); (void)(start_us); } while (0)
+#define TRACE_PARAM_STORED(idx, start_us) do { (void)(idx); (void)(start_us); } while (0)
+
+#endif // TRACE_ENABLED
+
+void trace_dump(void);
+void trace_reset(void);
+// False if there are no samples yet or tracing is compiled out
+bool trace_latency_get(trace_latency_t *latency);
+void trace_latency_reset(void);
+// Adds the "trace" command to an already created esp_console
+void trace_console_register(void);
+
+#endif // TRACE_H